@@ -0,0 +1,33 @@
+#include <chrono>
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include <SyntheticBuilding.h>
+
+using namespace std;
+
+// write a synthetic building scan for the end-to-end benchmark, the same file for the same arguments
+// usage: GenerateBuilding <output.ply|.pcd|.txt|.obj> [numPoints = 1e6] [roomsX = 4] [roomsY = 3] [seed = 1]
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        printf("usage: GenerateBuilding <output.ply|.pcd|.txt|.obj> [numPoints = 1e6] [roomsX = 4] [roomsY = 3] [seed = 1]\n");
+        return 1;
+    }
+    KKRecons::BuildingSpec spec;
+    if (argc > 2) spec.numPoints = static_cast<uint64_t>(stod(argv[2])); // 5e8 reads as well as 500000000
+    if (argc > 3) spec.roomsX = stoi(argv[3]);
+    if (argc > 4) spec.roomsY = stoi(argv[4]);
+    if (argc > 5) spec.seed = static_cast<uint32_t>(stoul(argv[5]));
+
+    KKRecons::SyntheticBuilding building(spec);
+    printf("rooms: %d x %d  surfaces: %zu  points: %llu\n", spec.roomsX, spec.roomsY, building.numSurfaces(),
+           static_cast<unsigned long long>(spec.numPoints));
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    if (!building.write(argv[1])) {
+        fprintf(stderr, "cannot write %s\n", argv[1]);
+        return 1;
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    printf("%s written in %.3f s, %.0f points/s\n", argv[1], seconds, spec.numPoints / seconds);
+    return 0;
+}
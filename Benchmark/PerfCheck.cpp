@@ -0,0 +1,52 @@
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <yaml-cpp/yaml.h>
+#include <ThroughputCheck.h>
+
+using namespace std;
+
+// items per second of every stage of a perf report against a baseline report of the same scan, fails on a regression.
+// The items are points up to the region growing and planes or clusters after it
+// usage: PerfCheck <report.json> <baseline.json> [config = ./config.yaml]
+// exit code: 0 all stages within the tolerance, 1 a stage regressed or is missing, 2 bad input
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        printf("usage: PerfCheck <report.json> <baseline.json> [config = ./config.yaml]\n");
+        return 2;
+    }
+    double tolerance = 0.15, minSeconds = 0.05;
+    try {
+        YAML::Node report = YAML::LoadFile(argc > 3 ? argv[3] : "./config.yaml")["Report"];
+        if (report && report["RegressionTolerance"]) tolerance = report["RegressionTolerance"].as<double>();
+        if (report && report["RegressionMinSeconds"]) minSeconds = report["RegressionMinSeconds"].as<double>();
+    }
+    catch (const YAML::Exception &e) {
+        fprintf(stderr, "cannot read the config: %s\n", e.what());
+        return 2;
+    }
+    vector<KKRecons::StageRecord> current, baseline;
+    size_t currentPoints = 0, baselinePoints = 0;
+    if (!KKRecons::readPerfReport(argv[1], current, &currentPoints) ||
+        !KKRecons::readPerfReport(argv[2], baseline, &baselinePoints)) {
+        fprintf(stderr, "cannot read the reports %s and %s\n", argv[1], argv[2]);
+        return 2;
+    }
+    // rates of planes and clusters only compare between runs of the same scan
+    if (currentPoints > 0 && baselinePoints > 0 && currentPoints != baselinePoints) {
+        fprintf(stderr, "the report is of %zu input points and the baseline of %zu\n", currentPoints, baselinePoints);
+        return 2;
+    }
+
+    vector<KKRecons::StageThroughput> stages = KKRecons::compareThroughput(baseline, current, tolerance, minSeconds);
+    int failures = 0;
+    printf("input points: %zu  tolerance: %.0f%%  min stage time: %.3f s\n", currentPoints, tolerance * 100, minSeconds);
+    printf("%-16s %16s %16s %9s\n", "stage", "baseline items/s", "current items/s", "change");
+    for (auto &s : stages) {
+        const char *verdict = s.isMissing ? "MISSING" : s.isRegressed ? "REGRESSED" : s.isSkipped ? "skipped" : "ok";
+        printf("%-16s %16.0f %16.0f %+8.1f%% %s\n", s.name.c_str(), s.baseline, s.current, s.change() * 100, verdict);
+        if (s.isMissing || s.isRegressed) ++failures;
+    }
+    if (failures > 0) printf("%d stage(s) regressed beyond the tolerance\n", failures);
+    return failures > 0 ? 1 : 0;
+}
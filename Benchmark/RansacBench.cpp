@@ -0,0 +1,102 @@
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <pcl/point_types.h>
+#include <pcl/point_cloud.h>
+#include <pcl/ModelCoefficients.h>
+#include <pcl/sample_consensus/sac_model_plane.h>
+#include <pcl/segmentation/sac_segmentation.h>
+#include <PlaneRansac.h>
+
+using namespace std;
+typedef pcl::PointXYZRGBNormal PointT;
+
+// hypotheses per second of the pcl plane model against the SoA kernels, and a full plane fit of both
+// usage: RansacBench [numPoints = 100000] [numHypotheses = 500]
+int main(int argc, char** argv) {
+    size_t numPoints = argc > 1 ? stoul(argv[1]) : 100000;
+    int numHypotheses = argc > 2 ? stoi(argv[2]) : 500;
+    const float threshold = 0.05f;
+
+    // a wall with 30% clutter, like a region growing cluster
+    mt19937 rng(42);
+    uniform_real_distribution<float> unit(0, 1);
+    pcl::PointCloud<PointT>::Ptr cloud(new pcl::PointCloud<PointT>);
+    for (size_t i = 0; i < numPoints; ++i) {
+        PointT p;
+        p.x = 5 * unit(rng);
+        p.z = 3 * unit(rng);
+        p.y = 0.2f * p.x + 0.02f * (unit(rng) - 0.5f);
+        if (unit(rng) < 0.3f) p.y += unit(rng);
+        cloud->push_back(p);
+    }
+    vector<Eigen::Vector4f> hypotheses;
+    for (int h = 0; h < numHypotheses; ++h) {
+        Eigen::Vector3f normal(unit(rng) - 0.5f, unit(rng) - 0.5f, unit(rng) - 0.5f);
+        normal.normalize();
+        const PointT &p = cloud->points[rng() % numPoints];
+        hypotheses.push_back(Eigen::Vector4f(normal[0], normal[1], normal[2], -normal.dot(p.getVector3fMap())));
+    }
+
+    auto report = [&](const string &name, double seconds, size_t checksum) {
+        printf("%-22s %12.0f hypotheses/s  %10.3f ms  (inliers %zu)\n", name.c_str(), numHypotheses / seconds, seconds * 1000, checksum);
+    };
+    typedef chrono::steady_clock Clock;
+    printf("points: %zu  hypotheses: %d\n", numPoints, numHypotheses);
+
+    pcl::SampleConsensusModelPlane<PointT> model(cloud);
+    Clock::time_point start = Clock::now();
+    size_t checksum = 0;
+    for (auto &h : hypotheses) checksum += model.countWithinDistance(Eigen::VectorXf(h), threshold);
+    report("pcl plane model", chrono::duration<double>(Clock::now() - start).count(), checksum);
+
+    KKRecons::PlaneRansac ransac;
+    ransac.setInputCloud(*cloud);
+    const KKRecons::ScoreKernel kernels[] = {KKRecons::ScoreKernel_Scalar, KKRecons::ScoreKernel_AVX2, KKRecons::ScoreKernel_AVX512};
+    const char* names[] = {"SoA scalar", "SoA AVX2", "SoA AVX-512"};
+    for (int k = 0; k < 3; ++k) {
+        ransac.setKernel(kernels[k]);
+        if (ransac.kernel() != kernels[k]) {
+            printf("%-22s not supported by this cpu\n", names[k]);
+            continue;
+        }
+        start = Clock::now();
+        checksum = 0;
+        for (auto &h : hypotheses) checksum += ransac.countWithinDistance(h, threshold);
+        report(names[k], chrono::duration<double>(Clock::now() - start).count(), checksum);
+        // the way segment() scores, a batch of hypotheses per pass over the points
+        vector<size_t> counts(hypotheses.size());
+        start = Clock::now();
+        ransac.countWithinDistance(hypotheses.data(), numHypotheses, threshold, counts.data());
+        double seconds = chrono::duration<double>(Clock::now() - start).count();
+        checksum = 0;
+        for (size_t count : counts) checksum += count;
+        report(string(names[k]) + " batched", seconds, checksum);
+    }
+
+    // the whole fit as calculateRANSAC_plane used to run it and as it runs now
+    pcl::SACSegmentation<PointT> seg(false);
+    seg.setOptimizeCoefficients(true);
+    seg.setModelType(pcl::SACMODEL_PLANE);
+    seg.setMethodType(pcl::SAC_RANSAC);
+    seg.setDistanceThreshold(threshold);
+    seg.setInputCloud(cloud);
+    pcl::PointIndices inliers;
+    pcl::ModelCoefficients coefficients;
+    start = Clock::now();
+    seg.segment(inliers, coefficients);
+    printf("%-22s %10.3f ms  (inliers %zu)\n", "SACSegmentation", chrono::duration<double>(Clock::now() - start).count() * 1000, inliers.indices.size());
+
+    ransac.setKernel(KKRecons::ScoreKernel_Auto);
+    ransac.setDistanceThreshold(threshold);
+    vector<int> engineInliers;
+    Eigen::Vector4f engineCoefficients;
+    start = Clock::now();
+    ransac.setInputCloud(*cloud);
+    ransac.segment(engineInliers, engineCoefficients);
+    printf("%-22s %10.3f ms  (inliers %zu, %d hypotheses)\n", "PlaneRansac", chrono::duration<double>(Clock::now() - start).count() * 1000, engineInliers.size(), ransac.iterations());
+    return 0;
+}
@@ -0,0 +1,229 @@
+#include <random>
+#include <string>
+#include <vector>
+#include <benchmark/benchmark.h>
+#include <pcl/point_types.h>
+#include <pcl/point_cloud.h>
+#include <Plane.h>
+#include <PlaneSet.h>
+#include <PlaneRansac.h>
+#include <KnnGraph.h>
+#include <NormalEstimation.h>
+#include <RegionGrowingEngine.h>
+#include <VoxelGridEngine.h>
+#include <DxfExporter.h>
+
+using namespace std;
+
+// the kernels of the pipeline on synthetic rooms, parameterized over the number of points or planes.
+// usage: ReconBench [--benchmark_filter=<regex>] [other google benchmark flags]
+
+namespace {
+    // the floor, the ceiling and the 4 walls of an 8 x 6 x 3 m room, each surface gets points by its area,
+    // 1 cm of noise along its normal
+    PointCloudT::Ptr makeRoom(size_t numPoints, uint32_t seed = 42) {
+        const float width = 8, depth = 6, height = 3, noise = 0.01f;
+        const float floorArea = width * depth, longWall = width * height, shortWall = depth * height;
+        const float total = 2 * floorArea + 2 * longWall + 2 * shortWall;
+        mt19937 rng(seed);
+        uniform_real_distribution<float> unit(0, 1);
+        PointCloudT::Ptr cloud(new PointCloudT);
+        cloud->points.reserve(numPoints);
+        for (size_t i = 0; i < numPoints; ++i) {
+            float pick = unit(rng) * total, u = unit(rng), v = unit(rng), e = noise * (unit(rng) - 0.5f);
+            PointT p;
+            if (pick < 2 * floorArea) { p.x = u * width; p.y = v * depth; p.z = (pick < floorArea ? 0 : height) + e; }
+            else if (pick < 2 * floorArea + 2 * longWall) {
+                p.x = u * width; p.z = v * height; p.y = (pick < 2 * floorArea + longWall ? 0 : depth) + e;
+            }
+            else { p.y = u * depth; p.z = v * height; p.x = (pick < total - shortWall ? 0 : width) + e; }
+            p.rgba = 0xffffffff;
+            cloud->push_back(p);
+        }
+        return cloud;
+    }
+
+    // a wall 10 m along y = 0.5 x, 3 m high, with 30% clutter up to 1 m in front of it, like a region growing cluster
+    PointCloudT::Ptr makeWall(size_t numPoints, uint32_t seed = 42) {
+        mt19937 rng(seed);
+        uniform_real_distribution<float> unit(0, 1);
+        PointCloudT::Ptr cloud(new PointCloudT);
+        cloud->points.reserve(numPoints);
+        for (size_t i = 0; i < numPoints; ++i) {
+            PointT p;
+            p.x = 10 * unit(rng) / 1.118034f;
+            p.z = 3 * unit(rng);
+            p.y = 0.5f * p.x + 0.02f * (unit(rng) - 0.5f);
+            if (unit(rng) < 0.3f) p.y += unit(rng);
+            p.rgba = 0xffffffff;
+            cloud->push_back(p);
+        }
+        return cloud;
+    }
+
+    const Eigen::Vector4d wallPlane(0.4472136, -0.8944272, 0, 0); // y = 0.5 x
+
+    // numPlanes wall segments 1 to 3 m long scattered over a floor that keeps about 4 planes per 10 x 10 m
+    void makePlaneSet(size_t numPlanes, KKRecons::PlaneSet &set, uint32_t seed = 42) {
+        mt19937 rng(seed);
+        uniform_real_distribution<float> unit(0, 1);
+        const float side = 5 * sqrt(static_cast<float>(numPlanes));
+        for (size_t i = 0; i < numPlanes; ++i) {
+            float x = side * unit(rng), y = side * unit(rng), angle = 6.2831853f * unit(rng), length = 1 + 2 * unit(rng);
+            set.leftX.push_back(x);
+            set.leftY.push_back(y);
+            set.rightX.push_back(x + length * cos(angle));
+            set.rightY.push_back(y + length * sin(angle));
+            set.group.push_back(-1);
+        }
+    }
+
+    void setPointRate(benchmark::State &state, size_t points) {
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * points));
+    }
+}
+
+// Reconstruction::downSampling in memory
+static void VoxelGrid(benchmark::State &state) {
+    PointCloudT::Ptr room = makeRoom(state.range(0));
+    PointCloudT output;
+    for (auto _ : state) {
+        KKRecons::voxelGridFilter(*room, 0.05f, output);
+        benchmark::DoNotOptimize(output.points.data());
+    }
+    state.counters["kept"] = output.size();
+    setPointRate(state, room->size());
+}
+BENCHMARK(VoxelGrid)->RangeMultiplier(8)->Range(1 << 14, 1 << 20)->Unit(benchmark::kMillisecond);
+
+// the neighbour queries Reconstruction shares between the normals and the region growing
+static void KnnGraphBuild(benchmark::State &state) {
+    PointCloudT::Ptr room = makeRoom(state.range(0));
+    KKRecons::KnnGraph<PointT> graph;
+    for (auto _ : state) {
+        graph.build(room, 10);
+    }
+    setPointRate(state, room->size());
+}
+BENCHMARK(KnnGraphBuild)->RangeMultiplier(8)->Range(1 << 14, 1 << 20)->Unit(benchmark::kMillisecond);
+
+// Reconstruction::calculateNormals once the kNN graph is there
+static void NormalEstimation(benchmark::State &state) {
+    PointCloudT::Ptr room = makeRoom(state.range(0));
+    KKRecons::KnnGraph<PointT> graph;
+    graph.build(room, 10);
+    for (auto _ : state) {
+        KKRecons::estimateNormals(*room, graph, 10);
+    }
+    setPointRate(state, room->size());
+}
+BENCHMARK(NormalEstimation)->RangeMultiplier(8)->Range(1 << 14, 1 << 20)->Unit(benchmark::kMillisecond);
+
+// Reconstruction::applyRegionGrow with the config.yaml parameters, once the graph and the normals are there
+static void RegionGrowing(benchmark::State &state) {
+    PointCloudT::Ptr room = makeRoom(state.range(0));
+    KKRecons::KnnGraph<PointT> graph;
+    graph.build(room, 30);
+    KKRecons::estimateNormals(*room, graph, 10);
+    vector<pcl::PointIndices> clusters;
+    for (auto _ : state) {
+        KKRecons::growRegions(*room, graph, 30, static_cast<float>(2 / 180.0 * M_PI), 5, clusters);
+    }
+    state.counters["clusters"] = clusters.size();
+    setPointRate(state, room->size());
+}
+BENCHMARK(RegionGrowing)->RangeMultiplier(8)->Range(1 << 14, 1 << 20)->Unit(benchmark::kMillisecond);
+
+// Reconstruction::calculateRANSAC_plane on one cluster
+static void RansacPlane(benchmark::State &state) {
+    PointCloudT::Ptr wall = makeWall(state.range(0));
+    vector<int> cluster(wall->size());
+    for (size_t i = 0; i < cluster.size(); ++i) cluster[i] = static_cast<int>(i);
+    vector<int> inliers;
+    Eigen::Vector4f coefficients;
+    for (auto _ : state) {
+        KKRecons::PlaneRansac ransac;
+        ransac.setInputCloud(*wall, cluster);
+        ransac.setDistanceThreshold(0.25f);
+        ransac.segment(inliers, coefficients, 12345);
+    }
+    state.counters["inliers"] = inliers.size();
+    setPointRate(state, wall->size());
+}
+BENCHMARK(RansacPlane)->RangeMultiplier(8)->Range(1 << 14, 1 << 20)->Unit(benchmark::kMillisecond);
+
+// Plane::filledPlane and the grid points it stands for, at the pointPitch of config.yaml
+static void FilledPlane(benchmark::State &state) {
+    PointCloudT::Ptr wall = makeWall(state.range(0));
+    Plane source(wall, wallPlane);
+    PointCloudT points;
+    for (auto _ : state) {
+        state.PauseTiming();
+        Plane plane(source);
+        points.clear();
+        state.ResumeTiming();
+        plane.filledPlane(20);
+        plane.appendPointsTo(points);
+    }
+    state.counters["gridPoints"] = points.size();
+    setPointRate(state, wall->size());
+}
+BENCHMARK(FilledPlane)->RangeMultiplier(8)->Range(1 << 14, 1 << 20)->Unit(benchmark::kMillisecond);
+
+// Plane::removePointWithin of the boxes of the planes a group covers, all boxes in one pass
+static void RemovePointWithin(benchmark::State &state) {
+    PointCloudT::Ptr wall = makeWall(state.range(0));
+    const size_t numBoxes = state.range(1);
+    vector<KKRecons::PointBox> boxes;
+    for (size_t b = 0; b < numBoxes; ++b) {
+        float x = 8.0f * b / numBoxes;
+        KKRecons::PointBox box = {x, x + 0.5f, -1, 10, 0.5f, 2.5f};
+        boxes.push_back(box);
+    }
+    size_t kept = 0;
+    for (auto _ : state) {
+        state.PauseTiming();
+        Plane plane(wall, wallPlane);
+        state.ResumeTiming();
+        plane.removePointsWithin(boxes);
+        kept = plane.size();
+    }
+    state.counters["kept"] = kept;
+    setPointRate(state, wall->size());
+}
+BENCHMARK(RemovePointWithin)->RangeMultiplier(8)->Ranges({{1 << 14, 1 << 20}, {1, 64}})->Unit(benchmark::kMillisecond);
+
+// the near planes filter of extract_walls, every plane against the corners around it
+static void FindNearPlanes(benchmark::State &state) {
+    KKRecons::PlaneSet set;
+    makePlaneSet(state.range(0), set);
+    vector<char> hasNear;
+    for (auto _ : state) {
+        set.anyNearCorners(1.0f, hasNear);
+        benchmark::DoNotOptimize(hasNear.data());
+    }
+    setPointRate(state, set.size());
+}
+BENCHMARK(FindNearPlanes)->RangeMultiplier(10)->Range(100, 100000);
+
+// DxfExporter::exportDXF of one face per plane
+static void ExportDXF(benchmark::State &state) {
+    KKRecons::DxfExporter exporter("ReconBench");
+    mt19937 rng(42);
+    uniform_real_distribution<float> unit(0, 100);
+    for (int64_t f = 0; f < state.range(0); ++f) {
+        Point a, b, c, d;
+        a.x = unit(rng); a.y = unit(rng); a.z = 0;
+        b = a; b.z = 3;
+        c.x = a.x + 1; c.y = a.y; c.z = 3;
+        d = c; d.z = 0;
+        exporter.insert(DxfFace(a, b, c, d));
+    }
+    for (auto _ : state) {
+        exporter.exportDXF("./");
+    }
+    setPointRate(state, exporter.size());
+}
+BENCHMARK(ExportDXF)->RangeMultiplier(10)->Range(100, 100000)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
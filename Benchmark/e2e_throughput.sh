@@ -0,0 +1,24 @@
+#!/bin/sh
+# end-to-end throughput of extractWall on a synthetic building, fails when a stage regresses against a baseline
+# usage, from the source directory: Benchmark/e2e_throughput.sh <build dir> [numPoints = 1e6] [baseline]
+# the baseline defaults to Benchmark/baseline_<numPoints>.json and is recorded by the first run without one.
+# the tolerance is Report/RegressionTolerance of Benchmark/e2e_config.yaml
+set -e
+BUILD=${1:?usage: $0 <build dir> [numPoints] [baseline]}
+POINTS=${2:-1e6}
+BASELINE=${3:-Benchmark/baseline_$POINTS.json}
+CONFIG=Benchmark/e2e_config.yaml
+SCAN=OutputData/synthetic_$POINTS.ply
+REPORT=OutputData/e2e_report.json
+
+mkdir -p OutputData
+[ -f "$SCAN" ] || "$BUILD/GenerateBuilding" "$SCAN" "$POINTS"
+rm -f "$SCAN".*kkc # a cached cloud would skip the load and the downsampling
+"$BUILD/extractWall" "$SCAN" "$CONFIG"
+
+if [ ! -f "$BASELINE" ]; then
+    cp "$REPORT" "$BASELINE"
+    echo "no baseline yet, recorded $BASELINE"
+    exit 0
+fi
+"$BUILD/PerfCheck" "$REPORT" "$BASELINE" "$CONFIG"
@@ -4,8 +4,39 @@
 
 #include <gtest/gtest.h>
 #include <DxfExporter.h>
+#include <PointLoader.h>
+#include <CloudCache.h>
+#include <TiledVoxelFilter.h>
+#include <VoxelGridEngine.h>
+#include <VoxelAccumulator.h>
+#include <KnnGraph.h>
+#include <RegionGrowingEngine.h>
+#include <PlaneRansac.h>
+#include <Parallel.h>
+#include <Reconstruction.h>
+#include <Plane.h>
+#include <PlaneSet.h>
+#include <QuadRaster.h>
+#include <BoxRemoval.h>
+#include <CeilingFill.h>
+#include <CloudStats.h>
+#include <EfficientRansac.h>
+#include <PerfReport.h>
+#include <ThroughputCheck.h>
+#include <SyntheticBuilding.h>
+#include <pcl/search/kdtree.h>
+#include <pcl/common/common.h>
+#include <pcl/common/transforms.h>
+#include <map>
+#include <climits>
+#include <functional>
+#include <random>
+#include <algorithm>
+#include <cfloat>
+#include <tuple>
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <yaml-cpp/yaml.h>
 //#include <pcl/point_types.h>
 using namespace std;
@@ -71,6 +102,1192 @@ TEST(DXF, Export) {
     ASSERT_NE(file, nullptr);
 }
 
+TEST(Loader, ParseFields) {
+    float values[7];
+    string line = "1.5,-2,3e2,255,10,20,30\r";
+    ASSERT_TRUE(KKRecons::parseFloatFields(line.data(), line.data() + line.size(), ',', values, 7));
+    ASSERT_EQ(values[0], 1.5f); ASSERT_EQ(values[1], -2.0f); ASSERT_EQ(values[2], 300.0f); ASSERT_EQ(values[6], 30.0f);
+    line = "1 2 3 4 5 6";
+    ASSERT_FALSE(KKRecons::parseFloatFields(line.data(), line.data() + line.size(), ' ', values, 7));
+    line = "1,2,x,4,5,6,7";
+    ASSERT_FALSE(KKRecons::parseFloatFields(line.data(), line.data() + line.size(), ',', values, 7));
+}
+
+TEST(Loader, LoadTxt) {
+    ofstream file("testLoader.txt");
+    file << "0,1,2,255,10,20,30\n" << "broken line\n" << "3,4,5,128,40,50,60\n";
+    file.close();
+    pcl::PointCloud<pcl::PointXYZRGBNormal> cloud;
+    ASSERT_EQ(KKRecons::loadAsciiPoints("testLoader.txt", KKRecons::Ascii_CommaXYZARGB, cloud, 2), 1);
+    ASSERT_EQ(cloud.size(), 2);
+    ASSERT_EQ(cloud.points[1].x, 3); ASSERT_EQ(cloud.points[1].z, 5);
+    ASSERT_EQ(cloud.points[1].a, 128); ASSERT_EQ(cloud.points[1].b, 60);
+    // the scanner dumps of DownSampling are space separated and their alpha is halved
+    file.open("testLoader.txt");
+    file << "0 1 2 255 10 20 30\n" << "3 4 5 128 40 50 60\n" << "6,7,8,9,1,2,3\n";
+    file.close();
+    pcl::PointCloud<pcl::PointXYZRGB> scan;
+    ASSERT_EQ(KKRecons::loadAsciiPoints("testLoader.txt", KKRecons::Ascii_SpaceXYZARGB, scan, 2), 1);
+    ASSERT_EQ(scan.size(), 2);
+    ASSERT_EQ(scan.points[0].a, 127); ASSERT_EQ(scan.points[1].a, 64);
+    ASSERT_EQ(scan.points[1].x, 3); ASSERT_EQ(scan.points[1].g, 50);
+}
+
+TEST(Loader, ChunkReader) {
+    ofstream file("testLoader.txt");
+    for (int i = 0; i < 25; ++i) {
+        file << i << ' ' << 2 * i << " 0 " << 2 * i << " 1 2 3\n";
+        if (i % 7 == 3) file << "broken line\n";
+    }
+    file.close();
+    pcl::PointCloud<pcl::PointXYZRGB> whole;
+    long skipped = KKRecons::loadAsciiPoints("testLoader.txt", KKRecons::Ascii_SpaceXYZARGB, whole, 2);
+    ASSERT_EQ(skipped, 4);
+    KKRecons::AsciiChunkReader reader;
+    ASSERT_TRUE(reader.open("testLoader.txt", KKRecons::Ascii_SpaceXYZARGB));
+    pcl::PointCloud<pcl::PointXYZRGB> chunk;
+    size_t read = 0;
+    int chunks = 0;
+    while (reader.next(chunk, 10)) {
+        ASSERT_LE(chunk.size(), 10);
+        ASSERT_EQ(chunk.width, chunk.size());
+        for (size_t i = 0; i < chunk.size(); ++i, ++read) {
+            ASSERT_EQ(chunk.points[i].x, whole.points[read].x);
+            ASSERT_EQ(chunk.points[i].a, whole.points[read].a);
+        }
+        chunks++;
+    }
+    ASSERT_EQ(read, whole.size());
+    ASSERT_EQ(chunks, 3);
+    ASSERT_EQ(reader.droppedLines(), skipped);
+    ASSERT_FALSE(reader.open("testLoaderMissing.txt", KKRecons::Ascii_SpaceXYZARGB));
+}
+
+TEST(Cache, WriteAndReload) {
+    ofstream source("testCacheSource.txt");
+    source << "0,0,0,255,1,2,3\n";
+    source.close();
+    pcl::PointCloud<pcl::PointXYZRGBNormal> cloud;
+    for (int i = 0; i < 100; ++i) {
+        pcl::PointXYZRGBNormal p;
+        p.x = i; p.y = -i; p.z = 0.5f * i;
+        p.r = i; p.g = 2 * i; p.b = 255 - i;
+        p.normal_z = 1; p.curvature = 0.01f * i;
+        cloud.push_back(p);
+    }
+    string path = KKRecons::CloudCache::cachePath("testCacheSource.txt", 0.05f);
+    ASSERT_TRUE(KKRecons::CloudCache::write(path, "testCacheSource.txt", cloud, 0.05f, 10, true));
+    KKRecons::CloudCache cache;
+    ASSERT_TRUE(cache.open(path));
+    ASSERT_TRUE(cache.isFresh("testCacheSource.txt", 0.05f));
+    ASSERT_FALSE(cache.isFresh("testCacheSource.txt", 0.1f));
+    // the out-of-core engine orders its voxels differently, so it has a cache of its own
+    ASSERT_FALSE(cache.isFresh("testCacheSource.txt", 0.05f, KKRecons::VoxelEngine_Tiled));
+    ASSERT_NE(KKRecons::CloudCache::cachePath("testCacheSource.txt", 0.05f, KKRecons::VoxelEngine_Tiled), path);
+    ASSERT_EQ(cache.size(), 100);
+    ASSERT_EQ(cache.header().kSearch, 10);
+    ASSERT_EQ(cache.header().max[0], 99); ASSERT_EQ(cache.header().min[1], -99);
+    pcl::PointCloud<pcl::PointXYZRGBNormal> reloaded;
+    cache.toPointCloud(reloaded, 2);
+    ASSERT_EQ(reloaded.size(), 100);
+    ASSERT_EQ(reloaded.points[42].y, -42); ASSERT_EQ(reloaded.points[42].g, 84);
+    ASSERT_EQ(reloaded.points[42].rgba, cloud.points[42].rgba);
+    ASSERT_EQ(reloaded.points[42].curvature, cloud.points[42].curvature);
+}
+
+TEST(Voxel, TiledMatchesInMemory) {
+    pcl::PointCloud<pcl::PointXYZRGB> cloud;
+    for (int i = 0; i < 200000; ++i) {
+        pcl::PointXYZRGB p;
+        p.x = (float)(rand() % 40000) / 1000 - 20; p.y = (float)(rand() % 40000) / 1000 - 20; p.z = (float)(rand() % 3000) / 1000;
+        p.r = rand() % 255;
+        cloud.push_back(p);
+    }
+    // 1MB forces spilling and splitting of tiles, 1GB keeps everything in memory
+    KKRecons::TiledVoxelFilter<pcl::PointXYZRGB> spilled(0.1f, 1 << 20, "./", 64);
+    KKRecons::TiledVoxelFilter<pcl::PointXYZRGB> inMemory(0.1f, 1 << 30, "./", 64);
+    spilled.add(cloud);
+    inMemory.add(cloud);
+    pcl::PointCloud<pcl::PointXYZRGB> a, b;
+    spilled.filter(a);
+    inMemory.filter(b);
+    // split tiles emit their voxels in a different order
+    auto byPosition = [](const pcl::PointXYZRGB &l, const pcl::PointXYZRGB &r) {
+        return l.z != r.z ? l.z < r.z : l.y != r.y ? l.y < r.y : l.x < r.x;
+    };
+    sort(a.points.begin(), a.points.end(), byPosition);
+    sort(b.points.begin(), b.points.end(), byPosition);
+    ASSERT_EQ(a.size(), b.size());
+    for (size_t i = 0; i < a.size(); ++i) {
+        ASSERT_EQ(a.points[i].x, b.points[i].x);
+        ASSERT_EQ(a.points[i].r, b.points[i].r);
+    }
+}
+
+TEST(Voxel, StreamedLoadMatchesDownSampling) {
+    ofstream file("testStreamedLoad.txt");
+    for (int i = 0; i < 20000; ++i) {
+        file << (rand() % 8000) / 1000.0f << ',' << (rand() % 8000) / 1000.0f << ',' << (rand() % 3000) / 1000.0f
+             << ",255," << rand() % 255 << ",0,0\n";
+    }
+    file.close();
+    Reconstruction loaded("testStreamedLoad.txt");
+    loaded.isPrintDebugInfo = false;
+    loaded.downSampling(0.1f, 1);
+    // the raw points go straight from the file into the tiles
+    Reconstruction streamed("testStreamedLoad.txt", 0.1f, 1);
+    ASSERT_EQ(streamed.perfReport.inputPoints(), 20000);
+    ASSERT_EQ(streamed.pointCloud->size(), loaded.pointCloud->size());
+    for (size_t i = 0; i < streamed.pointCloud->size(); ++i) {
+        ASSERT_EQ(streamed.pointCloud->points[i].x, loaded.pointCloud->points[i].x);
+        ASSERT_EQ(streamed.pointCloud->points[i].r, loaded.pointCloud->points[i].r);
+    }
+    ASSERT_THROW(Reconstruction("testStreamedLoad.txt", 0.1f, 0), invalid_argument);
+}
+
+TEST(Voxel, EngineMatchesReference) {
+    pcl::PointCloud<pcl::PointXYZRGBNormal> cloud;
+    for (int i = 0; i < 100000; ++i) {
+        pcl::PointXYZRGBNormal p;
+        p.x = (float)(rand() % 20000) / 1000 - 10; p.y = (float)(rand() % 20000) / 1000 - 10; p.z = (float)(rand() % 3000) / 1000;
+        p.r = rand() % 255; p.normal_z = 1;
+        if (i % 997 == 0) p.x = NAN;
+        cloud.push_back(p);
+    }
+    // z major voxel order, the order pcl::VoxelGrid writes its voxels in
+    map<tuple<int64_t, int64_t, int64_t>, KKRecons::VoxelAccumulator> reference;
+    for (auto &p : cloud.points) {
+        int64_t ijk[3];
+        if (KKRecons::voxelCoordinates(p, 1.0f / 0.1f, ijk)) reference[make_tuple(ijk[2], ijk[1], ijk[0])].add(p);
+    }
+    for (int threads : {1, 4}) {
+        pcl::PointCloud<pcl::PointXYZRGBNormal> output;
+        KKRecons::voxelGridFilter(cloud, 0.1f, output, threads);
+        ASSERT_EQ(output.size(), reference.size());
+        size_t i = 0;
+        for (auto &voxel : reference) {
+            pcl::PointXYZRGBNormal expected;
+            voxel.second.get(expected);
+            ASSERT_EQ(output.points[i].x, expected.x); ASSERT_EQ(output.points[i].z, expected.z);
+            ASSERT_EQ(output.points[i].r, expected.r); ASSERT_EQ(output.points[i].normal_z, expected.normal_z);
+            i++;
+        }
+    }
+}
+
+TEST(Knn, GraphMatchesSearch) {
+    pcl::PointCloud<pcl::PointXYZRGBNormal>::Ptr cloud(new pcl::PointCloud<pcl::PointXYZRGBNormal>);
+    for (int i = 0; i < 5000; ++i) {
+        pcl::PointXYZRGBNormal p;
+        p.x = (float)(rand() % 10000) / 1000; p.y = (float)(rand() % 10000) / 1000; p.z = (float)(rand() % 3000) / 1000;
+        if (i % 499 == 0) p.z = NAN;
+        cloud->push_back(p);
+    }
+    cloud->is_dense = false;
+    KKRecons::KnnGraph<pcl::PointXYZRGBNormal> graph;
+    graph.build(cloud, 12, 3);
+    pcl::search::KdTree<pcl::PointXYZRGBNormal> tree;
+    tree.setInputCloud(cloud);
+    vector<int> indices;
+    vector<float> dists;
+    ASSERT_EQ(graph.size(), cloud->size());
+    for (size_t i = 0; i < cloud->size(); ++i) {
+        if (i % 499 == 0) { ASSERT_EQ(graph.count(i), 0); continue; }
+        tree.nearestKSearch(cloud->points[i], 12, indices, dists);
+        ASSERT_EQ(vector<int>(graph.begin(i), graph.end(i)), indices);
+    }
+    // fewer points than k
+    cloud->resize(5);
+    graph.build(cloud, 12);
+    ASSERT_EQ(graph.count(1), 4);
+    ASSERT_EQ(*graph.begin(1), 1);
+}
+
+TEST(Region, GrowSplitsPlanes) {
+    pcl::PointCloud<pcl::PointXYZRGBNormal>::Ptr cloud(new pcl::PointCloud<pcl::PointXYZRGBNormal>);
+    // a floor, a wall standing on it and a separate floor further away, every 50th floor point may not grow
+    for (int i = 0; i < 6000; ++i) {
+        pcl::PointXYZRGBNormal p;
+        p.y = (float)(rand() % 4000) / 1000;
+        p.curvature = 0.01f;
+        if (i < 3000) { p.x = (float)(rand() % 4000) / 1000; p.normal_z = 1; if (i % 50 == 0) p.curvature = 0.5f; }
+        else if (i < 5000) { p.x = 2; p.z = 0.2f + (float)(rand() % 1800) / 1000; p.normal_x = 1; }
+        else { p.x = 6 + (float)(rand() % 2000) / 1000; p.normal_z = -1; }
+        cloud->push_back(p);
+    }
+    KKRecons::KnnGraph<pcl::PointXYZRGBNormal> graph;
+    graph.build(cloud, 12);
+    vector<pcl::PointIndices> single, multi;
+    size_t singlePushes = 0, multiPushes = 0;
+    KKRecons::growRegions(*cloud, graph, 10, 5 / 180.0 * M_PI, 0.1f, single, 1, &singlePushes);
+    KKRecons::growRegions(*cloud, graph, 10, 5 / 180.0 * M_PI, 0.1f, multi, 4, &multiPushes);
+    // every point that may grow is queued once, by its own slab
+    ASSERT_EQ(singlePushes, 6000 - 60);
+    ASSERT_EQ(multiPushes, singlePushes);
+    ASSERT_EQ(single.size(), 3);
+    ASSERT_EQ(single[0].indices.size(), 3000);
+    ASSERT_EQ(single[1].indices.size(), 2000);
+    ASSERT_EQ(single[2].indices.size(), 1000);
+    ASSERT_EQ(multi.size(), single.size());
+    for (size_t i = 0; i < single.size(); ++i) ASSERT_EQ(multi[i].indices, single[i].indices);
+}
+
+TEST(Region, SameForAnyOrderAndThreads) {
+    typedef pcl::PointXYZRGBNormal P;
+    // 0 lists 1 as its nearest neighbour, 1 lists 2 and not 0: one region whichever end is grown first
+    for (int order = 0; order < 2; ++order) {
+        pcl::PointCloud<P>::Ptr chain(new pcl::PointCloud<P>);
+        const float xs[2][3] = {{0, 1, 1.5f}, {1.5f, 1, 0}};
+        for (float x : xs[order]) {
+            P p;
+            p.x = x;
+            p.normal_z = 1;
+            p.curvature = 0;
+            chain->push_back(p);
+        }
+        KKRecons::KnnGraph<P> graph;
+        graph.build(chain, 2);
+        vector<pcl::PointIndices> clusters;
+        KKRecons::growRegions(*chain, graph, 2, 5 / 180.0 * M_PI, 0.1f, clusters, 1);
+        ASSERT_EQ(clusters.size(), 1);
+    }
+
+    // a floor of two normals mixed with points which may not grow, with kNN lists short enough to be asymmetric
+    mt19937 rng(3);
+    uniform_real_distribution<float> unit(0, 1);
+    pcl::PointCloud<P>::Ptr cloud(new pcl::PointCloud<P>);
+    for (int i = 0; i < 3000; ++i) {
+        P p;
+        p.x = 10 * unit(rng);
+        p.y = 10 * unit(rng);
+        p.z = 0;
+        p.normal_x = 0;
+        p.normal_y = i % 3 == 0 ? 0.5f : 0;
+        p.normal_z = i % 3 == 0 ? 0.8660254f : 1;
+        p.curvature = i % 17 == 0 ? 0.5f : 0.01f;
+        cloud->push_back(p);
+    }
+    const int k = 4;
+    const float smoothness = 5 / 180.0 * M_PI, curvature = 0.1f;
+    KKRecons::KnnGraph<P> graph;
+    graph.build(cloud, k);
+
+    // the regions as the connected seed points, each other point with the nearest seed that has it as a neighbour
+    auto isSeed = [&](int i) { return cloud->points[i].curvature <= curvature; };
+    auto isSmooth = [&](int a, int b) {
+        return fabs(cloud->points[a].getNormalVector3fMap().dot(cloud->points[b].getNormalVector3fMap())) >= cos(smoothness);
+    };
+    vector<int> parent(cloud->size());
+    for (size_t i = 0; i < parent.size(); ++i) parent[i] = static_cast<int>(i);
+    function<int(int)> root = [&](int i) { return parent[i] == i ? i : parent[i] = root(parent[i]); };
+    vector<float> nearest(cloud->size(), FLT_MAX);
+    vector<int> owner(cloud->size(), -1);
+    for (int a = 0; a < static_cast<int>(cloud->size()); ++a) {
+        if (!isSeed(a)) continue;
+        for (const int* nb = graph.begin(a); nb != graph.end(a); ++nb) {
+            if (!isSmooth(a, *nb)) continue;
+            if (isSeed(*nb)) {
+                int ra = root(a), rb = root(*nb);
+                parent[max(ra, rb)] = min(ra, rb);
+                continue;
+            }
+            float d = (cloud->points[a].getVector3fMap() - cloud->points[*nb].getVector3fMap()).squaredNorm();
+            if (d < nearest[*nb]) { nearest[*nb] = d; owner[*nb] = a; }
+        }
+    }
+    vector<int> expected(cloud->size());
+    for (size_t i = 0; i < expected.size(); ++i) expected[i] = owner[i] == -1 ? root(static_cast<int>(i)) : root(owner[i]);
+    // the label of a point as the smallest original index of its region
+    auto labels = [](const vector<pcl::PointIndices> &clusters, const vector<int> &original) {
+        vector<int> label(original.size());
+        for (auto &cluster : clusters) {
+            int smallest = INT_MAX;
+            for (int i : cluster.indices) smallest = min(smallest, original[i]);
+            for (int i : cluster.indices) label[original[i]] = smallest;
+        }
+        return label;
+    };
+    vector<int> identity(cloud->size());
+    for (size_t i = 0; i < identity.size(); ++i) identity[i] = static_cast<int>(i);
+    vector<int> smallest(cloud->size(), INT_MAX), reference(cloud->size());
+    for (size_t i = 0; i < expected.size(); ++i) smallest[expected[i]] = min(smallest[expected[i]], static_cast<int>(i));
+    for (size_t i = 0; i < expected.size(); ++i) reference[i] = smallest[expected[i]];
+
+    vector<pcl::PointIndices> single, multi, shuffled;
+    KKRecons::growRegions(*cloud, graph, k, smoothness, curvature, single, 1);
+    KKRecons::growRegions(*cloud, graph, k, smoothness, curvature, multi, 4);
+    vector<int> order = identity;
+    shuffle(order.begin(), order.end(), rng);
+    pcl::PointCloud<P>::Ptr permuted(new pcl::PointCloud<P>);
+    for (int i : order) permuted->push_back(cloud->points[i]);
+    KKRecons::KnnGraph<P> permutedGraph;
+    permutedGraph.build(permuted, k);
+    KKRecons::growRegions(*permuted, permutedGraph, k, smoothness, curvature, shuffled, 3);
+    ASSERT_GT(single.size(), 1);
+    ASSERT_EQ(labels(single, identity), reference);
+    ASSERT_EQ(labels(multi, identity), reference);
+    ASSERT_EQ(labels(shuffled, order), reference);
+}
+
+TEST(Ransac, KernelsAgreeAndFit) {
+    pcl::PointCloud<pcl::PointXYZRGBNormal> cloud;
+    for (int i = 0; i < 20003; ++i) {
+        pcl::PointXYZRGBNormal p;
+        p.x = (float)(rand() % 10000) / 1000; p.y = (float)(rand() % 10000) / 1000;
+        p.z = 0.3f * p.x - 0.2f * p.y + 1 + (float)(rand() % 100 - 50) / 1000;
+        if (i % 5 == 0) p.z += (float)(rand() % 3000) / 1000;
+        cloud.push_back(p);
+    }
+    KKRecons::PlaneRansac ransac;
+    ransac.setInputCloud(cloud);
+    Eigen::Vector4f plane(0.3f, -0.2f, -1, 1);
+    plane.normalize();
+    ransac.setKernel(KKRecons::ScoreKernel_Scalar);
+    size_t expected = ransac.countWithinDistance(plane, 0.03f);
+    for (auto kernel : {KKRecons::ScoreKernel_AVX2, KKRecons::ScoreKernel_AVX512}) {
+        ransac.setKernel(kernel);
+        ASSERT_EQ(ransac.countWithinDistance(plane, 0.03f), expected);
+    }
+    ransac.setKernel(KKRecons::ScoreKernel_Auto);
+    ransac.setDistanceThreshold(0.06f);
+    vector<int> inliers, again;
+    Eigen::Vector4f coefficients, sameSeed;
+    ASSERT_TRUE(ransac.segment(inliers, coefficients, 7));
+    ASSERT_GT(inliers.size(), 15000);
+    ASSERT_NEAR(fabs(coefficients.head<3>().dot(plane.head<3>()) / plane.head<3>().norm()), 1, 1e-3);
+    ASSERT_TRUE(ransac.segment(again, sameSeed, 7));
+    ASSERT_EQ(again, inliers);
+}
+
+TEST(Ransac, RatioSweep) {
+    pcl::PointCloud<pcl::PointXYZRGBNormal> cloud;
+    for (int i = 0; i < 20000; ++i) {
+        pcl::PointXYZRGBNormal p;
+        p.x = (float)(rand() % 5000) / 1000; p.z = (float)(rand() % 5000) / 1000;
+        p.y = 0.5f * p.x + (float)(rand() % 1000 - 500) / 1000;
+        cloud.push_back(p);
+    }
+    KKRecons::PlaneRansac ransac;
+    ransac.setInputCloud(cloud);
+    vector<int> inliers;
+    Eigen::Vector4f coefficients;
+    float threshold;
+    ASSERT_TRUE(ransac.segmentToRatio(0.8, 0.25f, 0.1f, 20, inliers, coefficients, threshold));
+    ASSERT_GE(inliers.size(), 16000);
+    ASSERT_EQ(ransac.countWithinDistance(coefficients, threshold), inliers.size());
+    ASSERT_LT(ransac.countWithinDistance(coefficients, threshold - 0.1f), 16000);
+    // the budget ends with a failure instead of looping
+    ASSERT_FALSE(ransac.segmentToRatio(0.8, 0.01f, 0.01f, 5, inliers, coefficients, threshold));
+    ASSERT_TRUE(inliers.empty());
+    ASSERT_LE(ransac.iterations(), 50);
+    // every kernel bins the sweep the same, whether the ratio is reached or not
+    for (float base : {0.25f, 0.001f}) {
+        ransac.setKernel(KKRecons::ScoreKernel_Scalar);
+        vector<int> expected;
+        Eigen::Vector4f expectedCoefficients;
+        float expectedThreshold;
+        bool isReached = ransac.segmentToRatio(0.6, base, base / 25, 20, expected, expectedCoefficients, expectedThreshold, 3);
+        ASSERT_EQ(isReached, base > 0.1f);
+        for (auto kernel : {KKRecons::ScoreKernel_AVX2, KKRecons::ScoreKernel_AVX512}) {
+            ransac.setKernel(kernel);
+            ASSERT_EQ(ransac.segmentToRatio(0.6, base, base / 25, 20, inliers, coefficients, threshold, 3), isReached);
+            ASSERT_EQ(inliers, expected);
+            ASSERT_TRUE(coefficients == expectedCoefficients || !isReached);
+            ASSERT_TRUE(threshold == expectedThreshold || !isReached);
+        }
+    }
+}
+
+TEST(Ransac, ClustersSameForAnyThreads) {
+    // per task seeds: the same draws whichever thread runs a task
+    vector<size_t> order(200);
+    for (size_t i = 0; i < order.size(); ++i) order[i] = order.size() - 1 - i;
+    vector<uint32_t> one(order.size()), many(order.size());
+    KKRecons::workStealingFor(order, 1, [&](size_t task, size_t) { one[task] = std::mt19937(task)(); });
+    KKRecons::workStealingFor(order, 4, [&](size_t task, size_t) { many[task] = std::mt19937(task)(); });
+    ASSERT_EQ(one, many);
+    // a throwing task reaches the caller instead of terminating
+    for (int threads = 1; threads <= 4; threads += 3) {
+        ASSERT_THROW(KKRecons::workStealingFor(order, threads, [](size_t task, size_t) {
+            if (task == 57) throw std::runtime_error("task 57");
+        }), std::runtime_error);
+    }
+
+    // clusters of different sizes on noisy walls and floors, a third of them off the plane
+    ofstream file("testRansacClusters.txt");
+    vector<pcl::PointIndices> clusters;
+    int n = 0;
+    for (int c = 0; c < 24; ++c) {
+        pcl::PointIndices cluster;
+        int size = 50 + (c * 397) % 3000;
+        for (int i = 0; i < size; ++i, ++n) {
+            float u = (rand() % 4000) * 0.001f, v = (rand() % 3000) * 0.001f;
+            float offset = i % 3 ? (rand() % 100 - 50) * 0.0002f : (rand() % 1000) * 0.001f;
+            if (c % 2) file << u + c << "," << offset + c << "," << v << ",255,1,2,3\n";
+            else file << u << "," << v + c << "," << offset << ",255,1,2,3\n";
+            cluster.indices.push_back(n);
+        }
+        clusters.push_back(cluster);
+    }
+    file.close();
+    auto planes = [&](int threads) {
+        Reconstruction re("testRansacClusters.txt");
+        re.isPrintDebugInfo = false;
+        re.numberOfThreads = threads;
+        re.clusters = clusters;
+        re.applyRANSACtoClusters(0.05f, 0.2f, 0.5f);
+        return re.ransacPlanes;
+    };
+    vector<Plane> serial = planes(1), parallel = planes(4);
+    ASSERT_GT(serial.size(), 10);
+    ASSERT_EQ(serial.size(), parallel.size());
+    for (size_t i = 0; i < serial.size(); ++i) {
+        ASSERT_TRUE(serial[i].abcd() == parallel[i].abcd()) << "plane " << i;
+        ASSERT_EQ(serial[i].orientation, parallel[i].orientation);
+        ASSERT_EQ(serial[i].size(), parallel[i].size()) << "plane " << i;
+        for (size_t j = 0; j < serial[i].size(); ++j) {
+            ASSERT_EQ(serial[i].point(j).x, parallel[i].point(j).x);
+            ASSERT_EQ(serial[i].point(j).y, parallel[i].point(j).y);
+            ASSERT_EQ(serial[i].point(j).z, parallel[i].point(j).z);
+        }
+    }
+}
+
+TEST(Ransac, EfficientSplitsCoplanarWalls) {
+    // a floor, two walls on the same plane with a gap between them and a third wall
+    pcl::PointCloud<pcl::PointXYZRGBNormal> cloud;
+    auto add = [&](int n, Eigen::Vector3f origin, Eigen::Vector3f u, Eigen::Vector3f v, Eigen::Vector3f normal) {
+        for (int i = 0; i < n; ++i) {
+            pcl::PointXYZRGBNormal p;
+            p.getVector3fMap() = origin + u * (float)(rand() % 1000) / 1000 + v * (float)(rand() % 1000) / 1000;
+            p.getNormalVector3fMap() = normal;
+            cloud.push_back(p);
+        }
+    };
+    add(20000, Eigen::Vector3f(0, 0, 0), Eigen::Vector3f(10, 0, 0), Eigen::Vector3f(0, 10, 0), Eigen::Vector3f(0, 0, 1));
+    add(10000, Eigen::Vector3f(0, 5, 0.5f), Eigen::Vector3f(3, 0, 0), Eigen::Vector3f(0, 0, 2), Eigen::Vector3f(0, 1, 0));
+    add(10000, Eigen::Vector3f(6, 5, 0.5f), Eigen::Vector3f(3, 0, 0), Eigen::Vector3f(0, 0, 2), Eigen::Vector3f(0, 1, 0));
+    add(10000, Eigen::Vector3f(8, 6, 0.5f), Eigen::Vector3f(0, 3, 0), Eigen::Vector3f(0, 0, 2), Eigen::Vector3f(1, 0, 0));
+    KKRecons::EfficientRansacParameters parameters;
+    parameters.distanceThreshold = 0.05f;
+    parameters.minSupport = 100;
+    vector<KKRecons::DetectedPlane> planes, planesThreaded;
+    KKRecons::detectPlanes(cloud, parameters, planes, 1);
+    ASSERT_EQ(planes.size(), 4);
+    vector<int> firstPoints;
+    for (auto &plane : planes) {
+        ASSERT_TRUE(std::is_sorted(plane.indices.begin(), plane.indices.end()));
+        firstPoints.push_back(plane.indices.front());
+        // every plane is one of the generated patches and holds all of it
+        size_t patch = plane.indices.front() < 20000 ? 0 : (plane.indices.front() - 20000) / 10000 + 1;
+        ASSERT_EQ(plane.indices.size(), patch == 0 ? 20000 : 10000);
+    }
+    std::sort(firstPoints.begin(), firstPoints.end());
+    ASSERT_EQ(firstPoints, vector<int>({0, 20000, 30000, 40000}));
+    // every candidate has its own seed, the thread count changes nothing
+    KKRecons::detectPlanes(cloud, parameters, planesThreaded, 3);
+    ASSERT_EQ(planesThreaded.size(), planes.size());
+    for (size_t i = 0; i < planes.size(); ++i) ASSERT_EQ(planesThreaded[i].indices, planes[i].indices);
+}
+
+TEST(Plane, ViewCopiesOnDemand) {
+    PointCloudT::Ptr cloud(new PointCloudT);
+    for (int i = 0; i < 1000; ++i) {
+        PointT p;
+        p.x = (float)(i % 40) / 10; p.y = 2; p.z = (float)(i / 40) / 10;
+        p.rgba = 0;
+        cloud->push_back(p);
+    }
+    vector<int> indices;
+    for (int i = 0; i < 1000; i += 2) indices.push_back(i);
+    Plane plane(cloud, indices, Eigen::Vector4d(0, 1, 0, -2));
+    ASSERT_TRUE(plane.isView());
+    ASSERT_EQ(plane.size(), 500);
+    ASSERT_EQ(plane.point(3).x, cloud->points[6].x);
+    // reading keeps the view
+    ASSERT_TRUE(plane.runRANSAC(0.05, 0.8));
+    ASSERT_NEAR(std::abs(plane.abcd()[1]), 1, 1e-4);
+    PointCloudT appended;
+    plane.appendPointsTo(appended);
+    ASSERT_EQ(appended.size(), 500);
+    ASSERT_TRUE(plane.isView());
+    // writing copies the points and leaves the source alone
+    plane.setColor(Color_Red);
+    ASSERT_FALSE(plane.isView());
+    ASSERT_EQ(plane.pointCloud()->size(), 500);
+    ASSERT_NE(plane.point(0).rgba, 0);
+    ASSERT_EQ(cloud->points[0].rgba, 0);
+}
+
+TEST(Plane, SetMatchesPairwiseTests) {
+    // walls from random top corners, the tests of the combine stage as extract_walls wrote them per pair
+    vector<Plane> planes;
+    for (int i = 0; i < 40; ++i) {
+        PointCloudT::Ptr corners(new PointCloudT);
+        PointT p, q;
+        p.x = (float)(rand() % 10000) / 1000; p.y = (float)(rand() % 10000) / 1000; p.z = 0;
+        q.x = (float)(rand() % 10000) / 1000; q.y = (float)(rand() % 10000) / 1000; q.z = 3;
+        corners->push_back(p);
+        corners->push_back(q);
+        Plane plane(corners, Eigen::Vector4d(rand() % 2 ? 1 : -1, 1, 0, 0));
+        plane.applyFilter("z", -1, 4); // sets the corners
+        planes.push_back(plane);
+    }
+    auto getDistance = [](Plane &a, Plane &b) {
+        float k = (a.leftUp().y - a.rightUp().y) / (a.leftUp().x - a.rightUp().x);
+        float b0 = a.leftUp().y - k * a.leftUp().x;
+        float b1 = b.leftUp().y - k * b.leftUp().x;
+        float b2 = b.rightUp().y - k * b.rightUp().x;
+        return (std::abs(b0 - b1) / sqrt(k * k + 1) + std::abs(b0 - b2) / sqrt(k * k + 1)) / 2;
+    };
+    auto isOverlap = [](Plane &a, Plane &b) {
+        float k0 = (a.leftUp().y - a.rightUp().y) / (a.leftUp().x - a.rightUp().x);
+        float b0 = a.leftUp().y - k0 * a.leftUp().x;
+        float k1 = -1 / k0;
+        float b1 = b.leftUp().y - k1 * b.leftUp().x;
+        Eigen::Matrix2f A;
+        A << k0, -1, k1, -1;
+        Eigen::Vector2f p1 = A.colPivHouseholderQr().solve(Eigen::Vector2f(-b0, -b1));
+        float largeX = std::max(a.leftUp().x, a.rightUp().x), smallX = std::min(a.leftUp().x, a.rightUp().x);
+        float largeY = std::max(a.leftUp().y, a.rightUp().y), smallY = std::min(a.leftUp().y, a.rightUp().y);
+        return (p1[0] >= smallX && p1[0] <= largeX) || (p1[1] >= smallY && p1[1] <= largeY);
+    };
+    KKRecons::PlaneSet set(planes);
+    ASSERT_EQ(set.size(), planes.size());
+    vector<char> isNear, isWithin, isOverlapping, isOverlapped;
+    vector<float> distances;
+    for (size_t s = 0; s < planes.size(); ++s) {
+        set.nearCorners(s, 1.5f, isNear);
+        set.normalsWithin(s, 10, isWithin);
+        set.lineDistances(s, distances);
+        set.overlaps(s, isOverlapping);
+        set.overlappedBy(s, isOverlapped);
+        for (size_t t = 0; t < planes.size(); ++t) {
+            PointT sl = planes[s].leftUp(), sr = planes[s].rightUp(), tl = planes[t].leftUp(), tr = planes[t].rightUp();
+            sl.z = sr.z = tl.z = tr.z = 0;
+            bool near = s != t && (pcl::geometry::distance(sl, tl) <= 1.5f || pcl::geometry::distance(sl, tr) <= 1.5f ||
+                                   pcl::geometry::distance(sr, tl) <= 1.5f || pcl::geometry::distance(sr, tr) <= 1.5f);
+            ASSERT_EQ(isNear[t] != 0, near);
+            double angle = acos(planes[s].getNormal().dot(planes[t].getNormal()) /
+                                (planes[s].getNormal().norm() * planes[t].getNormal().norm())) * 180 / M_PI;
+            ASSERT_EQ(isWithin[t] != 0, !(angle > 10));
+            ASSERT_EQ(distances[t], getDistance(planes[s], planes[t]));
+            // against itself the crossing is the corner, where the closed form and the QR solve round apart
+            if (s == t) continue;
+            ASSERT_EQ(isOverlapping[t] != 0, isOverlap(planes[s], planes[t]));
+            ASSERT_EQ(isOverlapped[t] != 0, isOverlap(planes[t], planes[s]));
+        }
+    }
+}
+
+TEST(Plane, QuadsRasterizeOnDemand) {
+    // a wall on x + y = 2
+    PointCloudT::Ptr cloud(new PointCloudT);
+    for (int i = 0; i < 400; ++i) {
+        PointT p;
+        p.x = (float)(i % 20) / 10; p.y = 2 - p.x; p.z = (float)(i / 20) / 10;
+        cloud->push_back(p);
+    }
+    Plane plane(cloud, Eigen::Vector4d(M_SQRT1_2, M_SQRT1_2, 0, -M_SQRT2));
+    plane.filledPlane(20);
+    ASSERT_EQ(plane.size(), 0);
+    ASSERT_EQ(plane.quads().size(), 1);
+    PointCloudT grid;
+    plane.appendPointsTo(grid);
+    ASSERT_GT(grid.size(), 1000);
+    // the corners of the quad bound its points
+    PointT min, max;
+    pcl::getMinMax3D(grid, min, max);
+    ASSERT_EQ(plane.leftDown().z, min.z);
+    ASSERT_EQ(plane.leftUp().z, max.z);
+    ASSERT_EQ(plane.leftUp().x, min.x);
+    ASSERT_EQ(plane.leftUp().y, max.y);
+    ASSERT_EQ(plane.rightUp().x, max.x);
+    ASSERT_EQ(plane.rightUp().y, min.y);
+    for (auto &p : grid.points) ASSERT_NEAR(p.x + p.y, 2, 1e-4);
+    // a hole removes what removePointWithin removes from the points
+    Plane eager = plane;
+    eager.pointCloud();
+    ASSERT_EQ(eager.size(), grid.size());
+    eager.removePointWithin(0.5, 1, 0, 3, 0.5, 1.5);
+    plane.removePointWithin(0.5, 1, 0, 3, 0.5, 1.5);
+    ASSERT_EQ(plane.holes().size(), 1);
+    PointCloudT holed;
+    plane.appendPointsTo(holed);
+    ASSERT_LT(holed.size(), grid.size());
+    ASSERT_EQ(holed.size(), eager.size());
+    for (size_t i = 0; i < holed.size(); ++i) {
+        ASSERT_EQ(holed.points[i].x, eager.point(i).x);
+        ASSERT_EQ(holed.points[i].y, eager.point(i).y);
+        ASSERT_EQ(holed.points[i].z, eager.point(i).z);
+    }
+    // quads appended to a plane keep their holes, and any density can be asked for
+    Plane group;
+    group.append(plane);
+    group.append(Plane(plane.leftDown(), plane.leftUp(), plane.rightDown(), plane.rightUp(), 20, Color_Red));
+    ASSERT_EQ(group.quads().size(), 2);
+    PointCloudT sparse;
+    group.appendPointsTo(sparse, 5);
+    ASSERT_LT(sparse.size(), holed.size());
+    PointCloudT all;
+    group.appendPointsTo(all);
+    ASSERT_GT(all.size(), holed.size());
+    group.setColor(Color_Blue);
+    ASSERT_EQ(group.pointCloud()->size(), all.size());
+    ASSERT_TRUE(group.quads().empty());
+    ASSERT_EQ(group.point(0).x, holed.points[0].x);
+    ASSERT_EQ(group.point(all.size() - 1).x, all.points.back().x);
+}
+
+TEST(Raster, LinesAndQuads) {
+    PointT a, b;
+    a.x = 1; a.y = 0; a.z = 0;
+    b.x = 0; b.y = 0; b.z = 0;
+    KKRecons::QuadRaster<PointT> raster(1);
+    raster.addLine(a, b, 10, 255, false);
+    raster.addLine(a, b, 10, 255, true);
+    ASSERT_EQ(raster.size(), 21);
+    PointCloudT lines;
+    raster.rasterize(lines);
+    ASSERT_EQ(lines.size(), 21);
+    ASSERT_EQ(raster.size(), 0);
+    ASSERT_EQ(lines.points[0].x, 0);
+    ASSERT_NEAR(lines.points[9].x, 0.9, 1e-6);
+    ASSERT_EQ(lines.points[10].x, 0); // the second line starts over
+    ASSERT_NEAR(lines.points[20].x, 1, 1e-6);
+    ASSERT_EQ(lines.points[20].rgba, 255);
+    // a quad large enough to be split over threads comes out as on one thread
+    PointT a1, a2, b1, b2;
+    a1.x = 0; a1.y = 0; a1.z = 0;
+    a2.x = 0; a2.y = 0; a2.z = 30;
+    b1.x = 8; b1.y = 6; b1.z = 0;
+    b2.x = 8; b2.y = 6; b2.z = 30;
+    KKRecons::QuadRaster<PointT> single(1), parallel(4);
+    single.addQuad(a1, a2, b1, b2, 20, 7);
+    parallel.addQuad(a1, a2, b1, b2, 20, 7);
+    ASSERT_GT(single.size(), 1 << 16);
+    PointCloudT one, many;
+    single.rasterize(one);
+    parallel.rasterize(many);
+    ASSERT_EQ(one.size(), many.size());
+    for (size_t i = 0; i < one.size(); ++i) {
+        ASSERT_EQ(one.points[i].x, many.points[i].x);
+        ASSERT_EQ(one.points[i].y, many.points[i].y);
+        ASSERT_EQ(one.points[i].z, many.points[i].z);
+    }
+    // the lines of a quad run from b1-b2 to a1-a2
+    ASSERT_EQ(one.points[0].x, 8);
+    ASSERT_NEAR(one.points[200].x, 0, 1e-5);
+}
+
+TEST(Plane, NearCornerGridMatchesScan) {
+    // corners on a half metre lattice put many pairs exactly at the distances tested
+    KKRecons::PlaneSet set;
+    for (int i = 0; i < 300; ++i) {
+        set.leftX.push_back((rand() % 80) * 0.5f - 20);
+        set.leftY.push_back((rand() % 80) * 0.5f + 1000);
+        set.rightX.push_back((rand() % 80) * 0.5f - 20);
+        set.rightY.push_back((rand() % 80) * 0.5f + 1000);
+        set.group.push_back(-1);
+    }
+    set.leftX[7] = NAN;
+    const float distances[] = {0, 0.5f, 1, 1.5f, 2.3f};
+    vector<char> isNear, hasNear;
+    for (float distance : distances) {
+        set.anyNearCorners(distance, hasNear);
+        ASSERT_EQ(hasNear.size(), set.size());
+        for (size_t s = 0; s < set.size(); ++s) {
+            set.nearCorners(s, distance, isNear);
+            bool near = std::find(isNear.begin(), isNear.end(), 1) != isNear.end();
+            ASSERT_EQ(hasNear[s] != 0, near) << "plane " << s << " distance " << distance;
+        }
+    }
+}
+
+TEST(Plane, GroupingMatchesFloodFill) {
+    // short walls along a few directions, on shared lines, exactly along x or y and nearly so
+    KKRecons::PlaneSet walls;
+    const double directions[] = {0, 0.5 * M_PI, 0.3, 0.3 + 0.5 * M_PI, 1.1};
+    for (int i = 0; i < 600; ++i) {
+        double angle = directions[rand() % 5] + (rand() % 3 == 0 ? (rand() % 200 - 100) * 1e-3 : 0);
+        float x = (rand() % 4000) / 100.0f, y = rand() % 2 ? (rand() % 40) : (rand() % 4000) / 100.0f;
+        float length = (rand() % 300) / 100.0f + 0.1f;
+        float rx = x + length * (float) cos(angle), ry = y + length * (float) sin(angle);
+        switch (rand() % 10) {
+            case 0: rx = x; break;
+            case 1: ry = y; break;
+            case 2: rx = x + length; ry = y + 1e-5f * length; break;
+            case 3: rx = x + 1e-5f * length; ry = y + length; break;
+        }
+        walls.leftX.push_back(x); walls.leftY.push_back(y);
+        walls.rightX.push_back(rx); walls.rightY.push_back(ry);
+        // getNormal() of the corners, a few tilted
+        double side = rand() % 2 ? 1 : -2.5;
+        walls.normalX.push_back(-((double) ry - y) * side); walls.normalY.push_back(((double) rx - x) * side);
+        walls.normalZ.push_back(rand() % 50 == 0 ? 0.01 : 0);
+        walls.normalLength.push_back(Eigen::Vector3d(walls.normalX.back(), walls.normalY.back(),
+                                                     walls.normalZ.back()).norm());
+        size_t w = walls.leftX.size() - 1;
+        walls.slope.push_back((walls.leftY[w] - walls.rightY[w]) / (walls.leftX[w] - walls.rightX[w]));
+        walls.intercept.push_back(walls.leftY[w] - walls.slope[w] * walls.leftX[w]);
+        walls.lineScale.push_back(sqrt(walls.slope[w] * walls.slope[w] + 1));
+        walls.group.push_back(-1);
+    }
+    const float degrees[] = {5, 10, 30}, distances[] = {0.1f, 0.5f, 2};
+    vector<char> isWithin, isOverlapping, isOverlapped;
+    vector<float> lineDistances;
+    for (float maxDegrees : degrees) {
+        for (float maxDistance : distances) {
+            // the flood fill extract_walls ran with the kernels against every plane
+            KKRecons::PlaneSet expected = walls;
+            int groups = 0;
+            for (size_t s = 0; s < expected.size(); ++s) {
+                if (expected.group[s] != -1) continue;
+                expected.group[s] = groups;
+                vector<size_t> stack(1, s);
+                while (!stack.empty()) {
+                    size_t member = stack.back();
+                    stack.pop_back();
+                    expected.normalsWithin(member, maxDegrees, isWithin);
+                    expected.lineDistances(member, lineDistances);
+                    expected.overlaps(member, isOverlapping);
+                    expected.overlappedBy(member, isOverlapped);
+                    for (size_t t = 0; t < expected.size(); ++t) {
+                        if (expected.group[t] != -1 || !isWithin[t] || lineDistances[t] > maxDistance) continue;
+                        if (!isOverlapping[t] && !isOverlapped[t]) continue;
+                        expected.group[t] = groups;
+                        stack.push_back(t);
+                    }
+                }
+                ++groups;
+            }
+            KKRecons::PlaneSet grouped = walls;
+            ASSERT_EQ(grouped.groupPlanes(maxDegrees, maxDistance), groups);
+            ASSERT_EQ(grouped.group, expected.group) << maxDegrees << " degrees, distance " << maxDistance;
+        }
+    }
+}
+
+TEST(Plane, BoxRemovalMatchesCondition) {
+    // points on a quarter metre lattice sit exactly on the box faces, a few are not finite
+    PointCloudT::Ptr cloud(new PointCloudT);
+    for (int i = 0; i < 1003; ++i) {
+        PointT p;
+        p.x = (rand() % 17) * 0.25f; p.y = (rand() % 17) * 0.25f; p.z = (rand() % 17) * 0.25f;
+        if (i % 97 == 5) p.y = NAN;
+        if (i % 101 == 7) p.z = INFINITY;
+        p.rgba = i;
+        cloud->push_back(p);
+    }
+    // the last box has yMin > yMax, where the y condition of removePointWithin decides
+    const KKRecons::PointBox boxes[] = {{0.5f, 1, 0, 3, 0.5f, 1.5f}, {2, 2.75f, 1, 1, 0, 4}, {1, 3, 3, 1, 1, 2}};
+    auto isKept = [&](const PointT &p, size_t count) {
+        if (!std::isfinite(p.x) || !std::isfinite(p.y) || !std::isfinite(p.z)) return false;
+        for (size_t b = 0; b < count; ++b) {
+            const KKRecons::PointBox &box = boxes[b];
+            if (!(p.z < box.zMin || p.z > box.zMax || p.x < box.xMin || p.x > box.xMax ||
+                  (p.y < box.yMin && p.y > box.yMax))) return false;
+        }
+        return true;
+    };
+    for (size_t count = 1; count <= 3; ++count) {
+        vector<PointT, Eigen::aligned_allocator<PointT>> points = cloud->points, expected;
+        for (auto &p : points) {
+            if (isKept(p, count)) expected.push_back(p);
+        }
+        size_t kept = KKRecons::removeWithinBoxes(points.data(), points.size(), boxes, count);
+        ASSERT_EQ(kept, expected.size());
+        ASSERT_LT(kept, points.size());
+        for (size_t i = 0; i < kept; ++i) ASSERT_EQ(points[i].rgba, expected[i].rgba);
+    }
+    // one pass over the valid boxes removes what removing them one by one does
+    PointCloudT::Ptr copy(new PointCloudT(*cloud));
+    Plane batch(cloud), single(copy);
+    batch.removePointsWithin(vector<KKRecons::PointBox>(boxes, boxes + 3));
+    single.removePointWithin(0.5f, 1, 0, 3, 0.5f, 1.5f);
+    single.removePointWithin(2, 2.75f, 1, 1, 0, 4);
+    ASSERT_EQ(batch.size(), single.size());
+    for (size_t i = 0; i < batch.size(); ++i) ASSERT_EQ(batch.point(i).rgba, single.point(i).rgba);
+}
+
+TEST(Plane, BoundsFollowPointsAndQuads) {
+    // more points than one thread bounds, a few are not finite
+    PointCloudT::Ptr cloud(new PointCloudT);
+    for (int i = 0; i < 100003; ++i) {
+        PointT p;
+        p.x = (rand() % 1000) * 0.01f; p.y = (rand() % 1000) * 0.01f - 5; p.z = (rand() % 1000) * 0.003f;
+        if (i % 997 == 3) p.x = NAN;
+        cloud->push_back(p);
+    }
+    // the box and the sum of the finite points, one at a time
+    auto scan = [](const PointCloudT &points, Eigen::Vector3f &min, Eigen::Vector3f &max, Eigen::Vector3d &sum) {
+        min.setConstant(FLT_MAX);
+        max.setConstant(-FLT_MAX);
+        sum.setZero();
+        size_t count = 0;
+        for (auto &p : points.points) {
+            if (!std::isfinite(p.x) || !std::isfinite(p.y) || !std::isfinite(p.z)) continue;
+            min = min.cwiseMin(p.getVector3fMap());
+            max = max.cwiseMax(p.getVector3fMap());
+            sum += p.getVector3fMap().cast<double>();
+            ++count;
+        }
+        return count;
+    };
+    Eigen::Vector3f min, max;
+    Eigen::Vector3d sum;
+    size_t finite = scan(*cloud, min, max, sum);
+    for (int threads = 1; threads <= 4; threads += 3) {
+        KKRecons::CloudStats stats = KKRecons::computeCloudStats(*cloud, threads);
+        ASSERT_EQ(stats.count, finite);
+        ASSERT_TRUE(stats.min == min);
+        ASSERT_TRUE(stats.max == max);
+        ASSERT_TRUE(stats.centroid.isApprox(sum / finite, 1e-9));
+    }
+    // after every change the bounds are those of the points the plane writes
+    auto expectBounds = [&](Plane &plane) {
+        PointCloudT points;
+        plane.appendPointsTo(points);
+        Eigen::Vector3f min, max;
+        Eigen::Vector3d sum;
+        scan(points, min, max, sum);
+        PointT boundsMin, boundsMax;
+        plane.bounds(boundsMin, boundsMax);
+        ASSERT_TRUE(boundsMin.getVector3fMap() == min);
+        ASSERT_TRUE(boundsMax.getVector3fMap() == max);
+    };
+    vector<int> indices;
+    for (int i = 0; i < 500; ++i) indices.push_back(i * 7);
+    Plane view(cloud, indices, Eigen::Vector4d(1, 1, 0, -1));
+    expectBounds(view);
+    PointT a1, a2, b1, b2;
+    a1.x = 12; a1.y = -7; a1.z = 0; a2 = a1; a2.z = 4;
+    b1.x = 13; b1.y = -6; b1.z = 0; b2 = b1; b2.z = 4;
+    view.extendPlane(a1, a2, b1, b2, 20, Color_Red);
+    expectBounds(view);
+    ASSERT_FLOAT_EQ(view.rightUp().x, 13);
+    Plane lines(a1, a2, b1, b2, 20, Color_Blue), points(cloud, Eigen::Vector4d(1, -1, 0, 0.5));
+    lines.removePointWithin(12, 12.5f, -7, -6, 0, 5);
+    expectBounds(lines);
+    points.append(lines);
+    expectBounds(points);
+    points.removePointWithin(-1, 20, -10, 10, 2, 5);
+    expectBounds(points);
+    points.filledPlane(20);
+    expectBounds(points);
+}
+
+TEST(Plane, GridMatchesTransformedFill) {
+    // the grid filledPlane used to build: rotate the points, fill the box, rotate the grid back
+    auto zRotation = [](double angle) {
+        Eigen::Matrix4f rotation = Eigen::Matrix4f::Identity();
+        rotation(0, 0) = cos(angle); rotation(0, 1) = -sin(angle);
+        rotation(1, 0) = sin(angle); rotation(1, 1) = cos(angle);
+        return rotation;
+    };
+    auto transformedFill = [&](const PointCloudT &cloud, const Eigen::Vector4d &abcd, int pointPitch,
+                               bool isHeightGiven, float heightUp, float heightDown, PointCloudT &output) {
+        double angle = acos(abs(abcd[0]) / sqrt(abcd[0] * abcd[0] + abcd[1] * abcd[1] + abcd[2] * abcd[2]));
+        if (abcd[0] / abcd[1] > 0) angle = -angle;
+        PointCloudT rotated;
+        pcl::transformPointCloud(cloud, rotated, zRotation(angle));
+        PointT min, max;
+        pcl::getMinMax3D(rotated, min, max);
+        if (isHeightGiven) {
+            max.z = heightUp;
+            min.z = heightDown;
+        }
+        PointT pointForFill;
+        if (abcd[0] / abcd[1] > 0 && abcd[0] < 0) pointForFill.x += abcd[3];
+        else if (abcd[0] / abcd[1] < 0 && abcd[0] < 0) pointForFill.x += abcd[3];
+        else if (abcd[0] / abcd[1] > 0 && abcd[0] > 0) pointForFill.x -= abcd[3];
+        else if (abcd[0] / abcd[1] < 0 && abcd[0] > 0) pointForFill.x -= abcd[3];
+        pointForFill.rgba = INT32_MAX; // Color_White
+        output.clear();
+        for (int i = 0; i <= pointPitch * (max.y - min.y); i++) {
+            for (int j = 0; j <= pointPitch * (max.z - min.z); j++) {
+                pointForFill.y = min.y + ((double) i / pointPitch);
+                pointForFill.z = min.z + ((double) j / pointPitch);
+                output.push_back(pointForFill);
+            }
+        }
+        pcl::transformPointCloud(output, output, zRotation(-angle));
+    };
+    const double angles[] = {0.3, -0.3, 1.2, -1.2, 2.5, -2.0, 0.7853981633974483};
+    for (double theta : angles) {
+        Eigen::Vector4d abcd(cos(theta), sin(theta), 0, -1.7);
+        PointCloudT::Ptr cloud(new PointCloudT);
+        for (int i = 0; i < 3000; ++i) {
+            float along = (rand() % 10000) * 0.0007f - 2, height = (rand() % 1000) * 0.003f;
+            PointT p;
+            p.x = (float) (-abcd[3] * abcd[0] - along * abcd[1]);
+            p.y = (float) (-abcd[3] * abcd[1] + along * abcd[0]);
+            p.z = height;
+            cloud->push_back(p);
+        }
+        for (int heights = 0; heights < 2; ++heights) {
+            Plane plane(cloud, abcd);
+            PointCloudT reference;
+            if (heights) {
+                plane.filledPlane(20, 2.8f, 0.1f);
+                transformedFill(*cloud, abcd, 20, true, 2.8f, 0.1f, reference);
+            }
+            else {
+                plane.filledPlane(20);
+                transformedFill(*cloud, abcd, 20, false, 0, 0, reference);
+            }
+            PointCloudT grid;
+            plane.appendPointsTo(grid);
+            ASSERT_GT(reference.size(), 1000u);
+            ASSERT_EQ(grid.size(), reference.size()) << "angle " << theta << " heights " << heights;
+            for (size_t i = 0; i < grid.size(); ++i) {
+                ASSERT_EQ(grid.points[i].x, reference.points[i].x) << "angle " << theta << " point " << i;
+                ASSERT_EQ(grid.points[i].y, reference.points[i].y) << "angle " << theta << " point " << i;
+                ASSERT_EQ(grid.points[i].z, reference.points[i].z) << "angle " << theta << " point " << i;
+                ASSERT_EQ(grid.points[i].rgba, reference.points[i].rgba);
+            }
+            // the corners are those of the box around the grid, taken the way updateBoundary takes them
+            PointT min, max;
+            pcl::getMinMax3D(reference, min, max);
+            bool isFalling = abcd[0] * abcd[1] > 0;
+            ASSERT_EQ(plane.leftUp().x, min.x);
+            ASSERT_EQ(plane.leftUp().y, isFalling ? max.y : min.y);
+            ASSERT_EQ(plane.leftUp().z, max.z);
+            ASSERT_EQ(plane.leftDown().x, min.x);
+            ASSERT_EQ(plane.leftDown().y, isFalling ? max.y : min.y);
+            ASSERT_EQ(plane.leftDown().z, min.z);
+            ASSERT_EQ(plane.rightUp().x, max.x);
+            ASSERT_EQ(plane.rightUp().y, isFalling ? min.y : max.y);
+            ASSERT_EQ(plane.rightUp().z, max.z);
+            ASSERT_EQ(plane.rightDown().x, max.x);
+            ASSERT_EQ(plane.rightDown().y, isFalling ? min.y : max.y);
+            ASSERT_EQ(plane.rightDown().z, min.z);
+        }
+    }
+}
+
+TEST(Raster, CeilingFillMatchesWindowScan) {
+    // a room 4 m along x with ceiling and floor points, some on the window edges, and a few that are not finite
+    PointCloudT::Ptr cloud(new PointCloudT);
+    auto add = [&](float x, float y, float z) {
+        PointT p;
+        p.x = x; p.y = y; p.z = z;
+        cloud->push_back(p);
+    };
+    for (int i = 0; i < 20000; ++i) {
+        float x = (rand() % 4001) * 0.001f, y = (rand() % 3000) * 0.001f;
+        add(x, y, i % 2 ? 3 - (rand() % 10) * 0.01f : (rand() % 10) * 0.01f);
+        if (i % 5 == 0) add(x, y, (rand() % 300) * 0.01f);
+    }
+    for (float i = 0; i < 4; i += 1 / 20.0f) add(i, 1.5f, 3); // NOLINT
+    for (float i = 0; i < 4; i += 1 / 20.0f) add((float) (i + 0.1), 0.5f, 0); // NOLINT
+    add(NAN, 1, 3);
+    add(2, INFINITY, 0);
+    // the PassThrough slabs and windows of extract_walls, written as loops
+    auto scan = [](const PointCloudT &cloud, int pointPitch, KKRecons::QuadRaster<PointT> &lines) {
+        float step = 1 / (float) pointPitch;
+        PointT min, max;
+        pcl::getMinMax3D(cloud, min, max);
+        vector<PointT> top, down;
+        float minX = FLT_MAX, maxX = -FLT_MAX;
+        for (auto &p : cloud.points) {
+            if (!std::isfinite(p.x) || !std::isfinite(p.y) || !std::isfinite(p.z)) continue;
+            if (p.z >= max.z - 2 * step && p.z <= max.z) {
+                top.push_back(p);
+                minX = std::min(minX, p.x);
+                maxX = std::max(maxX, p.x);
+            }
+            if (p.z >= min.z && p.z <= min.z + 2 * step) down.push_back(p);
+        }
+        for (float i = minX; i < maxX; i += step) { // NOLINT
+            float end = i + 0.1;
+            PointT p1, g1, p2, g2;
+            p1.x = g1.x = p2.x = g2.x = i;
+            p1.y = p2.y = p2.z = g2.z = FLT_MAX;
+            g1.y = g2.y = p1.z = g1.z = -FLT_MAX;
+            for (auto &p : top) {
+                if (p.x < i || p.x > end) continue;
+                p1.y = std::min(p1.y, p.y);
+                g1.y = std::max(g1.y, p.y);
+                p1.z = g1.z = std::max(p1.z, p.z);
+            }
+            for (auto &p : down) {
+                if (p.x < i || p.x > end) continue;
+                p2.y = std::min(p2.y, p.y);
+                g2.y = std::max(g2.y, p.y);
+                p2.z = g2.z = std::min(p2.z, p.z);
+            }
+            if (down.size() < 2) continue;
+            if (abs(p1.y) < 10000 && abs(p1.z) < 10000 && abs(g1.y) < 10000 && abs(g1.z) < 10000) {
+                lines.addLine(p1, g1, pointPitch, 255, false);
+            }
+            if (abs(p2.y) < 10000 && abs(p2.z) < 10000 && abs(g2.y) < 10000 && abs(g2.z) < 10000) {
+                lines.addLine(p2, g2, pointPitch, 255, false);
+            }
+        }
+    };
+    const int pointPitches[] = {20, 150};
+    for (int pointPitch : pointPitches) {
+        KKRecons::QuadRaster<PointT> expectedLines, lines;
+        scan(*cloud, pointPitch, expectedLines);
+        KKRecons::CeilingFill<PointT> fill;
+        fill.setInputCloud(*cloud, pointPitch);
+        ASSERT_GT(fill.top()->size(), 1000);
+        fill.addLines(255, lines);
+        ASSERT_GT(lines.size(), 0);
+        ASSERT_EQ(lines.size(), expectedLines.size());
+        PointCloudT expected, filled;
+        expectedLines.rasterize(expected);
+        lines.rasterize(filled);
+        for (size_t i = 0; i < filled.size(); ++i) {
+            ASSERT_EQ(filled.points[i].x, expected.points[i].x);
+            ASSERT_EQ(filled.points[i].y, expected.points[i].y);
+            ASSERT_EQ(filled.points[i].z, expected.points[i].z);
+        }
+    }
+}
+
+TEST(Perf, StagesInStartOrder) {
+    KKRecons::PerfReport report;
+    {
+        KKRecons::PerfStage outer(&report, "outer", 10);
+        {
+            KKRecons::PerfStage inner(&report, "inner \"quoted\"");
+            vector<double> work(1 << 20, 1.0);
+            double sum = 0;
+            for (double w : work) sum += w;
+            inner.setItemsOut(static_cast<size_t>(sum));
+            inner.addCounter("pushes", 3);
+            inner.addCounter("pushes", 4);
+            inner.addCounter("queries", 1);
+        }
+        outer.setItemsOut(5);
+        outer.finish();
+        outer.setItemsOut(6); // items may still be set once the time is taken
+    }
+    KKRecons::PerfStage ignored(nullptr, "none");
+    ignored.addCounter("pushes", 1);
+    ASSERT_EQ(report.stages().size(), 2);
+    const KKRecons::StageRecord &outer = report.stages()[0], &inner = report.stages()[1];
+    ASSERT_EQ(outer.name, "outer");
+    ASSERT_EQ(outer.itemsIn, 10);
+    ASSERT_EQ(outer.itemsOut, 6);
+    ASSERT_EQ(inner.itemsOut, 1 << 20);
+    ASSERT_GE(outer.wallSeconds, inner.wallSeconds);
+    ASSERT_GE(inner.cpuSeconds, 0);
+    ASSERT_GE(inner.peakRssDeltaKB, 0);
+    ASSERT_EQ(inner.counters.size(), 2);
+    ASSERT_EQ(inner.counters[0], make_pair(string("pushes"), (uint64_t) 7));
+    ASSERT_EQ(inner.counters[1], make_pair(string("queries"), (uint64_t) 1));
+
+    stringstream json;
+    report.writeJson(json);
+    string text = json.str();
+    ASSERT_NE(text.find("\"name\": \"inner \\\"quoted\\\"\""), string::npos);
+    ASSERT_NE(text.find("\"counters\": {\"pushes\": 7, \"queries\": 1}"), string::npos);
+    ASSERT_NE(text.find("\"itemsOut\": 6,"), string::npos);
+    ASSERT_EQ(count(text.begin(), text.end(), '{'), count(text.begin(), text.end(), '}'));
+    report.clear();
+    stringstream empty;
+    report.writeJson(empty);
+    ASSERT_NE(empty.str().find("\"stages\": []"), string::npos);
+}
+
+TEST(Perf, ThroughputRegression) {
+    auto stage = [](const string &name, size_t itemsIn, size_t itemsOut, double seconds) {
+        KKRecons::StageRecord record;
+        record.name = name;
+        record.itemsIn = itemsIn;
+        record.itemsOut = itemsOut;
+        record.wallSeconds = seconds;
+        return record;
+    };
+    vector<KKRecons::StageRecord> baseline = {stage("load", 0, 1000, 1.0), stage("normals", 1000, 1000, 2.0),
+                                              stage("normals", 1000, 1000, 1.0), stage("tiny", 10, 10, 0.001),
+                                              stage("save", 1000, 0, 1.0)};
+    vector<KKRecons::StageRecord> current = {stage("load", 0, 1000, 1.1), stage("normals", 1000, 1000, 2.5),
+                                             stage("tiny", 10, 10, 1.0), stage("normals", 1000, 1000, 0.5)};
+    vector<KKRecons::StageThroughput> result = KKRecons::compareThroughput(baseline, current, 0.15, 0.01);
+    ASSERT_EQ(result.size(), 5);
+    ASSERT_NEAR(result[0].baseline, 1000, 1e-9); // only made items, so those count
+    ASSERT_FALSE(result[0].isRegressed);         // 9% slower is within the tolerance
+    ASSERT_TRUE(result[1].isRegressed);          // 20% slower is not
+    ASSERT_NEAR(result[1].change(), -0.2, 1e-9);
+    ASSERT_FALSE(result[2].isRegressed);         // the second normals stage against the second one
+    ASSERT_NEAR(result[2].current, 2000, 1e-9);
+    ASSERT_TRUE(result[3].isSkipped);
+    ASSERT_FALSE(result[3].isRegressed);
+    ASSERT_TRUE(result[4].isMissing);
+
+    KKRecons::PerfReport report;
+    report.setInputPoints(98765);
+    {
+        KKRecons::PerfStage grow(&report, "region \"grow\"", 1234);
+        grow.setItemsOut(56);
+        grow.addCounter("queuePushes", 789);
+    }
+    ASSERT_TRUE(report.writeJson("perf_roundtrip.json"));
+    vector<KKRecons::StageRecord> read;
+    size_t inputPoints = 0;
+    ASSERT_TRUE(KKRecons::readPerfReport("perf_roundtrip.json", read, &inputPoints));
+    ASSERT_EQ(inputPoints, 98765);
+    ASSERT_EQ(read.size(), 1);
+    ASSERT_EQ(read[0].name, "region \"grow\"");
+    ASSERT_EQ(read[0].itemsIn, 1234);
+    ASSERT_EQ(read[0].itemsOut, 56);
+    ASSERT_NEAR(read[0].wallSeconds, report.stages()[0].wallSeconds, 1e-6);
+    ASSERT_EQ(read[0].counters.size(), 1);
+    ASSERT_EQ(read[0].counters[0], make_pair(string("queuePushes"), (uint64_t) 789));
+    ASSERT_FALSE(KKRecons::readPerfReport("config.yaml", read)); // no stages
+}
+
+TEST(Synthetic, BuildingIsDeterministic) {
+    KKRecons::BuildingSpec spec;
+    spec.roomsX = 2;
+    spec.roomsY = 1;
+    spec.noise = 0.002f;
+    spec.numPoints = 200000; // a few blocks of the random streams
+    spec.seed = 7;
+    KKRecons::SyntheticBuilding building(spec), same(spec);
+    ASSERT_EQ(building.numSurfaces(), 2 + 2 * 2 + 2 + 2 + 2 * 3 * 5); // floor, ceiling, walls, 1 inner wall, 3 boxes a room
+
+    vector<PointT, Eigen::aligned_allocator<PointT> > all(spec.numPoints), part(80000), again(spec.numPoints);
+    building.generate(0, spec.numPoints, all.data(), 1);
+    building.generate(70000, 150000, part.data(), 3);
+    same.generate(0, spec.numPoints, again.data(), 2);
+    size_t inDoor = 0, aboveDoor = 0, furniture = 0;
+    for (size_t i = 0; i < all.size(); ++i) {
+        const PointT &p = all[i], &q = again[i];
+        ASSERT_TRUE(p.x == q.x && p.y == q.y && p.z == q.z && p.rgba == q.rgba);
+        if (i >= 70000 && i < 150000) {
+            const PointT &r = part[i - 70000];
+            ASSERT_TRUE(p.x == r.x && p.y == r.y && p.z == r.z && p.rgba == r.rgba);
+        }
+        ASSERT_TRUE(p.x > -0.05f && p.x < 10.05f && p.y > -0.05f && p.y < 4.05f && p.z > -0.05f && p.z < 3.05f);
+        bool isInnerWall = fabs(p.normal_x) == 1 && fabs(p.x - 5) < 0.1f;
+        // the door of the inner wall is 0.9 m wide in the middle of its 4 m and 2.1 m high
+        if (isInnerWall && p.y > 1.6f && p.y < 2.4f && p.z > 0.1f && p.z < 2.0f) ++inDoor;
+        if (isInnerWall && p.y > 1.6f && p.y < 2.4f && p.z > 2.2f) ++aboveDoor;
+        if (p.rgba != 0xff8c7b6b && p.rgba != 0xffdcdcd2 && p.rgba != 0xfff0f0f0) ++furniture;
+    }
+    ASSERT_EQ(inDoor, 0);
+    ASSERT_GT(aboveDoor, 0);
+    ASSERT_NEAR(furniture / static_cast<double>(spec.numPoints), spec.clutter, 0.01);
+
+    spec.numPoints = 1000;
+    KKRecons::SyntheticBuilding small(spec);
+    ASSERT_TRUE(small.write("synthetic_building.txt"));
+    ASSERT_FALSE(small.write("synthetic_building.las"));
+    PointCloudT loaded;
+    ASSERT_EQ(KKRecons::loadAsciiPoints("synthetic_building.txt", KKRecons::Ascii_CommaXYZARGB, loaded), 0);
+    ASSERT_EQ(loaded.size(), 1000);
+    for (size_t i = 0; i < loaded.size(); ++i) {
+        ASSERT_NEAR(loaded.points[i].x, all[i].x, 1e-4);
+        ASSERT_NEAR(loaded.points[i].z, all[i].z, 1e-4);
+        ASSERT_EQ(loaded.points[i].r, all[i].r);
+    }
+}
+
 TEST(YAML, BASIC) {
     YAML::Node config = YAML::LoadFile("config.yaml");
     YAML::Node RANSAC = config["RANSAC"];
@@ -4,6 +4,8 @@
 #include <iostream>
 #include <vector>
 #include <cmath>
+#include <algorithm>
+#include <memory>
 #include <pcl/point_types.h>
 #include <pcl/io/pcd_io.h>
 #include <pcl/io/ply_io.h>
@@ -28,6 +30,10 @@
 #include "Plane.h"
 #include "SimpleView.h"
 #include "Reconstruction.h"
+#include "PlaneSet.h"
+#include "QuadRaster.h"
+#include "CeilingFill.h"
+#include "PerfReport.h"
 
 using namespace std;
 typedef pcl::PointXYZRGB PointRGB;
@@ -90,34 +96,6 @@ bool isOverlap(Plane& a, Plane& b) {
 	
 }
 
-/**
- * Searches for the near planes.
- *
- * @param [in,out] source   Source for the.
- * @param [in,out] planes   The planes.
- * @param 		   distance The distance.
- *
- * @return Null if it fails, else the found near plane.
- */
-vector<Plane*> findNearPlanes(int source, vector<Plane>& planes, float distance) {
-	vector<Plane*> res;
-	for (int i = 0; i < planes.size(); ++i ) {
-		if (source == i) continue;
-		PointT s_l, s_r, t_l,t_r;
-		s_l = planes[source].leftUp();
-		s_r = planes[source].rightUp();
-		s_l.z = 0; s_r.z = 0;
-		t_l = planes[i].leftUp();
-		t_r = planes[i].rightUp();
-		t_l.z = 0; t_r.z = 0;
-		if (pcl::geometry::distance(s_l, t_l) <= distance || pcl::geometry::distance(s_l, t_r) <= distance ||
-			pcl::geometry::distance(s_r, t_l) <= distance || pcl::geometry::distance(s_r, t_r) <= distance) {
-			res.push_back(&planes[i]);
-		}
-	}
-	return res;
-}
-
 /**
  * Links two edges of two planes.
  *
@@ -179,7 +157,10 @@ struct reconstructParas
 {
 	// Downsampling
 	int KSearch = 0;
+	int NumberOfThreads = 0; // threads of the normal estimation, 0 uses all cores
 	float leafSize = 0; // unit is meter -> 5cm
+	int OutOfCoreMemoryMB = 0; // 0 keeps the whole cloud in memory
+	bool UseCache = false; // keep the loaded and downsampled clouds in .kkc files next to the input
 	// Plane height threshold
 	float minPlaneHeight = 0;
 	// Clustering
@@ -191,6 +172,9 @@ struct reconstructParas
 	double RANSAC_DistThreshold = 0; //0.25;
 	float RANSAC_MinInliers = 0; // 500 todo: should be changed to percents
 	float RANSAC_PlaneVectorThreshold = 0;
+	string RANSAC_Engine = "Clusters"; // Clusters: region growing then RANSAC per cluster, Efficient: octree RANSAC on the whole cloud
+	float Efficient_NormalThreshold = 20; // angle 360 degree between a point normal and its plane
+	float Efficient_ClusterEpsilon = 0.15f; // cell size of the connectivity check of a plane
 
 	// Fill the plane
 	int pointPitch = 0; // number of point in 1 meter
@@ -199,6 +183,10 @@ struct reconstructParas
 	float minimumEdgeDist = 0; //we control the distance between two edges and the height difference between two edges
 	float minPlanesDist = 0; // when clustering RANSAC planes, the min distance between two planes
 	float minAngle_normalDiff = 0;// when extend smaller plane to bigger plane, we will calculate the angle between normals of planes
+
+	// Report
+	string PerfReportPath = ""; // JSON of the time and memory of every stage, empty writes none
+	bool Headless = false; // skip the viewers, for benchmark runs without a display
 }paras;
 
 // color
@@ -240,15 +228,30 @@ int main(int argc, char** argv) {
         YAML::Node config = YAML::LoadFile(argv[2] == "" ? "./config.yaml" : argv[2]);
         importConfig(config,paras);
     #endif
+	setSimpleViewHeadless(paras.Headless);
     assert(argv[2] != "");
 		cout << "\n***** start proceeing *****" << "\n";
-	Reconstruction re(fileName);
-	re.downSampling(paras.leafSize);
-	re.applyRegionGrow(paras.NumberOfNeighbours, paras.SmoothnessThreshold,
-		paras.CurvatureThreshold, paras.MinSizeOfCluster, paras.KSearch);
-	re.applyRANSACtoClusters(paras.RANSAC_DistThreshold, paras.RANSAC_PlaneVectorThreshold, paras.RANSAC_MinInliers);
+	// with an out-of-core budget the input goes from the file straight into the tiles
+	unique_ptr<Reconstruction> loaded(paras.OutOfCoreMemoryMB > 0 ?
+		new Reconstruction(fileName, paras.leafSize, paras.OutOfCoreMemoryMB, paras.UseCache) :
+		new Reconstruction(fileName, paras.UseCache));
+	Reconstruction& re = *loaded;
+	re.numberOfThreads = paras.NumberOfThreads;
+	if (paras.OutOfCoreMemoryMB <= 0) re.downSampling(paras.leafSize, paras.OutOfCoreMemoryMB); // throws if negative
+	if (paras.RANSAC_Engine == "Efficient") {
+		re.applyEfficientRANSAC(paras.RANSAC_DistThreshold, paras.RANSAC_PlaneVectorThreshold, paras.Efficient_NormalThreshold,
+			paras.Efficient_ClusterEpsilon, paras.MinSizeOfCluster, paras.KSearch);
+	}
+	else {
+		re.applyRegionGrow(paras.NumberOfNeighbours, paras.SmoothnessThreshold,
+			paras.CurvatureThreshold, paras.MinSizeOfCluster, paras.KSearch);
+		re.applyRANSACtoClusters(paras.RANSAC_DistThreshold, paras.RANSAC_PlaneVectorThreshold, paras.RANSAC_MinInliers);
+	}
 	PointCloudT::Ptr all(new PointCloudT);
 	vector<Plane>& planes = re.ransacPlanes;
+	// every phase below is a stage of the report, the views are left out of them
+	KKRecons::PerfReport& report = re.perfReport;
+	KKRecons::PerfStage fillStage(&report, "fillPlanes", planes.size());
 	for (auto &plane : planes) {
 		if (plane.orientation == Horizontal) {
 			horizontalPlanes.push_back(plane);
@@ -258,6 +261,8 @@ int main(int argc, char** argv) {
 			filledPlanes.push_back(plane);
 		}
 	}
+	fillStage.setItemsOut(filledPlanes.size());
+	fillStage.finish();
 	simpleView("Filled RANSAC planes", planes);
 
 	// choose the two that have larger points as roof and ground
@@ -265,9 +270,9 @@ int main(int argc, char** argv) {
 		size_t maxNum = 0;
 		size_t maxCloudIndex = 0;
 		for (size_t i = 0; i < horizontalPlanes.size(); ++i) {
-			if (maxNum < horizontalPlanes[i].pointCloud->size()) {
+			if (maxNum < horizontalPlanes[i].size()) {
 				maxCloudIndex = i;
-				maxNum = horizontalPlanes[i].pointCloud->size();
+				maxNum = horizontalPlanes[i].size();
 			}
 		}
 		upDownPlanes.push_back(horizontalPlanes[maxCloudIndex]);
@@ -286,50 +291,35 @@ int main(int argc, char** argv) {
 
 	// remove planes whose height are not meet condition
 	// remove planes whose has no near planes
+	KKRecons::PerfStage filterStage(&report, "filterPlanes", filledPlanes.size());
 	for (size_t i = 0; i < filledPlanes.size(); i++)
 	{
 		if ((filledPlanes[i].leftUp().z - filledPlanes[i].leftDown().z) / (ZLimits[1] - ZLimits[0]) <= paras.minPlaneHeight) {
 			filledPlanes.erase(filledPlanes.begin() + i--);
 		}
 	}
-	for (size_t i = 0; i < filledPlanes.size(); i++)
+	// nearness is symmetric, so the planes without near planes can all be dropped at once
+	KKRecons::PlaneSet planeSet(filledPlanes);
 	{
-		int size = findNearPlanes(i, filledPlanes, paras.minimumEdgeDist).size();
-		if (size == 0) {
-			filledPlanes.erase(filledPlanes.begin() + i--);
+		vector<char> hasNear;
+		vector<Plane> nearPlanes;
+		planeSet.anyNearCorners(paras.minimumEdgeDist, hasNear);
+		for (size_t i = 0; i < filledPlanes.size(); i++)
+		{
+			if (hasNear[i]) nearPlanes.push_back(filledPlanes[i]);
 		}
+		filledPlanes.swap(nearPlanes);
+		planeSet.assign(filledPlanes);
 	}
+	filterStage.setItemsOut(filledPlanes.size());
+	filterStage.finish();
 
 	
-	int G_index = -1;
-	for (Plane&plane_s : filledPlanes) {
-		if (plane_s.group_index != -1) continue;
-		G_index++;
-		plane_s.group_index = G_index;
-		stack<Plane*> tmp;
-		tmp.push(&plane_s);
-		while (!tmp.empty())
-		{
-			Plane* p_s = tmp.top();
-			tmp.pop();
-			for (Plane& p : filledPlanes) {
-				Plane* p_t = &p;
-				if (p_t->group_index != -1) continue;
-
-				// angle of normal difference should lower than certain value
-				double angle = acos(p_s->getNormal().dot(p_t->getNormal()) / (p_s->getNormal().norm()*p_t->getNormal().norm())) * 180 / M_PI;
-				if (angle > paras.minAngle_normalDiff) continue;
-
-				// distance between two planes should smaller enough
-				if (getDistance(*p_s, *p_t) > paras.minPlanesDist) continue;
-
-				// two planes should not overlap with each other
-				if (!(isOverlap(*p_s, *p_t)) && !(isOverlap(*p_t, *p_s))) continue;
-				p_t->group_index = G_index;
-				tmp.push(p_t);
-			}
-		}
-	}
+	// planes within the normal angle, close to the wall line and overlapping are grouped, tested only against
+	// the planes around them
+	KKRecons::PerfStage groupStage(&report, "groupPlanes", filledPlanes.size());
+	int G_index = planeSet.groupPlanes(paras.minAngle_normalDiff, paras.minPlanesDist) - 1;
+	for (size_t i = 0; i < filledPlanes.size(); i++) filledPlanes[i].group_index = planeSet.group[i];
 	
 	vector<int32_t> colors;
 	for (size_t i = 0; i < G_index+1; i++)
@@ -355,11 +345,11 @@ int main(int argc, char** argv) {
 	vector<int> numOfGroups(G_index+1, 0);
 	for (size_t i = 0; i <= G_index; i++)
 	{
-		PointCloudT::Ptr tmp(new PointCloudT);
-		for (auto &plane : filledPlanes) {
-			if (plane.group_index != i) continue;
+		Plane plane; // the quads of the group, rasterized only for its fit
+		for (auto &member : filledPlanes) {
+			if (member.group_index != i) continue;
 			numOfGroups[i]+=1;
-			for (auto &p : plane.pointCloud->points) tmp->push_back(p);
+			plane.append(member);
 //=======
 //	PointCloudT::Ptr roofClusterPts(new PointCloudT);
 //	for (int l = 0; l < roofEdgeClusters.size(); ++l) {
@@ -370,19 +360,26 @@ int main(int argc, char** argv) {
 //			roofClusterPts->push_back(p);
 //>>>>>>> Stashed changes
 		}
-		Plane plane(tmp);
 		plane.group_index = i;
 		planeGroup.push_back(plane);
 	}
+	groupStage.setItemsOut(planeGroup.size());
+	groupStage.finish();
 
 	simpleView("Filled RANSAC planes : Group Planes", planeGroup);
 	
 	cout << "\nHeight Filter: point lower than " << ZLimits[0] << " and higher than " << ZLimits[1] << endl;
+	KKRecons::PerfStage fitStage(&report, "fitGroups", planeGroup.size());
 	for (Plane&plane:planeGroup)
 	{
-		plane.runRANSAC(paras.RANSAC_DistThreshold, 0.8);
+		if (!plane.runRANSAC(paras.RANSAC_DistThreshold, 0.8)) { // keep the raw points of a group without a plane
+			fitStage.addCounter("unfitGroups", 1);
+			continue;
+		}
 		plane.filledPlane(paras.pointPitch, ZLimits[1], ZLimits[0]);
 	}
+	fitStage.setItemsOut(planeGroup.size());
+	fitStage.finish();
 	simpleView("Filled RANSAC planes : Filled Group Planes", planeGroup);
 	/*
 	// find nearest edges
@@ -476,132 +473,85 @@ int main(int argc, char** argv) {
 	}
 	*/
 		
+	KKRecons::PerfStage connectStage(&report, "connectWalls", planeGroup.size() + wallEdgePlanes.size());
 	for (auto &plane:planeGroup)
 	{
-		for (auto p : plane.pointCloud->points)
-			allCloudFilled->push_back(p);
+		plane.appendPointsTo(*allCloudFilled);
 	}
 	for (auto &plane : wallEdgePlanes)
 	{
-		for (auto p : plane.pointCloud->points)
-			allCloudFilled->push_back(p);
+		plane.appendPointsTo(*allCloudFilled);
 	}
+	connectStage.setItemsOut(allCloudFilled->size());
+	connectStage.finish();
 	simpleView("Connect wall planes", allCloudFilled);
 	
 	
 	// mark: since we found the covered planes, we next extend these smaller planes to their covered planes.
-	vector<Plane> extenedPlanes;
+	KKRecons::PerfStage extendStage(&report, "extendPlanes", planeGroup.size());
 	int i = 0, j = 0;
 	for (auto &plane_s : planeGroup) {
 		if (numOfGroups[plane_s.group_index] == 1) continue;
-		Plane tmp;
+		vector<KKRecons::PointBox> coveredBoxes;
 		for (auto &plane_t:filledPlanes)
 		{
 			if (plane_t.group_index != plane_s.group_index) continue;
-			extendSmallPlaneToBigPlane(plane_t, plane_s, 4294951115, paras.pointPitch, tmp.pointCloud);
-			
+			coveredBoxes.push_back(extendSmallPlaneToBigPlane(plane_t, plane_s, 4294951115, paras.pointPitch));
+			extendStage.addCounter("extendedPlanes", 1);
 		}
-		extenedPlanes.push_back(tmp);
+		// the boxes only depend on the corners, which removing points leaves as they are
+		plane_s.removePointsWithin(coveredBoxes);
 	}
 
 	allCloudFilled->resize(0);
 	for (auto &plane : planeGroup)
 	{
-		for (auto p : plane.pointCloud->points)
-			allCloudFilled->push_back(p);
+		plane.appendPointsTo(*allCloudFilled);
 	}
 	for (auto &plane : wallEdgePlanes)
 	{
-		for (auto p : plane.pointCloud->points)
-			allCloudFilled->push_back(p);
+		plane.appendPointsTo(*allCloudFilled);
 	}
 	for (auto &plane : filledPlanes)
 	{
 		plane.setColor(PlaneColor::Color_Blue);
-		for (auto p : plane.pointCloud->points)
-			allCloudFilled->push_back(p);
+		plane.appendPointsTo(*allCloudFilled);
 	}
+	extendStage.setItemsOut(allCloudFilled->size());
+	extendStage.finish();
 	simpleView("Extended Planes", allCloudFilled);
 	PointCloudT::Ptr roof(new PointCloudT);
 	// fill the ceiling and ground
 	{
-		PointT min, max;
-		float step = 1 / (float)paras.pointPitch;
-		pcl::getMinMax3D(*allCloudFilled, min, max);
-		PointCloudT::Ptr topTemp(new PointCloudT);
-		PointCloudT::Ptr downTemp(new PointCloudT);
-		pcl::copyPointCloud(*allCloudFilled, *topTemp);
-		pcl::copyPointCloud(*allCloudFilled, *downTemp);
-		pcl::PassThrough<PointT> filterZ;
-		filterZ.setInputCloud(topTemp);
-		filterZ.setFilterFieldName("z");
-		filterZ.setFilterLimits(max.z - 2 * step, max.z);
-		filterZ.filter(*topTemp);
-		filterZ.setInputCloud(downTemp);
-		filterZ.setFilterFieldName("z");
-		filterZ.setFilterLimits(min.z, min.z + 2 * step);
-		filterZ.filter(*downTemp);
-		PointT minTop, maxTop;
-		pcl::getMinMax3D(*topTemp, minTop, maxTop);
-
-		simpleView("top", topTemp);
-		simpleView("down", downTemp);
-		
-		for (float i = minTop.x; i < maxTop.x; i += step) { // NOLINT
-			// extract x within [i,i+step] -> tempX
-			PointCloudT::Ptr topTempX(new PointCloudT);
-			PointCloudT::Ptr downTempX(new PointCloudT);
-			pcl::PassThrough<PointT> filterX;
-			filterX.setInputCloud(topTemp);
-			filterX.setFilterFieldName("x");
-			filterX.setFilterLimits(i, i + 0.1);
-			filterX.filter(*topTempX);
-			filterX.setInputCloud(downTemp);
-			filterX.filter(*downTempX);
-			if (downTemp->size() < 2) continue;
-			cout << "x " << i << "\n";
-			// found the minY and maxY
-			PointT topTempY_min, topTempY_max;
-			PointT downTempY_min, downTempY_max;
-			pcl::getMinMax3D(*topTempX, topTempY_min, topTempY_max);
-			pcl::getMinMax3D(*downTempX, downTempY_min, downTempY_max);
-
-			PointT p1, g1, p2, g2;
-			p1.x = i; p1.y = topTempY_min.y; p1.z = topTempY_max.z;
-			g1.x = i; g1.y = topTempY_max.y; g1.z = topTempY_max.z;
-			p2.x = i; p2.y = downTempY_min.y; p2.z = downTempY_min.z;
-			g2.x = i; g2.y = downTempY_max.y; g2.z = downTempY_min.z;
-			if (abs(p1.y) < 10000 && abs(p1.z) < 10000 && abs(g1.y) < 10000 && abs(g1.z) < 10000) {
-				generateLinePointCloud(p1, g1, paras.pointPitch, 255, allCloudFilled);
-			}
-			if (abs(p2.y) < 10000 && abs(p2.z) < 10000 && abs(g2.y) < 10000 && abs(g2.z) < 10000) {
-				generateLinePointCloud(p2, g2, paras.pointPitch, 255, allCloudFilled);
-			}
-		}
+		KKRecons::PerfStage slabStage(&report, "ceilingSlabs", allCloudFilled->size());
+		KKRecons::CeilingFill<PointT> fill;
+		fill.setInputCloud(*allCloudFilled, paras.pointPitch);
+		slabStage.setItemsOut(fill.top()->size() + fill.down()->size());
+		slabStage.finish();
+
+		simpleView("top", fill.top());
+		simpleView("down", fill.down());
+
+		KKRecons::PerfStage lineStage(&report, "ceilingLines", allCloudFilled->size());
+		KKRecons::QuadRaster<PointT> fillLines; // written to allCloudFilled once all lines are found
+		fill.addLines(255, fillLines);
+		lineStage.addCounter("linePoints", fillLines.size());
+		fillLines.rasterize(*allCloudFilled);
+		lineStage.setItemsOut(allCloudFilled->size());
 	}
 	simpleView("cloud Filled", allCloudFilled);
+	KKRecons::PerfStage saveStage(&report, "savePly", allCloudFilled->size());
 	pcl::io::savePLYFile("OutputData/6_AllPlanes.ply", *allCloudFilled);
+	saveStage.finish();
+	if (!paras.PerfReportPath.empty() && !report.writeJson(paras.PerfReportPath)) {
+		cerr << "Cannot write the performance report " << paras.PerfReportPath << endl;
+	}
 	return (0);
 }
 
 
 
-void generateLinePointCloud(PointT pt1, PointT pt2, int pointPitch, int color, PointCloudT::Ptr output) {
-	int numPoints = pcl::geometry::distance(pt1, pt2) * pointPitch;
-	float ratioX = (pt1.x - pt2.x) / numPoints;
-	float ratioY = (pt1.y - pt2.y) / numPoints;
-	float ratioZ = (pt1.z - pt2.z) / numPoints;
-	for (size_t i = 0; i <numPoints; i++) {
-		PointT p;
-		p.x = pt2.x + i * (ratioX);
-		p.y = pt2.y + i * (ratioY);
-		p.z = pt2.z + i * (ratioZ);
-		p.rgba = color;
-		output->points.push_back(p);
-	}
-}
-
-void extendSmallPlaneToBigPlane(Plane& sourceP, Plane& targetP, int color, int pointPitch, PointCloudT::Ptr output) {
+KKRecons::PointBox extendSmallPlaneToBigPlane(Plane& sourceP, Plane& targetP, int color, int pointPitch) {
 	Eigen::Vector3d normal = sourceP.getNormal();
 	float slope = normal[1] / normal[0];
 	float b1 = sourceP.leftUp().y - slope * sourceP.leftUp().x;
@@ -647,7 +597,8 @@ void extendSmallPlaneToBigPlane(Plane& sourceP, Plane& targetP, int color, int p
 	float zMin = sourceP.leftDown().z, zMax = sourceP.leftUp().z;
 	float xMin = X1[0], xMax = X2[0];
 	float yMin = X1[1], yMax = X2[1];
-	targetP.removePointWithin(xMin, xMax, yMin, yMax, zMin, zMax);
+	KKRecons::PointBox covered = { xMin, xMax, yMin, yMax, zMin, zMax };
+	return covered;
 }
 
 
@@ -718,9 +669,16 @@ void importConfig(const YAML::Node& node, reconstructParas &para){
     para.RANSAC_DistThreshold        = RANSAC["RANSAC_DistThreshold"].as<float>();
     para.RANSAC_MinInliers           = RANSAC["RANSAC_MinInliers"].as<float>();
     para.RANSAC_PlaneVectorThreshold = RANSAC["RANSAC_PlaneVectorThreshold"].as<float>();
+    // keys added after the first configs keep their defaults when missing
+    if (RANSAC["Engine"]) para.RANSAC_Engine = RANSAC["Engine"].as<string>();
+    if (RANSAC["Efficient_NormalThreshold"]) para.Efficient_NormalThreshold = RANSAC["Efficient_NormalThreshold"].as<float>();
+    if (RANSAC["Efficient_ClusterEpsilon"]) para.Efficient_ClusterEpsilon = RANSAC["Efficient_ClusterEpsilon"].as<float>();
 
     para.KSearch  = Downsample["KSearch"].as<int>();
+    if (Downsample["NumberOfThreads"]) para.NumberOfThreads = Downsample["NumberOfThreads"].as<int>();
     para.leafSize = Downsample["leafSize"].as<float>();
+    if (Downsample["OutOfCoreMemoryMB"]) para.OutOfCoreMemoryMB = Downsample["OutOfCoreMemoryMB"].as<int>();
+    if (Downsample["UseCache"]) para.UseCache = Downsample["UseCache"].as<bool>();
 
     para.MinSizeOfCluster    = Clustering["MinSizeOfCluster"].as<int>();
     para.NumberOfNeighbours  = Clustering["NumberOfNeighbours"].as<int>();
@@ -730,4 +688,7 @@ void importConfig(const YAML::Node& node, reconstructParas &para){
     para.minimumEdgeDist      = Combine["minimumEdgeDist"].as<float>();
     para.minPlanesDist        = Combine["minPlanesDist"].as<float>();
     para.minAngle_normalDiff  = Combine["minAngle_normalDiff"].as<float>();
+
+    if (node["Report"]) para.PerfReportPath = node["Report"]["PerfReportPath"].as<string>(); // older configs have none
+    if (node["Report"] && node["Report"]["Headless"]) para.Headless = node["Report"]["Headless"].as<bool>();
 }
\ No newline at end of file
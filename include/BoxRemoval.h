@@ -0,0 +1,25 @@
+#ifndef RECONSTRUCTION_BOXREMOVAL_H
+#define RECONSTRUCTION_BOXREMOVAL_H
+
+#include <cstddef>
+
+namespace KKRecons {
+    /** @brief the box of Plane::removePointWithin. A point is within when it is not below or above the box in x
+     *         or z. The condition removePointWithin was written with asked for y < yMin and y > yMax together,
+     *         which no point is in a valid box, so y never decides there
+     */
+    struct PointBox {
+        float xMin, xMax, yMin, yMax, zMin, zMax;
+        bool isValid() const { return !(xMin > xMax || yMin > yMax || zMin > zMax); }
+    };
+
+    /** @brief remove the points within any of the boxes and the points that are not finite, as
+     *         pcl::ConditionalRemoval did, keeping the others in order at the front of points.
+     *         One pass tests all boxes, 8 points at a time with AVX2 when the CPU has it
+     *  @return number of points kept
+     */
+    template<typename PointType>
+    size_t removeWithinBoxes(PointType *points, size_t count, const PointBox *boxes, size_t boxCount);
+}
+
+#endif //RECONSTRUCTION_BOXREMOVAL_H
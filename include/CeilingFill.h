@@ -0,0 +1,52 @@
+#ifndef RECONSTRUCTION_CEILINGFILL_H
+#define RECONSTRUCTION_CEILINGFILL_H
+
+#include <vector>
+#include <cstdint>
+#include <pcl/point_types.h>
+#include <pcl/point_cloud.h>
+#include <QuadRaster.h>
+
+namespace KKRecons {
+    /** @brief the ceiling and floor fill of extract_walls. The top and bottom slabs of a cloud, 2 / pointPitch
+     *         high, are cut along x every 1 / pointPitch into windows 0.1 wide. Each window gets a line from its
+     *         lowest to its highest y at the top of the ceiling slab and one at the bottom of the floor slab.
+     *         The slab points are binned once on the cells between window edges, and every window folds the cells
+     *         it covers, so the lines are those of the PassThrough per window loop without a pass per window.
+     */
+    template<typename PointType>
+    class CeilingFill {
+    public:
+        /** @param threads number of threads, <= 0 means all hardware threads */
+        explicit CeilingFill(int threads = 0)
+                : topSlab(new pcl::PointCloud<PointType>), downSlab(new pcl::PointCloud<PointType>), step(0),
+                  topMinX(0), topMaxX(0), pointPitch(0), threads(threads) {}
+
+        /** @brief take the finite points within 2 / pointPitch of the top and of the bottom of cloud. The height of
+         *         the cloud comes from one pass over it, the x extent of the ceiling slab is kept while it is cut
+         */
+        void setInputCloud(const pcl::PointCloud<PointType> &cloud, int pointPitch);
+        const typename pcl::PointCloud<PointType>::Ptr &top() const { return topSlab; }
+        const typename pcl::PointCloud<PointType>::Ptr &down() const { return downSlab; }
+        /** @brief queue the lines of the windows in x order, the ceiling line of a window before its floor line.
+         *         A line whose ends are 10000 or more away is left out, as is every line with fewer than 2 floor
+         *         points
+         */
+        void addLines(int32_t color, QuadRaster<PointType> &lines) const;
+
+    private:
+        // lowest and highest y of the points in a cell or window, and their highest or lowest z
+        struct Extent {
+            float minY, maxY, z;
+        };
+        void foldCells(const pcl::PointCloud<PointType> &slab, const std::vector<float> &edges, bool isTop,
+                       std::vector<Extent> &cells) const;
+
+        typename pcl::PointCloud<PointType>::Ptr topSlab, downSlab;
+        float step;
+        float topMinX, topMaxX;
+        int pointPitch, threads;
+    };
+}
+
+#endif //RECONSTRUCTION_CEILINGFILL_H
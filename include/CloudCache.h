@@ -0,0 +1,76 @@
+#ifndef RECONSTRUCTION_CLOUDCACHE_H
+#define RECONSTRUCTION_CLOUDCACHE_H
+
+#include <string>
+#include <cstdint>
+#include <pcl/point_types.h>
+#include <pcl/point_cloud.h>
+#include <MappedFile.h>
+
+namespace KKRecons {
+    enum CacheColumn {
+        Column_X, Column_Y, Column_Z, Column_Rgba,
+        Column_NormalX, Column_NormalY, Column_NormalZ, Column_Curvature,
+        Column_Count,
+    };
+
+    /** @brief voxel engine a downsampled cloud came from, the engines write the voxels in different orders */
+    enum CacheVoxelEngine {
+        VoxelEngine_InMemory, // voxelGridFilter, also the value of a cloud which is not downsampled
+        VoxelEngine_Tiled,    // TiledVoxelFilter
+    };
+
+    /** @brief fixed size header at the start of a .kkc file, followed by one 64 byte aligned
+     *         column of 4 byte values per CacheColumn
+     */
+    struct CloudCacheHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t hasNormals;
+        uint64_t numPoints;
+        uint64_t sourceSize;  // size and modification time of the scan the cache was built from
+        int64_t sourceTime;
+        float leafSize;       // 0 for the cloud as loaded, otherwise the voxel size it was downsampled with
+        int32_t kSearch;      // KSearch the normals were estimated with, -1 if they came with the input
+        uint32_t voxelEngine; // CacheVoxelEngine of a downsampled cloud
+        float min[3];
+        float max[3];
+        uint64_t columnOffsets[Column_Count];
+    };
+
+    /** @brief project native, column oriented point cloud container. The columns are used straight from
+     *         the memory mapped file, nothing is parsed on reload.
+     */
+    class CloudCache {
+    public:
+        /** @brief <source>.kkc for the loaded cloud, <source>.leaf<size>.kkc for a cloud downsampled in memory,
+         *         <source>.leaf<size>.tiled.kkc for one downsampled out of core
+         */
+        static std::string cachePath(const std::string &sourcePath, float leafSize,
+                                     CacheVoxelEngine engine = VoxelEngine_InMemory);
+        static bool write(const std::string &path, const std::string &sourcePath, const pcl::PointCloud<pcl::PointXYZRGBNormal> &cloud,
+                          float leafSize, int kSearch, bool hasNormals, int threads = 0,
+                          CacheVoxelEngine engine = VoxelEngine_InMemory);
+        /** @brief map a cache file, false if it does not exist or is not a valid cache
+         */
+        bool open(const std::string &path);
+        /** @brief true if the cache was built from the current version of sourcePath with this leafSize and,
+         *         for a downsampled cloud, this engine
+         */
+        bool isFresh(const std::string &sourcePath, float leafSize, CacheVoxelEngine engine = VoxelEngine_InMemory) const;
+        const CloudCacheHeader& header() const { return *_header; };
+        size_t size() const { return static_cast<size_t>(_header->numPoints); };
+        const float* column(CacheColumn c) const {
+            return reinterpret_cast<const float*>(_file.data() + _header->columnOffsets[c]);
+        };
+        const uint32_t* rgba() const {
+            return reinterpret_cast<const uint32_t*>(_file.data() + _header->columnOffsets[Column_Rgba]);
+        };
+        void toPointCloud(pcl::PointCloud<pcl::PointXYZRGBNormal> &cloud, int threads = 0) const;
+    private:
+        MappedFile _file;
+        const CloudCacheHeader* _header = nullptr;
+    };
+}
+
+#endif //RECONSTRUCTION_CLOUDCACHE_H
@@ -0,0 +1,43 @@
+#ifndef RECONSTRUCTION_CLOUDSTATS_H
+#define RECONSTRUCTION_CLOUDSTATS_H
+
+#include <vector>
+#include <cstddef>
+#include <Eigen/Core>
+#include <pcl/point_types.h>
+#include <pcl/point_cloud.h>
+
+namespace KKRecons {
+    /** @brief bounds, centroid and number of the finite points of a cloud. An empty one has the FLT_MAX and
+     *         -FLT_MAX bounds of pcl::getMinMax3D and a zero centroid
+     */
+    struct CloudStats {
+        Eigen::Vector3f min, max;
+        Eigen::Vector3d centroid;
+        size_t count;
+
+        CloudStats();
+        bool isEmpty() const { return count == 0; }
+        /** @brief the stats of the points of both */
+        void merge(const CloudStats &other);
+    };
+
+    /** @brief min, max, centroid and count of the finite points in one pass, split over the threads when there
+     *         are enough points
+     *  @param threads number of threads, <= 0 means all hardware threads
+     */
+    template<typename PointType>
+    CloudStats computeCloudStats(const PointType *points, size_t count, int threads = 0);
+
+    template<typename PointType>
+    CloudStats computeCloudStats(const pcl::PointCloud<PointType> &cloud, int threads = 0) {
+        return computeCloudStats(cloud.points.data(), cloud.points.size(), threads);
+    }
+
+    /** @brief the stats of the indexed points of cloud */
+    template<typename PointType>
+    CloudStats computeCloudStats(const pcl::PointCloud<PointType> &cloud, const std::vector<int> &indices,
+                                 int threads = 0);
+}
+
+#endif //RECONSTRUCTION_CLOUDSTATS_H
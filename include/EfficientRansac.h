@@ -0,0 +1,41 @@
+#ifndef RECONSTRUCTION_EFFICIENTRANSAC_H
+#define RECONSTRUCTION_EFFICIENTRANSAC_H
+
+#include <vector>
+#include <cstdint>
+#include <Eigen/Core>
+#include <pcl/point_types.h>
+#include <pcl/point_cloud.h>
+
+namespace KKRecons {
+    struct EfficientRansacParameters {
+        float distanceThreshold = 0.25f; // max distance of a plane point
+        float normalThreshold = 0.94f;   // min |cos| between a point normal and the plane normal
+        float clusterEpsilon = 0.15f;    // cell size of the bitmap the connected plane points are found in
+        int minSupport = 50;             // smallest plane worth extracting
+        double probability = 0.99;       // confidence that no larger plane was missed
+        int maxCandidates = 200000;      // bound of the candidates drawn over the whole run
+    };
+
+    struct DetectedPlane {
+        Eigen::Vector4f coefficients;
+        std::vector<int> indices; // ascending
+    };
+
+    /** @brief multi-plane detection after Schnabel et al., "Efficient RANSAC for Point-Cloud Shape Detection".
+     *         Candidates are drawn from three points of one octree cell, at a level chosen by how well each level did so
+     *         far, and are scored on a random subset of the unassigned points by distance and normal deviation.
+     *         The best candidate is extracted once the chance of having missed a larger plane drops below
+     *         1 - probability: its largest connected component in a plane bitmap is refitted and taken out of the
+     *         cloud. Drawing stops when a plane of minSupport points would no longer be missed.
+     *         Every candidate has its own seed, so the planes do not depend on the thread count.
+     * @param threads number of threads, <= 0 means all hardware threads
+     * @param candidatesDrawn if not null, set to the number of candidates drawn
+     */
+    template<typename PointType>
+    void detectPlanes(const pcl::PointCloud<PointType> &cloud, const EfficientRansacParameters &parameters,
+                      std::vector<DetectedPlane> &planes, int threads = 0, uint32_t seed = 12345,
+                      size_t *candidatesDrawn = nullptr);
+}
+
+#endif //RECONSTRUCTION_EFFICIENTRANSAC_H
@@ -0,0 +1,37 @@
+#ifndef RECONSTRUCTION_KNNGRAPH_H
+#define RECONSTRUCTION_KNNGRAPH_H
+
+#include <vector>
+#include <cstddef>
+#include <pcl/point_types.h>
+#include <pcl/point_cloud.h>
+
+namespace KKRecons {
+    /** @brief k nearest neighbours of every point of a cloud, queried once and stored as a CSR index array.
+     *         The neighbours of a point are sorted by distance and start with the point itself, exactly what
+     *         pcl::search::KdTree::nearestKSearch returns, so the first k' <= k of them are its k' nearest
+     *         neighbours. Normal estimation and region growing both read their neighbours from here.
+     */
+    template<typename PointType>
+    class KnnGraph {
+    public:
+        /** @brief query the k nearest neighbours of all points with one shared KdTree
+         * @param threads number of threads, <= 0 means all hardware threads
+         */
+        void build(const typename pcl::PointCloud<PointType>::ConstPtr &cloud, int k, int threads = 0);
+        void clear();
+        int k() const { return numNeighbours; }
+        size_t size() const { return offsets.empty() ? 0 : offsets.size() - 1; }
+        /** @brief number of neighbours of point i, less than k for non-finite points or tiny clouds */
+        size_t count(size_t i) const { return offsets[i + 1] - offsets[i]; }
+        const int* begin(size_t i) const { return indices.data() + offsets[i]; }
+        const int* end(size_t i) const { return indices.data() + offsets[i + 1]; }
+
+    private:
+        int numNeighbours = 0;
+        std::vector<size_t> offsets;
+        std::vector<int> indices;
+    };
+}
+
+#endif //RECONSTRUCTION_KNNGRAPH_H
@@ -0,0 +1,37 @@
+#ifndef RECONSTRUCTION_MAPPEDFILE_H
+#define RECONSTRUCTION_MAPPEDFILE_H
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+namespace KKRecons {
+    /** @brief read-only view of a whole file. Uses mmap where available and falls back to reading the
+     *         file into memory otherwise. The view is released with the object.
+     */
+    class MappedFile {
+    public:
+        MappedFile() {};
+        explicit MappedFile(const std::string &path) { open(path); };
+        ~MappedFile() { close(); };
+        bool open(const std::string &path);
+        void close();
+        bool isOpen() const { return _data != nullptr || _isEmptyFile; };
+        const char* data() const { return _data; };
+        size_t size() const { return _size; };
+        /** @brief let the system drop the mapped pages before offset, which must not be read again. A file read
+         *         into memory keeps its buffer
+         */
+        void release(size_t offset);
+    private:
+        MappedFile(const MappedFile&);
+        MappedFile& operator=(const MappedFile&);
+        const char* _data = nullptr;
+        size_t _size = 0;
+        bool _isMapped = false;
+        bool _isEmptyFile = false;
+        std::vector<char> _buffer;
+    };
+}
+
+#endif //RECONSTRUCTION_MAPPEDFILE_H
@@ -0,0 +1,18 @@
+#ifndef RECONSTRUCTION_NORMALESTIMATION_H
+#define RECONSTRUCTION_NORMALESTIMATION_H
+
+#include <pcl/point_types.h>
+#include <pcl/point_cloud.h>
+#include <KnnGraph.h>
+
+namespace KKRecons {
+    /** @brief the normal and curvature of every point from its first k neighbours in graph, flipped towards the
+     *         sensor origin of the cloud, the same as pcl::NormalEstimation with a k search. A point without a plane
+     *         through its neighbours gets NaN. The threads write straight into the points
+     * @param threads number of threads, <= 0 means all hardware threads
+     */
+    template<typename PointType>
+    void estimateNormals(pcl::PointCloud<PointType> &cloud, const KnnGraph<PointType> &graph, int k, int threads = 0);
+}
+
+#endif //RECONSTRUCTION_NORMALESTIMATION_H
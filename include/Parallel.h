@@ -0,0 +1,103 @@
+#ifndef RECONSTRUCTION_PARALLEL_H
+#define RECONSTRUCTION_PARALLEL_H
+
+#include <thread>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <exception>
+#include <algorithm>
+#include <cstddef>
+
+namespace KKRecons {
+    /** @brief loops over fewer items than this stay on the calling thread, starting threads would cost more than
+     *         it saves
+     */
+    const size_t minParallelItems = 1 << 16;
+
+    /** @brief resolve a thread count from config, <= 0 means use all hardware threads
+     */
+    inline int resolveThreads(int threads) {
+        if (threads > 0) return threads;
+        int hw = static_cast<int>(std::thread::hardware_concurrency());
+        return hw > 0 ? hw : 1;
+    }
+
+    /** @brief split [0, n) into one contiguous block per thread and run func(begin, end, threadIndex) on each.
+     *         The calling thread works on the last block, so a single thread never spawns anything.
+     */
+    template<typename Func>
+    void parallelFor(size_t n, int threads, Func func) {
+        size_t numThreads = static_cast<size_t>(resolveThreads(threads));
+        numThreads = std::max<size_t>(1, std::min(numThreads, n));
+        size_t block = n / numThreads, rest = n % numThreads;
+        std::vector<std::thread> workers;
+        size_t begin = 0;
+        for (size_t t = 0; t < numThreads; ++t) {
+            size_t end = begin + block + (t < rest ? 1 : 0);
+            if (t + 1 == numThreads) func(begin, end, t);
+            else workers.push_back(std::thread(func, begin, end, t));
+            begin = end;
+        }
+        for (auto &w : workers) w.join();
+    }
+
+    /** @brief run func(task, threadIndex) for every task of order on a work-stealing pool.
+     *         Tasks are dealt round-robin in the given order to one deque per thread. A thread takes its own tasks
+     *         from the front and, once it runs dry, steals from the back of the others, so with a largest first
+     *         order the big tasks start early and the small ones fill the gaps at the end.
+     *         If a task throws, no further task is started and the first exception is rethrown once all threads
+     *         have joined.
+     */
+    template<typename Func>
+    void workStealingFor(const std::vector<size_t> &order, int threads, Func func) {
+        size_t numThreads = static_cast<size_t>(resolveThreads(threads));
+        numThreads = std::max<size_t>(1, std::min(numThreads, order.size()));
+        std::vector<std::deque<size_t> > queues(numThreads);
+        std::vector<std::mutex> locks(numThreads);
+        for (size_t i = 0; i < order.size(); ++i) queues[i % numThreads].push_back(order[i]);
+        std::exception_ptr error;
+        std::mutex errorLock;
+        std::atomic<bool> isFailed(false);
+        auto worker = [&](size_t self) {
+            while (!isFailed) {
+                size_t task = 0;
+                bool isFound = false;
+                {
+                    std::lock_guard<std::mutex> lock(locks[self]);
+                    if (!queues[self].empty()) {
+                        task = queues[self].front();
+                        queues[self].pop_front();
+                        isFound = true;
+                    }
+                }
+                for (size_t v = 1; !isFound && v < numThreads; ++v) {
+                    size_t victim = (self + v) % numThreads;
+                    std::lock_guard<std::mutex> lock(locks[victim]);
+                    if (!queues[victim].empty()) {
+                        task = queues[victim].back();
+                        queues[victim].pop_back();
+                        isFound = true;
+                    }
+                }
+                if (!isFound) return; // no task is added later, so every deque stays empty
+                try {
+                    func(task, self);
+                }
+                catch (...) {
+                    std::lock_guard<std::mutex> lock(errorLock);
+                    if (!error) error = std::current_exception();
+                    isFailed = true;
+                }
+            }
+        };
+        std::vector<std::thread> workers;
+        for (size_t t = 0; t + 1 < numThreads; ++t) workers.push_back(std::thread(worker, t));
+        worker(numThreads - 1);
+        for (auto &w : workers) w.join();
+        if (error) std::rethrow_exception(error);
+    }
+}
+
+#endif //RECONSTRUCTION_PARALLEL_H
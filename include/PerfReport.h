@@ -0,0 +1,87 @@
+#ifndef RECONSTRUCTION_PERFREPORT_H
+#define RECONSTRUCTION_PERFREPORT_H
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <ostream>
+#include <cstdint>
+#include <cstddef>
+
+namespace KKRecons {
+    /** @brief wall clock, CPU time of all threads and peak resident set of the process at one moment */
+    struct ResourceSample {
+        double wallSeconds;
+        double cpuSeconds;
+        long peakRssKB; // 0 where the platform does not tell
+
+        static ResourceSample now();
+    };
+
+    /** @brief what one stage of a run cost and did */
+    struct StageRecord {
+        std::string name;
+        double wallSeconds = 0;
+        double cpuSeconds = 0;
+        long peakRssDeltaKB = 0; // growth of the peak resident set during the stage
+        size_t itemsIn = 0;
+        size_t itemsOut = 0;
+        std::vector<std::pair<std::string, uint64_t> > counters; // in the order they were first added
+    };
+
+    /** @brief stages of a run in the order they started. A stage running inside another is recorded on its own
+     *         and is also part of the one around it
+     */
+    class PerfReport {
+    public:
+        PerfReport() : start(ResourceSample::now()) {}
+
+        const std::vector<StageRecord> &stages() const { return records; }
+        /** @brief drop the stages, none may still be measured */
+        void clear();
+        /** @brief points of the scan the run was given. The items of most stages are planes or clusters, this
+         *         is what tells which scan a report is of
+         */
+        void setInputPoints(size_t points) { numInputPoints = points; }
+        size_t inputPoints() const { return numInputPoints; }
+        /** @brief {"wallSeconds", "cpuSeconds", "peakRssKB", "inputPoints", "stages": [{"name", "wallSeconds",
+         *         "cpuSeconds", "peakRssDeltaKB", "itemsIn", "itemsOut", "counters": {name: value}}]}, the totals
+         *         since the report was made or cleared
+         */
+        void writeJson(std::ostream &out) const;
+        /** @return false if the file cannot be written */
+        bool writeJson(const std::string &path) const;
+
+    private:
+        friend class PerfStage;
+        ResourceSample start;
+        size_t numInputPoints = 0;
+        std::vector<StageRecord> records;
+    };
+
+    /** @brief measures a stage from its construction to finish() or its destruction and adds it to the report.
+     *         With a null report nothing is measured
+     */
+    class PerfStage {
+    public:
+        PerfStage(PerfReport *report, const std::string &name, size_t itemsIn = 0);
+        ~PerfStage() { finish(); }
+        PerfStage(const PerfStage &) = delete;
+        PerfStage &operator=(const PerfStage &) = delete;
+
+        void setItemsIn(size_t items);
+        void setItemsOut(size_t items);
+        /** @brief add value to the counter name of the stage */
+        void addCounter(const std::string &name, uint64_t value);
+        /** @brief stop measuring, later calls do nothing */
+        void finish();
+
+    private:
+        PerfReport *report;
+        size_t index;
+        ResourceSample start;
+        bool isFinished;
+    };
+}
+
+#endif //RECONSTRUCTION_PERFREPORT_H
@@ -3,6 +3,7 @@
 
 #include <iostream>
 #include <vector>
+#include <cmath>
 #include <pcl/point_types.h>
 #include <pcl/io/pcd_io.h>
 #include <pcl/io/ply_io.h>
@@ -21,6 +22,8 @@
 #include <pcl/filters/voxel_grid.h> //ダウンサンプリングのため
 #include <pcl/common/geometry.h>
 #include <pcl/filters/conditional_removal.h>
+#include "BoxRemoval.h"
+#include "CloudStats.h"
 using namespace std;
 typedef pcl::PointXYZRGB PointRGB;
 typedef pcl::PointXYZRGBNormal PointT;
@@ -68,6 +71,29 @@ struct PlaneEdge {
 	bool isConnected;
 	PlaneEdge() : connectedEdgeType(EdgeNone), isConnected(false) {}
 };
+
+/** @brief a filled quad of a plane kept as its parameters, the points are only generated when they are asked for
+ */
+struct PlaneQuad {
+	enum Shape {
+		Grid,  // filledPlane: rows from minY to maxY, columns from minZ to maxZ at x, rotated by -angle around z
+		Lines, // the 4 points constructor and extendPlane: lines from b1-b2 to a1-a2
+	};
+	Shape shape;
+	int32_t color;
+	float pointPitch;
+	float x, minY, maxY, minZ, maxZ;
+	double angle;
+	PointT a1, a2, b1, b2;
+};
+
+/** @brief the box removePointWithin removed the points of the quads [firstQuad, endQuad) within
+ */
+struct PlaneHole {
+	KKRecons::PointBox box;
+	size_t firstQuad, endQuad;
+};
+
 class Plane
 {
 private:
@@ -75,15 +101,36 @@ private:
 	PointT _leftDown, _rightDown, _rightUp, _leftUp;
 	Eigen::Vector4d _abcd;
 	PlaneType _type = PlaneType::PlaneType_Other;
-
-	void generatePlanePointCloud(PointT a1, PointT a2, PointT b1, PointT b2, float pointPitch, int color);
-	void generateLinePointCloud(PointT pt1, PointT pt2, int pointPitch, int color);
+	PointCloudT::Ptr _pointCloud;
+	PointCloudT::ConstPtr _source; // set while the plane is a view of _indices into _source
+	vector<int> _indices;
+	vector<PlaneQuad> _quads; // filled after the stored points, rasterized by appendPointsTo and pointCloud()
+	vector<PlaneHole> _holes;
+	// the stats of the stored points and the bounds of the quads, computed when first asked for and then kept
+	// up to date as points and quads are added or removed
+	KKRecons::CloudStats _pointStats;
+	PointT _quadsMin, _quadsMax;
+	bool _isPointStatsKnown = false;
+	bool _isQuadsBoundsKnown = false;
+
+	static void generateGridPointCloud(const PlaneQuad& quad, int pointPitch, PointCloudT& output);
 	void updateBoundary();
+	void copyView();
+	void rotatedMinMax(double angle, PointT& min, PointT& max) const;
+	void setGrid(const Eigen::Vector4d& planePara, double angle, int pointPitch, const PointT& proj_min, const PointT& proj_max);
+	void rasterizeQuad(size_t quad, float pointPitch, PointCloudT& cloud) const;
+	void quadsMinMax(double angle, PointT& min, PointT& max) const;
+	void quadMinMax(size_t quad, double angle, PointT& min, PointT& max) const;
+	const KKRecons::CloudStats& pointStats();
 
 public:
 	Plane();
 	Plane(PointCloudT::Ptr rawPointCloud);
 	Plane(PointCloudT::Ptr rawPointCloud, Eigen::Vector4d abcd);
+	/** @brief a view of the indexed points of source, no points are copied until pointCloud() is called.
+	 *         The source must not change while the plane is a view
+	 */
+	Plane(PointCloudT::ConstPtr source, vector<int> indices, Eigen::Vector4d abcd);
 	Plane(PointT a1, PointT a2, PointT b1, PointT b2, float pointPitch, PlaneColor color);
 
 	PlaneEdge leftEdge;
@@ -92,7 +139,25 @@ public:
 	//test
 	int group_index = -1;
 	//test
-	PointCloudT::Ptr pointCloud;
+	/** @brief the points of the plane, a view copies its points here first and stops being a view,
+	 *         the quads are rasterized after them and stop being quads. The points only change through the plane,
+	 *         which keeps its stats and bounds in step with them
+	 */
+	PointCloudT::ConstPtr pointCloud();
+	// the stored points, the quads are not counted until they are rasterized
+	size_t size() const { return isView() ? _indices.size() : _pointCloud->size(); }
+	const PointT& point(size_t i) const { return isView() ? _source->points[_indices[i]] : _pointCloud->points[i]; }
+	bool isView() const { return static_cast<bool>(_source); }
+	const vector<PlaneQuad>& quads() const { return _quads; }
+	const vector<PlaneHole>& holes() const { return _holes; }
+	/** @brief append the stored points and the rasterized quads to cloud
+	 *  @param pointPitch points per metre of the quads, 0 for the pitch they were filled with
+	 */
+	void appendPointsTo(PointCloudT& cloud, float pointPitch = 0) const;
+	/** @brief the box of the stored points and the quads, without the points that are not finite.
+	 *         The corners are not moved by it, they only follow it when the boundary is updated
+	 */
+	void bounds(PointT& min, PointT& max);
 	const PointT& leftDown()         const { return _leftDown; }
 	const PointT& rightDown()        const { return _rightDown; }
 	const PointT& rightUp()          const { return _rightUp; }
@@ -107,6 +172,7 @@ public:
 	// This is for fill the vertical plane based on their boundary.
 	// pros: will fill all the plane, which means ignore same vacant parts of original pts.
 	// cons: the high will change to the projection length to y-z plane
+	// The plane becomes a single quad, the grid points are not generated until they are asked for
 	void filledPlane(int pointPitch);
 	void filledPlane(int pointPitch, float heightUp, float heightDown);
 	void applyFilter(const string axis, float min, float max);
@@ -114,10 +180,13 @@ public:
 	void extendPlane(PointT a1, PointT a2, PointT b1, PointT b2, float pointPitch);
 	void append(Plane const &plane);
 	float getEdgeLength(edgeType type);
-	Eigen::Vector3d getNormal();
+	Eigen::Vector3d getNormal() const;
 	void removePointWithin(float xMin, float xMax, float yMin, float yMax, float zMin, float zMax);
+	/** @brief removePointWithin every box in one pass over the points, a box with max < min is skipped
+	 */
+	void removePointsWithin(const vector<KKRecons::PointBox>& boxes);
 	//ransac
-	void runRANSAC(double distanceFromRANSACPlane, double ratio);
+	bool runRANSAC(double distanceFromRANSACPlane, double ratio);
 };
 
 
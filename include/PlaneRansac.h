@@ -0,0 +1,83 @@
+#ifndef RECONSTRUCTION_PLANERANSAC_H
+#define RECONSTRUCTION_PLANERANSAC_H
+
+#include <vector>
+#include <cstdint>
+#include <Eigen/Core>
+#include <pcl/point_types.h>
+#include <pcl/point_cloud.h>
+
+namespace KKRecons {
+    enum ScoreKernel {
+        ScoreKernel_Auto,   // the widest kernel the cpu supports
+        ScoreKernel_Scalar,
+        ScoreKernel_AVX2,
+        ScoreKernel_AVX512,
+    };
+
+    /** @brief plane RANSAC doing what pcl::SACSegmentation does with SACMODEL_PLANE, SAC_RANSAC and optimized
+     *         coefficients, on a copy of the coordinates kept in SoA float arrays. Hypotheses are scored, and binned for
+     *         the threshold sweep, by AVX-512 or AVX2 kernels where the cpu allows it, with a scalar fallback giving
+     *         the same counts.
+     */
+    class PlaneRansac {
+    public:
+        static const int batchSize = 4; // hypotheses scored per pass over the points
+
+        PlaneRansac();
+        /** @brief copy the xyz of the cloud, non-finite points are kept but never counted as inliers */
+        template<typename PointType>
+        void setInputCloud(const pcl::PointCloud<PointType> &cloud);
+        /** @brief copy the xyz of the indexed points only, inliers are positions in indices then */
+        template<typename PointType>
+        void setInputCloud(const pcl::PointCloud<PointType> &cloud, const std::vector<int> &indices);
+        void setDistanceThreshold(float threshold) { distanceThreshold = threshold; }
+        void setMaxIterations(int iterations) { maxIterations = iterations; }
+        void setProbability(double probability) { this->probability = probability; }
+        /** @brief force a kernel, one the cpu does not support falls back to the next narrower one */
+        void setKernel(ScoreKernel kernel);
+        ScoreKernel kernel() const { return activeKernel; }
+        size_t size() const { return numPoints; }
+        /** @brief hypotheses scored by the last segment() */
+        int iterations() const { return numIterations; }
+
+        /** @brief number of points with |a x + b y + c z + d| < threshold */
+        size_t countWithinDistance(const Eigen::Vector4f &plane, float threshold) const;
+        /** @brief the counts of several planes, batchSize of them share one pass over the points */
+        void countWithinDistance(const Eigen::Vector4f* planes, int numPlanes, float threshold, size_t counts[]) const;
+        void selectWithinDistance(const Eigen::Vector4f &plane, float threshold, std::vector<int> &inliers) const;
+        /** @brief fit a plane, the generator is seeded with seed so a call gives the same plane on any thread
+         * @return false if no plane could be found, inliers is empty then
+         */
+        bool segment(std::vector<int> &inliers, Eigen::Vector4f &coefficients, uint32_t seed = 12345);
+        /** @brief one fit for the smallest threshold baseThreshold + step * j, j < maxSteps, at which a plane keeps at
+         *         least ratio of the points. Every hypothesis of the iteration budget fills a residual histogram with one
+         *         bin per step and the plane needing the fewest steps wins, more inliers breaking ties. Its least squares
+         *         refinement is taken when that needs no more steps.
+         * @param threshold the threshold that was reached
+         * @return false if no hypothesis reaches ratio within maxSteps, inliers is empty then
+         */
+        bool segmentToRatio(double ratio, float baseThreshold, float step, int maxSteps, std::vector<int> &inliers,
+                            Eigen::Vector4f &coefficients, float &threshold, uint32_t seed = 12345);
+
+    private:
+        std::vector<float> x, y, z; // padded with NaN to a multiple of 16
+        size_t numPoints = 0;
+        float distanceThreshold = 0;
+        int maxIterations = 50;
+        double probability = 0.99;
+        int numIterations = 0;
+        ScoreKernel activeKernel = ScoreKernel_Scalar;
+
+        void resizePoints(size_t size);
+        /** @brief residual histograms of 1 or batchSize planes over the sorted thresholds on the active kernel,
+         *         numSteps + 1 bins per plane, the last one for the points beyond every threshold
+         */
+        void residualHistograms(const float planes[][4], int numPlanes, const float* thresholds, int numSteps,
+                                size_t* histograms) const;
+        bool planeFromSample(int i0, int i1, int i2, Eigen::Vector4f &plane) const;
+        void refinePlane(const std::vector<int> &inliers, Eigen::Vector4f &plane) const;
+    };
+}
+
+#endif //RECONSTRUCTION_PLANERANSAC_H
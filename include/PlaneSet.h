@@ -0,0 +1,58 @@
+#ifndef RECONSTRUCTION_PLANESET_H
+#define RECONSTRUCTION_PLANESET_H
+
+#include <vector>
+#include <cstddef>
+#include <Plane.h>
+
+namespace KKRecons {
+    /** @brief what the combine stage of extract_walls tests between pairs of wall planes, computed once per plane
+     *         and stored in SoA arrays. Every predicate tests one plane against all planes of the set in one
+     *         branch free loop the compiler vectorizes, result i belonging to plane i.
+     *         The wall line of a plane runs through its two top corners, seen from above.
+     */
+    class PlaneSet {
+    public:
+        PlaneSet() {}
+        explicit PlaneSet(const std::vector<Plane> &planes) { assign(planes); }
+        void assign(const std::vector<Plane> &planes);
+        size_t size() const { return group.size(); }
+
+        // normal of getNormal() and its length
+        std::vector<double> normalX, normalY, normalZ, normalLength;
+        // top corners, leftUp and rightUp
+        std::vector<float> leftX, leftY, rightX, rightY;
+        // wall line y = slope x + intercept, lineScale = sqrt(slope^2 + 1)
+        std::vector<float> slope, intercept, lineScale;
+        // group_index of the planes, -1 when not grouped
+        std::vector<int> group;
+
+        /** @brief a top corner of plane i is within distance of a top corner of source, source itself is not near */
+        void nearCorners(size_t source, float distance, std::vector<char> &isNear) const;
+        /** @brief nearCorners() of every plane at once: hasNear[i] when any other plane is near plane i.
+         *         The corners are bucketed in a uniform grid with cells of size distance, so each corner is only
+         *         tested against the corners of the cells around it
+         */
+        void anyNearCorners(float distance, std::vector<char> &hasNear) const;
+        /** @brief the angle between the normals of source and plane i is at most maxDegrees */
+        void normalsWithin(size_t source, float maxDegrees, std::vector<char> &isWithin) const;
+        /** @brief mean distance of the top corners of plane i from the wall line of source */
+        void lineDistances(size_t source, std::vector<float> &distances) const;
+        /** @brief the perpendicular of the wall line of source through the left top corner of plane i crosses it
+         *         within the extent of the top corners of source
+         */
+        void overlaps(size_t source, std::vector<char> &isOverlap) const;
+        /** @brief overlaps() with the roles swapped, plane i is tested against the left top corner of target */
+        void overlappedBy(size_t target, std::vector<char> &isOverlap) const;
+        /** @brief the combine grouping of extract_walls: every plane not yet grouped starts a new group, which takes
+         *         in every ungrouped plane within maxDegrees, with its corners within maxDistance of the wall line of
+         *         a member and overlapping it either way, until no more join. Groups are numbered from 0 in the
+         *         order of their first plane.
+         *         Only the planes an angle bucket and a grid over the corner boxes cannot rule out are tested.
+         * @return number of groups started
+         */
+        int groupPlanes(float maxDegrees, float maxDistance);
+    };
+}
+
+#endif //RECONSTRUCTION_PLANESET_H
@@ -0,0 +1,60 @@
+#ifndef RECONSTRUCTION_POINTLOADER_H
+#define RECONSTRUCTION_POINTLOADER_H
+
+#include <string>
+#include <pcl/point_types.h>
+#include <pcl/point_cloud.h>
+#include <MappedFile.h>
+
+namespace KKRecons {
+    enum AsciiFormat {
+        Ascii_CommaXYZARGB, // "x,y,z,a,r,g,b" rows read by Reconstruction
+        Ascii_SpaceXYZARGB, // "x y z a r g b" rows of the scanner dumps read by DownSampling, a is halved
+        Ascii_ObjVertex,    // "v x y z" and "vn nx ny nz" records of an .obj file
+    };
+
+    /** @brief parse the number at the head of [begin, end) like stof does, without allocating.
+     *         Leading white space and trailing characters after the number are ignored.
+     * @return false if the range does not start with a number
+     */
+    bool parseFloat(const char* begin, const char* end, float &value);
+
+    /** @brief split the line [begin, end) on delimiter and parse exactly count numbers into values
+     * @return false if the number of fields differs from count or any field is not a number
+     */
+    bool parseFloatFields(const char* begin, const char* end, char delimiter, float* values, int count);
+
+    /** @brief load an ascii point file with all threads. The file is memory mapped, cut on line boundaries,
+     *         counted, then parsed straight into the preallocated cloud. Lines which can not be parsed are
+     *         dropped and reported with PCL_WARN.
+     * @param threads number of threads, <= 0 means all hardware threads
+     * @return number of dropped lines, or -1 if the file can not be opened
+     */
+    template<typename PointType>
+    long loadAsciiPoints(const std::string &path, AsciiFormat format, pcl::PointCloud<PointType> &cloud, int threads = 0);
+
+    /** @brief read an ascii point file front to back a chunk at a time on the calling thread, for files larger than
+     *         memory. Lines are parsed as loadAsciiPoints parses them, the normals of an obj file are not read. The
+     *         pages of the file that were read are given back, so only the chunk being read is resident.
+     */
+    class AsciiChunkReader {
+    public:
+        /** @return false if the file can not be opened */
+        bool open(const std::string &path, AsciiFormat format);
+        /** @brief replace the points of cloud by the next maxPoints points of the file, fewer at its end
+         * @return false once no point is left
+         */
+        template<typename PointType>
+        bool next(pcl::PointCloud<PointType> &cloud, size_t maxPoints);
+        /** @brief lines read so far which can not be parsed, the first of them are reported with PCL_WARN */
+        size_t droppedLines() const { return numDroppedLines; }
+
+    private:
+        MappedFile file;
+        AsciiFormat format = Ascii_CommaXYZARGB;
+        const char* cursor = nullptr;
+        size_t numDroppedLines = 0;
+    };
+}
+
+#endif //RECONSTRUCTION_POINTLOADER_H
@@ -0,0 +1,45 @@
+#ifndef RECONSTRUCTION_QUADRASTER_H
+#define RECONSTRUCTION_QUADRASTER_H
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <pcl/point_types.h>
+#include <pcl/point_cloud.h>
+
+namespace KKRecons {
+    /** @brief the straight line fill of the extension planes, the corner quads and the ceiling and floor lines.
+     *         Lines are queued with the number of points they get, rasterize() resizes the output once and writes
+     *         the lines in parallel, each at its place in queue order. The points and their order are those of
+     *         the per point push_back loops the fill was written with.
+     */
+    template<typename PointType>
+    class QuadRaster {
+    public:
+        /** @param threads number of threads, <= 0 means all hardware threads */
+        explicit QuadRaster(int threads = 0) : total(0), threads(threads) {}
+
+        /** @brief queue the points from pt2 towards pt1, one per 1 / pointPitch, pt1 itself only when withEnd */
+        void addLine(const PointType &pt1, const PointType &pt2, int pointPitch, int32_t color, bool withEnd);
+        /** @brief queue the quad a1-a2 => b1-b2: a line from each step along b1-b2 to the same step along a1-a2 */
+        void addQuad(const PointType &a1, const PointType &a2, const PointType &b1, const PointType &b2,
+                     float pointPitch, int32_t color);
+        // points of the queued lines
+        size_t size() const { return total; }
+        /** @brief append the points of the queued lines to output and empty the queue */
+        void rasterize(pcl::PointCloud<PointType> &output);
+
+    private:
+        struct Line {
+            float x, y, z;                // first point, pt2
+            float stepX, stepY, stepZ;
+            size_t count, offset;
+            int32_t color;
+        };
+        std::vector<Line> lines;
+        size_t total;
+        int threads;
+    };
+}
+
+#endif //RECONSTRUCTION_QUADRASTER_H
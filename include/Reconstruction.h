@@ -4,6 +4,9 @@
 #include <iostream>
 #include <vector>
 #include "Plane.h"
+#include "KnnGraph.h"
+#include "PerfReport.h"
+#include "CloudCache.h"
 typedef pcl::PointXYZRGB PointRGB;
 typedef pcl::PointXYZRGBNormal PointT;
 typedef pcl::PointCloud<PointT> PointCloudT;
@@ -14,27 +17,54 @@ class Reconstruction
 {
 
 public:
-	Reconstruction(const string filePath);
+	Reconstruction(const string filePath, bool isUseCache = false);
+	// load and downsample with the out-of-core engine in one go. txt files are streamed into the tiles, so the raw
+	// cloud is never held in memory; ply, pcd and obj files (whose normals are listed apart from their vertices)
+	// are still loaded whole before they are tiled
+	Reconstruction(const string filePath, float leafSize, int outOfCoreMemoryMB, bool isUseCache = false);
 	bool isPrintDebugInfo = true;
 	bool isOutputEachStep = true;
+	bool isUseCache; // read and write .kkc caches next to the input file, off unless asked for
+	int numberOfThreads = 0; // threads of the parallel stages, 0 uses all cores
 	string outputPath = "OutputData/";
 	//reconstructParas paras;
 	PointCloudT::Ptr pointCloud;
-	void downSampling(float leafSize);
+	void downSampling(float leafSize, int outOfCoreMemoryMB = 0);
 	void applyRegionGrow(int NumberOfNeighbours, int SmoothnessThreshold, int CurvatureThreshold, int MinSizeOfCluster, int KSearch);
 	void applyRANSACtoClusters(float RANSAC_DistThreshold, float RANSAC_PlaneVectorThreshold,
 		float RANSAC_MinInliers);
+	/** @brief detect the planes of the whole cloud in one pass, see KKRecons::detectPlanes. An alternative to
+	 *         applyRegionGrow followed by applyRANSACtoClusters, filling ransacPlanes the same way
+	 * @param NormalThreshold max angle between a point normal and the plane normal in degrees
+	 */
+	void applyEfficientRANSAC(float RANSAC_DistThreshold, float RANSAC_PlaneVectorThreshold,
+		float NormalThreshold, float ClusterEpsilon, int MinSupport, int KSearch);
 	// output methods
 	void outputFile(const string path);
 	void getPlane(PlaneOrientation ori, vector<Plane>& planes);
-	vector<PointCloudT::Ptr> clusters; // store the result of region grow
-	vector<Plane> ransacPlanes;
+	// the result of region grow, as indices into pointCloud
+	vector<pcl::PointIndices> clusters;
+	vector<int> clusterLabels; // cluster of every point of pointCloud, -1 if it is in none
+	PointCloudT::Ptr clusterCloud(size_t cluster) const; // copy of the points of a cluster
+	vector<Plane> ransacPlanes; // views into pointCloud until their points are changed
+	KKRecons::PerfReport perfReport; // a stage per step run so far, loading included
 	
 private:
+	string sourcePath;
+	float currentLeafSize = 0; // leaf size the current cloud was downsampled with, 0 if not downsampled
+	KKRecons::CacheVoxelEngine currentVoxelEngine = KKRecons::VoxelEngine_InMemory; // the engine it was downsampled with
+	int normalsKSearch = 0; // KSearch the current normals were estimated with, -1 from the input, 0 if none
+	bool isCacheLoaded = false;
+	KKRecons::KnnGraph<PointT> knnGraph; // neighbours shared by the normal estimation and the region growing
 	void debugPrint(stringstream& ss);
-	void calculateRANSAC_plane(PointCloudT::Ptr cloud_cluster, pcl::PointIndices::Ptr sacInliers,
-		pcl::ModelCoefficients::Ptr sacCoefficients, double distanceFromRANSACPlane);
-	void calculateNormals(pcl::PointCloud <pcl::Normal>::Ptr &normals_all, int KSearch);
+	string checkFileType(const string& filePath);
+	void loadPointCloud(const string& filePath);
+	bool loadCache(float leafSize);
+	void saveCache(float leafSize, int kSearch, bool hasNormals);
+	int calculateRANSAC_plane(const vector<int>& cluster, pcl::PointIndices::Ptr sacInliers,
+		pcl::ModelCoefficients::Ptr sacCoefficients, double distanceFromRANSACPlane, uint32_t seed);
+	void calculateNormals(int KSearch);
+	void buildKnnGraph(int k);
 };
 
 
@@ -0,0 +1,31 @@
+#ifndef RECONSTRUCTION_REGIONGROWINGENGINE_H
+#define RECONSTRUCTION_REGIONGROWINGENGINE_H
+
+#include <vector>
+#include <pcl/point_types.h>
+#include <pcl/point_cloud.h>
+#include <pcl/PointIndices.h>
+#include <KnnGraph.h>
+
+namespace KKRecons {
+    /** @brief multi-threaded smooth region growing with the tests of pcl::RegionGrowing: a neighbour joins a region when
+     *         |n_point . n_neighbour| >= cos(smoothnessThreshold), and it keeps growing the region only when its curvature
+     *         is not above curvatureThreshold. The cloud is cut into one x slab per thread, regions are grown inside each
+     *         slab in parallel, and regions meeting across slab borders are merged by a lock-free union-find.
+     *         Every smooth edge between two seed points merges their regions, whichever way the kNN lists point.
+     *         A point which may not grow a region joins the region of the nearest seed that has it among its
+     *         neighbours with a smooth normal, as pcl::RegionGrowing adds it, or stays alone.
+     *         Regions have no size limit and depend on neither the thread count nor the order of the points.
+     *         Clusters are ordered by their smallest point index.
+     * @param graph kNN graph of the cloud, its first numberOfNeighbours entries per point are used
+     * @param smoothnessThreshold angle in radians
+     * @param threads number of threads, <= 0 means all hardware threads
+     * @param queuePushes if not null, set to the number of points queued while the regions grew
+     */
+    template<typename PointType>
+    void growRegions(const pcl::PointCloud<PointType> &cloud, const KnnGraph<PointType> &graph, int numberOfNeighbours,
+                     float smoothnessThreshold, float curvatureThreshold, std::vector<pcl::PointIndices> &clusters,
+                     int threads = 0, size_t *queuePushes = nullptr);
+}
+
+#endif //RECONSTRUCTION_REGIONGROWINGENGINE_H
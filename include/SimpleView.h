@@ -9,6 +9,9 @@ using namespace std;
 typedef pcl::PointXYZRGBNormal PointT;
 typedef pcl::PointCloud<PointT> PointCloudT;
 
+/** @brief with headless set, every simpleView returns at once and no window is opened */
+void setSimpleViewHeadless(bool isHeadless);
+
 void simpleView(const string &title, const pcl::PointCloud<pcl::PointXYZRGBNormal>::Ptr &cloud);
 
 void simpleView(const string& title, vector<Plane> &planes);
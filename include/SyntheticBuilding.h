@@ -0,0 +1,67 @@
+#ifndef RECONSTRUCTION_SYNTHETICBUILDING_H
+#define RECONSTRUCTION_SYNTHETICBUILDING_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <Eigen/Core>
+#include <pcl/point_types.h>
+
+namespace KKRecons {
+    /** @brief one floor of roomsX x roomsY equal rooms on the X-Y plane, floor at z = 0 */
+    struct BuildingSpec {
+        int roomsX = 4;
+        int roomsY = 3;
+        float roomWidth = 5;      // along x, meters
+        float roomDepth = 4;      // along y
+        float height = 3;
+        float wallThickness = 0.15f; // interior walls are scanned from both sides
+        float doorWidth = 0.9f, doorHeight = 2.1f; // one door in the middle of every interior wall of a room
+        float windowWidth = 1.2f, windowHeight = 1.0f, sillHeight = 0.9f; // one window per exterior wall of a room
+        float noise = 0.005f;     // standard deviation along the surface normal
+        float clutter = 0.1f;     // share of the points on furniture
+        int boxesPerRoom = 3;     // furniture boxes standing on the floor of every room
+        uint64_t numPoints = 1000000;
+        uint32_t seed = 1;
+    };
+
+    /** @brief deterministic synthetic scan of a building interior. The points are drawn uniformly over the walls,
+     *         floor and ceiling, none in the openings, and over the furniture. Point i only depends on the spec,
+     *         so any range of the scan is the same whichever way it is cut and however many threads draw it, and
+     *         a scan larger than memory is written block by block
+     */
+    class SyntheticBuilding {
+    public:
+        explicit SyntheticBuilding(const BuildingSpec &spec);
+
+        const BuildingSpec &spec() const { return _spec; }
+        size_t numSurfaces() const { return surfaces.size(); }
+        /** @brief points [begin, end) of the scan with their surface normals and colors
+         *  @param threads number of threads, <= 0 means all hardware threads
+         */
+        void generate(uint64_t begin, uint64_t end, pcl::PointXYZRGBNormal *out, int threads = 0) const;
+        /** @brief write the scan in a format Reconstruction loads, picked by the extension of path: binary .ply
+         *         and .pcd with x y z and colors, .txt rows "x,y,z,a,r,g,b", .obj "v x y z" records
+         *  @return false if the extension is unknown or the file cannot be written
+         */
+        bool write(const std::string &path, int threads = 0) const;
+
+    private:
+        // a rectangle origin + s * u + t * v, s and t in [0, 1], facing normal
+        struct Surface {
+            Eigen::Vector3f origin, u, v, normal;
+            uint32_t rgba;
+            std::vector<Eigen::Vector4f> holes; // (s0, t0, s1, t1), points drawn inside are drawn again
+        };
+        void addSurface(const Eigen::Vector3f &origin, const Eigen::Vector3f &u, const Eigen::Vector3f &v,
+                        const Eigen::Vector3f &normal, uint32_t rgba, const std::vector<Eigen::Vector4f> &holes);
+        void generateBlock(uint64_t block, pcl::PointXYZRGBNormal *out, size_t count) const;
+
+        BuildingSpec _spec;
+        std::vector<Surface> surfaces;  // structure first, then furniture
+        std::vector<double> cumulativeArea; // open area of surfaces [0, i]
+        size_t numStructure;
+    };
+}
+
+#endif //RECONSTRUCTION_SYNTHETICBUILDING_H
@@ -0,0 +1,40 @@
+#ifndef RECONSTRUCTION_THROUGHPUTCHECK_H
+#define RECONSTRUCTION_THROUGHPUTCHECK_H
+
+#include <string>
+#include <vector>
+#include <PerfReport.h>
+
+namespace KKRecons {
+    /** @brief items per wall second of one stage in a baseline run and in the current one */
+    struct StageThroughput {
+        std::string name;
+        double baseline = 0;
+        double current = 0;
+        bool isMissing = false;   // the current run has no such stage
+        bool isSkipped = false;   // too short or without items in the baseline to be compared
+        bool isRegressed = false; // slower than the baseline by more than the tolerance
+
+        double change() const { return baseline > 0 ? current / baseline - 1 : 0; }
+    };
+
+    /** @brief items a stage went through, the items in or, for a stage that only makes items like the load, out */
+    double stageThroughput(const StageRecord &stage);
+
+    /** @brief compare every stage of baseline with the stage of the same name in current. The n-th stage of a
+     *         name is matched with the n-th one of current. The result is in baseline order
+     *  @param tolerance fraction of the baseline throughput a stage may lose
+     *  @param minSeconds stages which took less wall time in the baseline are too noisy and skipped
+     */
+    std::vector<StageThroughput> compareThroughput(const std::vector<StageRecord> &baseline,
+                                                   const std::vector<StageRecord> &current, double tolerance,
+                                                   double minSeconds);
+
+    /** @brief read the stages of a report written by PerfReport::writeJson, counters included
+     *  @param inputPoints if given, set to the points of the scan of the run, 0 for a report without them
+     *  @return false if the file cannot be read or is not a report
+     */
+    bool readPerfReport(const std::string &path, std::vector<StageRecord> &stages, size_t *inputPoints = nullptr);
+}
+
+#endif //RECONSTRUCTION_THROUGHPUTCHECK_H
@@ -0,0 +1,72 @@
+#ifndef RECONSTRUCTION_TILEDVOXELFILTER_H
+#define RECONSTRUCTION_TILEDVOXELFILTER_H
+
+#include <map>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <pcl/point_types.h>
+#include <pcl/point_cloud.h>
+
+namespace KKRecons {
+    /** @brief out-of-core voxel grid filter. Points are spilled into cubic tiles on disk, and each tile is
+     *         voxelized on its own within the memory budget. Tiles are aligned to the voxel grid, so every
+     *         voxel lies in exactly one tile and the result has no seams. A tile that does not fit the budget
+     *         is split into 8 smaller tiles recursively. Voxel coordinates are 64 bit, so unlike pcl::VoxelGrid
+     *         any leaf size works for any extent.
+     */
+    template<typename PointType>
+    class TiledVoxelFilter {
+    public:
+        /** @param memoryBudget bytes the filter may hold in memory, spill buffers and the tile being voxelized
+         *  @param spillDirectory where the tile files are written, they are removed with the filter
+         *  @param tileVoxels edge length of a tile in voxels
+         *  @param threads threads voxelizing a tile, <= 0 means all hardware threads
+         */
+        TiledVoxelFilter(float leafSize, size_t memoryBudget, const std::string &spillDirectory = "./", int64_t tileVoxels = 256, int threads = 0);
+        ~TiledVoxelFilter();
+        void add(const PointType &p);
+        void add(const pcl::PointCloud<PointType> &cloud);
+        /** @brief voxelize all added points and append one centroid per voxel to output
+         */
+        void filter(pcl::PointCloud<PointType> &output);
+        uint64_t size() const { return numPoints; };
+        size_t numTiles() const { return tiles.size(); };
+    private:
+        typedef std::vector<PointType, Eigen::aligned_allocator<PointType> > PointVector;
+        struct TileKey {
+            int64_t k, j, i; // z major, the order pcl::VoxelGrid outputs voxels in
+            bool operator<(const TileKey &o) const {
+                if (k != o.k) return k < o.k;
+                if (j != o.j) return j < o.j;
+                return i < o.i;
+            }
+        };
+        struct Tile {
+            PointVector buffer;
+            std::string path;
+            uint64_t numSpilled = 0;
+        };
+        TiledVoxelFilter(const TiledVoxelFilter&);
+        TiledVoxelFilter& operator=(const TiledVoxelFilter&);
+
+        float leafSize;
+        float inverseLeaf;
+        size_t memoryBudget;
+        std::string spillDirectory;
+        int64_t tileVoxels;
+        int threads;
+        std::string filePrefix;
+        std::map<TileKey, Tile> tiles;
+        size_t numBuffered = 0;
+        uint64_t numPoints = 0;
+
+        void spill();
+        void spillTile(const TileKey &key, Tile &tile);
+        template<typename Func>
+        void readTile(Tile &tile, size_t chunk, Func func);
+        void filterTile(const TileKey &key, Tile &tile, pcl::PointCloud<PointType> &output);
+    };
+}
+
+#endif //RECONSTRUCTION_TILEDVOXELFILTER_H
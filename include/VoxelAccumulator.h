@@ -0,0 +1,80 @@
+#ifndef RECONSTRUCTION_VOXELACCUMULATOR_H
+#define RECONSTRUCTION_VOXELACCUMULATOR_H
+
+#include <cmath>
+#include <cstdint>
+#include <pcl/point_types.h>
+
+namespace KKRecons {
+    /** @brief integer voxel coordinates of a point, computed like pcl::VoxelGrid (floor of p * (1 / leaf))
+     *         but in 64 bit, so no extent or leaf size overflows. False for points that are not finite.
+     */
+    template<typename PointType>
+    inline bool voxelCoordinates(const PointType &p, float inverseLeaf, int64_t ijk[3]) {
+        if (!std::isfinite(p.x) || !std::isfinite(p.y) || !std::isfinite(p.z)) return false;
+        ijk[0] = static_cast<int64_t>(std::floor(p.x * inverseLeaf));
+        ijk[1] = static_cast<int64_t>(std::floor(p.y * inverseLeaf));
+        ijk[2] = static_cast<int64_t>(std::floor(p.z * inverseLeaf));
+        return true;
+    }
+
+    /** @brief running sum of the points of one voxel. The average is taken per field like pcl::VoxelGrid does:
+     *         xyz, each color channel, the normal components and the curvature are averaged separately.
+     */
+    struct VoxelAccumulator {
+        double xyz[3] = {0, 0, 0};
+        double rgba[4] = {0, 0, 0, 0};
+        double normal[3] = {0, 0, 0};
+        double curvature = 0;
+        uint64_t count = 0;
+
+        void addColor(uint8_t r, uint8_t g, uint8_t b, uint8_t a) {
+            rgba[0] += r; rgba[1] += g; rgba[2] += b; rgba[3] += a;
+        }
+        void add(const pcl::PointXYZRGB &p) {
+            xyz[0] += p.x; xyz[1] += p.y; xyz[2] += p.z;
+            addColor(p.r, p.g, p.b, p.a);
+            count++;
+        }
+        void add(const pcl::PointXYZRGBNormal &p) {
+            xyz[0] += p.x; xyz[1] += p.y; xyz[2] += p.z;
+            addColor(p.r, p.g, p.b, p.a);
+            normal[0] += p.normal_x; normal[1] += p.normal_y; normal[2] += p.normal_z;
+            curvature += p.curvature;
+            count++;
+        }
+        void merge(const VoxelAccumulator &other) {
+            for (int k = 0; k < 3; ++k) {
+                xyz[k] += other.xyz[k];
+                normal[k] += other.normal[k];
+            }
+            for (int k = 0; k < 4; ++k) rgba[k] += other.rgba[k];
+            curvature += other.curvature;
+            count += other.count;
+        }
+        void getColor(uint8_t &r, uint8_t &g, uint8_t &b, uint8_t &a) const {
+            r = static_cast<uint8_t>(static_cast<int>(rgba[0] / count));
+            g = static_cast<uint8_t>(static_cast<int>(rgba[1] / count));
+            b = static_cast<uint8_t>(static_cast<int>(rgba[2] / count));
+            a = static_cast<uint8_t>(static_cast<int>(rgba[3] / count));
+        }
+        void get(pcl::PointXYZRGB &p) const {
+            p.x = static_cast<float>(xyz[0] / count);
+            p.y = static_cast<float>(xyz[1] / count);
+            p.z = static_cast<float>(xyz[2] / count);
+            getColor(p.r, p.g, p.b, p.a);
+        }
+        void get(pcl::PointXYZRGBNormal &p) const {
+            p.x = static_cast<float>(xyz[0] / count);
+            p.y = static_cast<float>(xyz[1] / count);
+            p.z = static_cast<float>(xyz[2] / count);
+            getColor(p.r, p.g, p.b, p.a);
+            p.normal_x = static_cast<float>(normal[0] / count);
+            p.normal_y = static_cast<float>(normal[1] / count);
+            p.normal_z = static_cast<float>(normal[2] / count);
+            p.curvature = static_cast<float>(curvature / count);
+        }
+    };
+}
+
+#endif //RECONSTRUCTION_VOXELACCUMULATOR_H
@@ -0,0 +1,26 @@
+#ifndef RECONSTRUCTION_VOXELGRIDENGINE_H
+#define RECONSTRUCTION_VOXELGRIDENGINE_H
+
+#include <vector>
+#include <cstdint>
+#include <pcl/point_types.h>
+#include <pcl/point_cloud.h>
+
+namespace KKRecons {
+    /** @brief stable LSD radix sort of (key, value) pairs on the lowest `bits` bits of the keys, 8 bits per pass.
+     *         Each pass is histogrammed and scattered by all threads, passes where every key has the same
+     *         digit are skipped.
+     */
+    void radixSortPairs(std::vector<uint64_t> &keys, std::vector<uint32_t> &values, int bits, int threads = 0);
+
+    /** @brief multi-threaded voxel grid filter giving the same voxels, in the same order, as pcl::VoxelGrid.
+     *         Voxel keys are computed in SIMD where the cpu allows it, radix sorted by all threads, and the
+     *         centroids are reduced in parallel. Keys grow to as many 64 bit words as the extent needs, so
+     *         there is no index overflow. xyz, rgba, normals and curvature are averaged per field.
+     * @param threads number of threads, <= 0 means all hardware threads
+     */
+    template<typename PointType>
+    void voxelGridFilter(const pcl::PointCloud<PointType> &input, float leafSize, pcl::PointCloud<PointType> &output, int threads = 0);
+}
+
+#endif //RECONSTRUCTION_VOXELGRIDENGINE_H
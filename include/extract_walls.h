@@ -28,10 +28,9 @@ using namespace std;
 typedef pcl::PointXYZRGBNormal PointT;
 typedef pcl::PointCloud<PointT> PointCloudT;
 
-void generateLinePointCloud(PointT pt1, PointT pt2, int pointPitch, int color, PointCloudT::Ptr output);
-
 // mark: for debug reason
-void extendSmallPlaneToBigPlane(Plane& sourceP, Plane& targetP, int color, int pointPitch, PointCloudT::Ptr output);
+// returns the box of targetP the extended sourceP covers, for targetP.removePointsWithin
+KKRecons::PointBox extendSmallPlaneToBigPlane(Plane& sourceP, Plane& targetP, int color, int pointPitch);
 bool onSegment(PointT p, PointT q, PointT r);
 float orientation(PointT p, PointT q, PointT r);
 bool isIntersect(PointT p1, PointT q1, PointT p2, PointT q2);
@@ -0,0 +1,94 @@
+#include <cmath>
+#include <pcl/point_types.h>
+#include <BoxRemoval.h>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define KK_BOX_AVX2
+#endif
+
+using namespace std;
+
+namespace {
+    const int batch = 8;
+
+    // the condition removePointWithin built from pcl::FieldComparison, true for a point it keeps
+    template<typename PointType>
+    inline bool isKept(const PointType &p, const KKRecons::PointBox *boxes, size_t boxCount) {
+        bool isOutside = std::isfinite(p.x) && std::isfinite(p.y) && std::isfinite(p.z);
+        for (size_t b = 0; b < boxCount && isOutside; ++b) {
+            const KKRecons::PointBox &box = boxes[b];
+            isOutside = p.z < box.zMin || p.z > box.zMax || p.x < box.xMin || p.x > box.xMax ||
+                        (p.y < box.yMin && p.y > box.yMax);
+        }
+        return isOutside;
+    }
+
+    // bit n set when points[n] of up to 8 points is kept
+    template<typename PointType>
+    int keptMaskScalar(const PointType *points, size_t count, const KKRecons::PointBox *boxes, size_t boxCount) {
+        int mask = 0;
+        for (size_t n = 0; n < count; ++n) {
+            mask |= (int) isKept(points[n], boxes, boxCount) << n;
+        }
+        return mask;
+    }
+
+#ifdef KK_BOX_AVX2
+    template<typename PointType>
+    __attribute__((target("avx2")))
+    int keptMaskAVX2(const PointType *points, const KKRecons::PointBox *boxes, size_t boxCount) {
+        const PointType *p = points;
+        __m256 x = _mm256_set_ps(p[7].x, p[6].x, p[5].x, p[4].x, p[3].x, p[2].x, p[1].x, p[0].x);
+        __m256 y = _mm256_set_ps(p[7].y, p[6].y, p[5].y, p[4].y, p[3].y, p[2].y, p[1].y, p[0].y);
+        __m256 z = _mm256_set_ps(p[7].z, p[6].z, p[5].z, p[4].z, p[3].z, p[2].z, p[1].z, p[0].z);
+        __m256 zero = _mm256_setzero_ps();
+        // v - v is 0 only for finite v
+        __m256 kept = _mm256_and_ps(_mm256_cmp_ps(_mm256_sub_ps(x, x), zero, _CMP_EQ_OQ),
+                      _mm256_and_ps(_mm256_cmp_ps(_mm256_sub_ps(y, y), zero, _CMP_EQ_OQ),
+                                    _mm256_cmp_ps(_mm256_sub_ps(z, z), zero, _CMP_EQ_OQ)));
+        for (size_t b = 0; b < boxCount; ++b) {
+            const KKRecons::PointBox &box = boxes[b];
+            __m256 outsideZ = _mm256_or_ps(_mm256_cmp_ps(z, _mm256_set1_ps(box.zMin), _CMP_LT_OQ),
+                                           _mm256_cmp_ps(z, _mm256_set1_ps(box.zMax), _CMP_GT_OQ));
+            __m256 outsideX = _mm256_or_ps(_mm256_cmp_ps(x, _mm256_set1_ps(box.xMin), _CMP_LT_OQ),
+                                           _mm256_cmp_ps(x, _mm256_set1_ps(box.xMax), _CMP_GT_OQ));
+            __m256 outsideY = _mm256_and_ps(_mm256_cmp_ps(y, _mm256_set1_ps(box.yMin), _CMP_LT_OQ),
+                                            _mm256_cmp_ps(y, _mm256_set1_ps(box.yMax), _CMP_GT_OQ));
+            kept = _mm256_and_ps(kept, _mm256_or_ps(_mm256_or_ps(outsideZ, outsideX), outsideY));
+        }
+        return _mm256_movemask_ps(kept);
+    }
+
+    bool hasAVX2() {
+        static const bool isSupported = __builtin_cpu_supports("avx2");
+        return isSupported;
+    }
+#endif
+
+    template<typename PointType>
+    inline int keptMask(const PointType *points, size_t count, const KKRecons::PointBox *boxes, size_t boxCount) {
+#ifdef KK_BOX_AVX2
+        if (count == batch && hasAVX2()) return keptMaskAVX2(points, boxes, boxCount);
+#endif
+        return keptMaskScalar(points, count, boxes, boxCount);
+    }
+}
+
+template<typename PointType>
+size_t KKRecons::removeWithinBoxes(PointType *points, size_t count, const PointBox *boxes, size_t boxCount) {
+    size_t kept = 0;
+    for (size_t i = 0; i < count; i += batch) {
+        size_t n = count - i < batch ? count - i : batch;
+        int mask = keptMask(points + i, n, boxes, boxCount);
+        for (size_t j = 0; j < n; ++j) {
+            if (!((mask >> j) & 1)) continue;
+            // nothing moves until the first point is removed
+            if (kept != i + j) points[kept] = points[i + j];
+            ++kept;
+        }
+    }
+    return kept;
+}
+
+template size_t KKRecons::removeWithinBoxes<pcl::PointXYZRGBNormal>(pcl::PointXYZRGBNormal*, size_t,
+                                                                    const KKRecons::PointBox*, size_t);
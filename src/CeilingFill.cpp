@@ -0,0 +1,130 @@
+#include <cmath>
+#include <cfloat>
+#include <algorithm>
+#include <CeilingFill.h>
+#include <CloudStats.h>
+#include <Parallel.h>
+
+using namespace std;
+
+namespace {
+    // width of a window along x
+    const double windowWidth = 0.1;
+}
+
+template<typename PointType>
+void KKRecons::CeilingFill<PointType>::setInputCloud(const pcl::PointCloud<PointType> &cloud, int pointPitch) {
+    this->pointPitch = pointPitch;
+    step = 1 / (float) pointPitch;
+    const CloudStats stats = computeCloudStats(cloud, threads);
+    const float minZ = stats.min.z(), maxZ = stats.max.z();
+    // the limits PassThrough was given, it passes finite points only
+    const float topLow = maxZ - 2 * step, downHigh = minZ + 2 * step;
+    topSlab->clear();
+    downSlab->clear();
+    topMinX = FLT_MAX;
+    topMaxX = -FLT_MAX;
+    for (size_t i = 0; i < cloud.points.size(); ++i) {
+        const PointType &p = cloud.points[i];
+        if (!std::isfinite(p.x) || !std::isfinite(p.y) || !std::isfinite(p.z)) continue;
+        if (p.z >= topLow && p.z <= maxZ) {
+            topSlab->push_back(p);
+            topMinX = min(topMinX, p.x);
+            topMaxX = max(topMaxX, p.x);
+        }
+        if (p.z >= minZ && p.z <= downHigh) downSlab->push_back(p);
+    }
+}
+
+/** @brief the extent of the slab points in each cell. Cell 2 j holds the points at edges[j], cell 2 j + 1 those
+ *         between edges[j] and edges[j + 1], the last one those beyond the last edge
+ */
+template<typename PointType>
+void KKRecons::CeilingFill<PointType>::foldCells(const pcl::PointCloud<PointType> &slab, const vector<float> &edges,
+                                                 bool isTop, vector<Extent> &cells) const {
+    const Extent empty = {FLT_MAX, -FLT_MAX, isTop ? -FLT_MAX : FLT_MAX};
+    const size_t cellCount = 2 * edges.size();
+    // every thread folds into its own cells, no more threads than there are points per cell
+    size_t numThreads = slab.size() < minParallelItems ? 1 : (size_t) resolveThreads(threads);
+    numThreads = max<size_t>(1, min(numThreads, slab.size() / cellCount));
+    vector<vector<Extent> > partial(numThreads, vector<Extent>(cellCount, empty));
+    parallelFor(slab.size(), (int) numThreads, [&](size_t begin, size_t end, size_t t) {
+        Extent *own = partial[t].data();
+        for (size_t i = begin; i < end; ++i) {
+            const PointType &p = slab.points[i];
+            size_t above = upper_bound(edges.begin(), edges.end(), p.x) - edges.begin();
+            if (above == 0) continue; // before the first window
+            size_t j = above - 1;
+            Extent &cell = own[2 * j + (edges[j] == p.x ? 0 : 1)];
+            cell.minY = min(cell.minY, p.y);
+            cell.maxY = max(cell.maxY, p.y);
+            cell.z = isTop ? max(cell.z, p.z) : min(cell.z, p.z);
+        }
+    });
+    cells.swap(partial[0]);
+    for (size_t t = 1; t < numThreads; ++t) {
+        for (size_t c = 0; c < cellCount; ++c) {
+            const Extent &other = partial[t][c];
+            cells[c].minY = min(cells[c].minY, other.minY);
+            cells[c].maxY = max(cells[c].maxY, other.maxY);
+            cells[c].z = isTop ? max(cells[c].z, other.z) : min(cells[c].z, other.z);
+        }
+    }
+}
+
+template<typename PointType>
+void KKRecons::CeilingFill<PointType>::addLines(int32_t color, QuadRaster<PointType> &lines) const {
+    if (topSlab->empty() || downSlab->size() < 2) return;
+    // window k is [starts[k], ends[k]], the bounds PassThrough compared in float
+    vector<float> starts, ends;
+    for (float i = topMinX; i < topMaxX; i += step) { // NOLINT
+        starts.push_back(i);
+        ends.push_back((float) (i + windowWidth));
+    }
+    vector<float> edges(starts);
+    edges.insert(edges.end(), ends.begin(), ends.end());
+    sort(edges.begin(), edges.end());
+    edges.erase(unique(edges.begin(), edges.end()), edges.end());
+    if (edges.empty()) return;
+
+    vector<Extent> topCells, downCells;
+    foldCells(*topSlab, edges, true, topCells);
+    foldCells(*downSlab, edges, false, downCells);
+    // a window covers the cells from the one at its start to the one at its end
+    vector<Extent> topWindows(starts.size()), downWindows(starts.size());
+    parallelFor(starts.size(), threads, [&](size_t begin, size_t end, size_t) {
+        for (size_t k = begin; k < end; ++k) {
+            size_t first = 2 * (lower_bound(edges.begin(), edges.end(), starts[k]) - edges.begin());
+            size_t last = 2 * (lower_bound(edges.begin(), edges.end(), ends[k]) - edges.begin());
+            Extent top = {FLT_MAX, -FLT_MAX, -FLT_MAX}, down = {FLT_MAX, -FLT_MAX, FLT_MAX};
+            for (size_t c = first; c <= last; ++c) {
+                top.minY = min(top.minY, topCells[c].minY);
+                top.maxY = max(top.maxY, topCells[c].maxY);
+                top.z = max(top.z, topCells[c].z);
+                down.minY = min(down.minY, downCells[c].minY);
+                down.maxY = max(down.maxY, downCells[c].maxY);
+                down.z = min(down.z, downCells[c].z);
+            }
+            topWindows[k] = top;
+            downWindows[k] = down;
+        }
+    });
+
+    for (size_t k = 0; k < starts.size(); ++k) {
+        const Extent &top = topWindows[k], &down = downWindows[k];
+        PointType p1, g1, p2, g2;
+        p1.x = starts[k]; p1.y = top.minY; p1.z = top.z;
+        g1.x = starts[k]; g1.y = top.maxY; g1.z = top.z;
+        p2.x = starts[k]; p2.y = down.minY; p2.z = down.z;
+        g2.x = starts[k]; g2.y = down.maxY; g2.z = down.z;
+        // an empty window keeps the FLT_MAX it started with and is left out here
+        if (abs(p1.y) < 10000 && abs(p1.z) < 10000 && abs(g1.y) < 10000 && abs(g1.z) < 10000) {
+            lines.addLine(p1, g1, pointPitch, color, false);
+        }
+        if (abs(p2.y) < 10000 && abs(p2.z) < 10000 && abs(g2.y) < 10000 && abs(g2.z) < 10000) {
+            lines.addLine(p2, g2, pointPitch, color, false);
+        }
+    }
+}
+
+template class KKRecons::CeilingFill<pcl::PointXYZRGBNormal>;
@@ -0,0 +1,161 @@
+#include <fstream>
+#include <cstring>
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+#include <sys/stat.h>
+#include <CloudCache.h>
+#include <Parallel.h>
+
+using namespace std;
+
+namespace {
+    const char cacheMagic[8] = {'K', 'K', 'R', 'C', 'L', 'O', 'U', 'D'};
+    const uint32_t cacheVersion = 2; // 2 records the voxel engine
+    const uint64_t columnAlignment = 64;
+
+    bool sourceStat(const string &path, uint64_t &size, int64_t &time) {
+        struct stat st;
+        if (stat(path.c_str(), &st) != 0) return false;
+        size = static_cast<uint64_t>(st.st_size);
+        time = static_cast<int64_t>(st.st_mtime);
+        return true;
+    }
+
+    inline float columnValue(const pcl::PointXYZRGBNormal &p, int c) {
+        switch (c) {
+        case KKRecons::Column_X: return p.x;
+        case KKRecons::Column_Y: return p.y;
+        case KKRecons::Column_Z: return p.z;
+        case KKRecons::Column_NormalX: return p.normal_x;
+        case KKRecons::Column_NormalY: return p.normal_y;
+        case KKRecons::Column_NormalZ: return p.normal_z;
+        case KKRecons::Column_Curvature: return p.curvature;
+        default: {
+            float v;
+            memcpy(&v, &p.rgba, sizeof(v));
+            return v;
+        }
+        }
+    }
+}
+
+string KKRecons::CloudCache::cachePath(const string &sourcePath, float leafSize, CacheVoxelEngine engine) {
+    if (leafSize == 0) return sourcePath + ".kkc";
+    return sourcePath + ".leaf" + to_string(leafSize) + (engine == VoxelEngine_Tiled ? ".tiled" : "") + ".kkc";
+}
+
+bool KKRecons::CloudCache::write(const string &path, const string &sourcePath, const pcl::PointCloud<pcl::PointXYZRGBNormal> &cloud,
+                                 float leafSize, int kSearch, bool hasNormals, int threads, CacheVoxelEngine engine) {
+    CloudCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, cacheMagic, sizeof(cacheMagic));
+    header.version = cacheVersion;
+    header.hasNormals = hasNormals ? 1 : 0;
+    header.numPoints = cloud.points.size();
+    header.leafSize = leafSize;
+    header.kSearch = kSearch;
+    header.voxelEngine = leafSize == 0 ? VoxelEngine_InMemory : engine;
+    if (!sourceStat(sourcePath, header.sourceSize, header.sourceTime)) return false;
+
+    size_t n = cloud.points.size();
+    uint64_t offset = (sizeof(CloudCacheHeader) + columnAlignment - 1) / columnAlignment * columnAlignment;
+    uint64_t columnBytes = (n * sizeof(float) + columnAlignment - 1) / columnAlignment * columnAlignment;
+    for (int c = 0; c < Column_Count; ++c) {
+        header.columnOffsets[c] = offset;
+        offset += columnBytes;
+    }
+
+    // bounds of the finite points, reduced per thread
+    int numThreads = resolveThreads(threads);
+    vector<float> mins(3 * numThreads, FLT_MAX), maxs(3 * numThreads, -FLT_MAX);
+    parallelFor(n, numThreads, [&](size_t begin, size_t end, size_t t) {
+        float* mi = &mins[3 * t];
+        float* ma = &maxs[3 * t];
+        for (size_t i = begin; i < end; ++i) {
+            const pcl::PointXYZRGBNormal &p = cloud.points[i];
+            if (!std::isfinite(p.x) || !std::isfinite(p.y) || !std::isfinite(p.z)) continue;
+            mi[0] = min(mi[0], p.x); mi[1] = min(mi[1], p.y); mi[2] = min(mi[2], p.z);
+            ma[0] = max(ma[0], p.x); ma[1] = max(ma[1], p.y); ma[2] = max(ma[2], p.z);
+        }
+    });
+    for (int k = 0; k < 3; ++k) {
+        header.min[k] = FLT_MAX; header.max[k] = -FLT_MAX;
+        for (int t = 0; t < numThreads; ++t) {
+            header.min[k] = min(header.min[k], mins[3 * t + k]);
+            header.max[k] = max(header.max[k], maxs[3 * t + k]);
+        }
+    }
+
+    // write to a temporary name first, a reader must never see a half written cache
+    string tmpPath = path + ".tmp";
+    ofstream output(tmpPath, ios::binary | ios::trunc);
+    if (!output) return false;
+    vector<char> padding(columnAlignment, 0);
+    output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    output.write(padding.data(), header.columnOffsets[0] - sizeof(header));
+    vector<float> column(n);
+    for (int c = 0; c < Column_Count; ++c) {
+        parallelFor(n, numThreads, [&](size_t begin, size_t end, size_t) {
+            for (size_t i = begin; i < end; ++i) column[i] = columnValue(cloud.points[i], c);
+        });
+        output.write(reinterpret_cast<const char*>(column.data()), n * sizeof(float));
+        output.write(padding.data(), columnBytes - n * sizeof(float));
+    }
+    output.close();
+    if (!output) {
+        remove(tmpPath.c_str());
+        return false;
+    }
+    return rename(tmpPath.c_str(), path.c_str()) == 0;
+}
+
+bool KKRecons::CloudCache::open(const string &path) {
+    this->_header = nullptr;
+    if (!this->_file.open(path)) return false;
+    if (this->_file.size() < sizeof(CloudCacheHeader)) return false;
+    const CloudCacheHeader* header = reinterpret_cast<const CloudCacheHeader*>(this->_file.data());
+    if (memcmp(header->magic, cacheMagic, sizeof(cacheMagic)) != 0 || header->version != cacheVersion) return false;
+    for (int c = 0; c < Column_Count; ++c) {
+        if (header->columnOffsets[c] % sizeof(float) != 0 ||
+            header->columnOffsets[c] + header->numPoints * sizeof(float) > this->_file.size()) return false;
+    }
+    this->_header = header;
+    return true;
+}
+
+bool KKRecons::CloudCache::isFresh(const string &sourcePath, float leafSize, CacheVoxelEngine engine) const {
+    if (!this->_header) return false;
+    uint64_t size;
+    int64_t time;
+    if (!sourceStat(sourcePath, size, time)) return false;
+    if (leafSize == 0) engine = VoxelEngine_InMemory;
+    return this->_header->sourceSize == size && this->_header->sourceTime == time && this->_header->leafSize == leafSize &&
+           this->_header->voxelEngine == static_cast<uint32_t>(engine);
+}
+
+void KKRecons::CloudCache::toPointCloud(pcl::PointCloud<pcl::PointXYZRGBNormal> &cloud, int threads) const {
+    size_t n = this->size();
+    const float* x = column(Column_X);
+    const float* y = column(Column_Y);
+    const float* z = column(Column_Z);
+    const float* nx = column(Column_NormalX);
+    const float* ny = column(Column_NormalY);
+    const float* nz = column(Column_NormalZ);
+    const float* curvature = column(Column_Curvature);
+    const uint32_t* colors = rgba();
+    cloud.points.resize(n);
+    parallelFor(n, threads, [&](size_t begin, size_t end, size_t) {
+        for (size_t i = begin; i < end; ++i) {
+            pcl::PointXYZRGBNormal &p = cloud.points[i];
+            p.x = x[i]; p.y = y[i]; p.z = z[i];
+            p.rgba = colors[i];
+            p.normal_x = nx[i]; p.normal_y = ny[i]; p.normal_z = nz[i];
+            p.curvature = curvature[i];
+        }
+    });
+    cloud.width = static_cast<uint32_t>(n);
+    cloud.height = 1;
+    cloud.is_dense = true;
+}
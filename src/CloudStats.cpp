@@ -0,0 +1,92 @@
+#include <cmath>
+#include <cfloat>
+#include <CloudStats.h>
+#include <Parallel.h>
+
+using namespace std;
+
+namespace {
+    // the running min, max and sum of a block of points
+    struct Partial {
+        float minX, minY, minZ, maxX, maxY, maxZ;
+        double sumX, sumY, sumZ;
+        size_t count;
+
+        Partial() : minX(FLT_MAX), minY(FLT_MAX), minZ(FLT_MAX), maxX(-FLT_MAX), maxY(-FLT_MAX), maxZ(-FLT_MAX),
+                    sumX(0), sumY(0), sumZ(0), count(0) {}
+
+        template<typename PointType>
+        void fold(const PointType &p) {
+            if (!std::isfinite(p.x) || !std::isfinite(p.y) || !std::isfinite(p.z)) return;
+            minX = p.x < minX ? p.x : minX;
+            minY = p.y < minY ? p.y : minY;
+            minZ = p.z < minZ ? p.z : minZ;
+            maxX = p.x > maxX ? p.x : maxX;
+            maxY = p.y > maxY ? p.y : maxY;
+            maxZ = p.z > maxZ ? p.z : maxZ;
+            sumX += p.x;
+            sumY += p.y;
+            sumZ += p.z;
+            ++count;
+        }
+
+        KKRecons::CloudStats stats() const {
+            KKRecons::CloudStats stats;
+            if (count == 0) return stats;
+            stats.min = Eigen::Vector3f(minX, minY, minZ);
+            stats.max = Eigen::Vector3f(maxX, maxY, maxZ);
+            stats.centroid = Eigen::Vector3d(sumX, sumY, sumZ) / static_cast<double>(count);
+            stats.count = count;
+            return stats;
+        }
+    };
+
+    // fold(begin, end, partial) on every thread block, the partials are merged in block order
+    template<typename Fold>
+    KKRecons::CloudStats reduce(size_t n, int threads, Fold fold) {
+        size_t numThreads = n < KKRecons::minParallelItems ? 1 : static_cast<size_t>(KKRecons::resolveThreads(threads));
+        vector<Partial> partial(max<size_t>(1, min(numThreads, n)));
+        KKRecons::parallelFor(n, static_cast<int>(partial.size()), [&](size_t begin, size_t end, size_t t) {
+            fold(begin, end, partial[t]);
+        });
+        KKRecons::CloudStats stats = partial[0].stats();
+        for (size_t t = 1; t < partial.size(); ++t) stats.merge(partial[t].stats());
+        return stats;
+    }
+}
+
+KKRecons::CloudStats::CloudStats()
+        : min(FLT_MAX, FLT_MAX, FLT_MAX), max(-FLT_MAX, -FLT_MAX, -FLT_MAX), centroid(0, 0, 0), count(0) {}
+
+void KKRecons::CloudStats::merge(const CloudStats &other) {
+    if (other.count == 0) return;
+    if (count == 0) {
+        *this = other;
+        return;
+    }
+    min = min.cwiseMin(other.min);
+    max = max.cwiseMax(other.max);
+    double total = static_cast<double>(count + other.count);
+    centroid = centroid * (count / total) + other.centroid * (other.count / total);
+    count += other.count;
+}
+
+template<typename PointType>
+KKRecons::CloudStats KKRecons::computeCloudStats(const PointType *points, size_t count, int threads) {
+    return reduce(count, threads, [&](size_t begin, size_t end, Partial &partial) {
+        for (size_t i = begin; i < end; ++i) partial.fold(points[i]);
+    });
+}
+
+template<typename PointType>
+KKRecons::CloudStats KKRecons::computeCloudStats(const pcl::PointCloud<PointType> &cloud, const vector<int> &indices,
+                                                 int threads) {
+    return reduce(indices.size(), threads, [&](size_t begin, size_t end, Partial &partial) {
+        for (size_t i = begin; i < end; ++i) partial.fold(cloud.points[indices[i]]);
+    });
+}
+
+template KKRecons::CloudStats KKRecons::computeCloudStats<pcl::PointXYZRGBNormal>(const pcl::PointXYZRGBNormal *,
+                                                                                  size_t, int);
+template KKRecons::CloudStats KKRecons::computeCloudStats<pcl::PointXYZRGBNormal>(
+        const pcl::PointCloud<pcl::PointXYZRGBNormal> &, const vector<int> &, int);
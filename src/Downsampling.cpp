@@ -10,22 +10,29 @@
 #include <pcl/io/ply_io.h>
 #include <pcl/io/pcd_io.h>
 #include <fstream>
+#include <sstream>
+#include <future>
 #include <pcl/console/print.h>
 #include <regex>
+#include <PointLoader.h>
+#include <TiledVoxelFilter.h>
+#include <VoxelGridEngine.h>
 
 using namespace std;
 typedef pcl::PointXYZRGB PointT;
 typedef pcl::PointCloud<PointT> PointCloudT;
-std::vector<std::string> split(const std::string& s, char delimiter)
-{
-    std::vector<std::string> tokens;
-    std::string token;
-    std::istringstream tokenStream(s);
-    while (std::getline(tokenStream, token, delimiter))
-    {
-        tokens.push_back(token);
+// voxelize one snap, save it and append the result to the merged cloud
+void downsampleSnap(PointCloudT::Ptr snap, float leafSize, int index, const string outputName, PointCloudT::Ptr all) {
+    stringstream ss;
+    ss << "snap:" << index << "  before downsampling " << snap->size();
+    KKRecons::voxelGridFilter(*snap, leafSize, *snap);
+
+    ss << " after downsampling " << snap->size();
+    cout << ss.str() << endl;
+    if (snap->size()!=0) {
+        pcl::io::savePLYFile("Downsampled_"+outputName+'_'+to_string(index)+".ply",*snap);
     }
-    return tokens;
+    for(auto &p:snap->points) all->push_back(p);
 }
 
 int main(int argc, char** argv) {
@@ -39,61 +46,61 @@ int main(int argc, char** argv) {
 //    pcl::io::savePLYFile("all.ply",*all);
 //    return 0;
 
-    if(argc != 5){
-        cerr << "Input is not enough. Example: Downsampling [InputPath/*.txt] [leafSize] [interval] [outputName]" << endl;
+    if(argc != 5 && argc != 6){
+        cerr << "Input is not enough. Example: Downsampling [InputPath/*.txt] [leafSize] [interval] [outputName] ([tiledMemoryMB])" << endl;
         return 0;
     }
-    PointCloudT::Ptr tmpPointcloud(new PointCloudT);
     PointCloudT::Ptr allPointcloud(new PointCloudT);
     float leafSize = stod(argv[2]) ;
     unsigned int interval = atoi(argv[3]);
     string outputName(argv[4]);
+    int tiledMemoryMB = argc == 6 ? atoi(argv[5]) : 0;
+    if (interval == 0) {
+        cerr << "interval should be larger than 0" << endl;
+        return 0;
+    }
+    if (tiledMemoryMB < 0) {
+        cerr << "tiledMemoryMB should not be negative" << endl;
+        return 0;
+    }
     cout << "=====================================" << "\n";
     cout << "Leaf Size: " << leafSize << " | " << "Interval: " << interval << "\n";
     cout << "=====================================" << "\n";
-    int snaps = 0;
-    unsigned int total = snaps*interval;
-    while(1) {
-        tmpPointcloud->resize(0);
-        int times = 0;
-        std::ifstream file(argv[1]);
-        std::string str;
-        unsigned int tmp = 0;
-        while(++tmp <= total) std::getline(file, str);
-        while (std::getline(file, str))
-        {
-            vector<string> tokens;
-            tokens = split(str, ' ');
-            if(tokens.size() != 7) continue;
-            if(times++ == interval) break;
-            PointT p;
-            try {
-                p.x = stof(tokens[0]); p.y = stof(tokens[1]); p.z = stof(tokens[2]);
-                p.r = stof(tokens[4]); p.g = stof(tokens[5]); p.b = stof(tokens[6]);
-                p.a = stof(tokens[3])/2;
-                tmpPointcloud->push_back(p);
-            }catch(exception& e) {
-                for (auto t:tokens) cout << t << " ";
-                cout << "\n";
-            }
-        }
 
-        cout << "snap:" << snaps << "  before downsampling " << tmpPointcloud->size();
-        pcl::VoxelGrid<PointT> sor;
-        sor.setInputCloud(tmpPointcloud);
-
-        sor.setLeafSize(leafSize, leafSize, leafSize); //5mm
-        sor.filter(*tmpPointcloud);
+    // the input is read a snap of `interval` points at a time. A snap is voxelized and written by a worker while
+    // the next one is being read, so at most two raw snaps are in memory.
+    KKRecons::AsciiChunkReader reader;
+    if (!reader.open(argv[1], KKRecons::Ascii_SpaceXYZARGB)) {
+        cerr << "Cannot open the input file " << argv[1] << endl;
+        return 0;
+    }
 
-        cout << " after downsampling " << tmpPointcloud->size() << endl;
-        if (tmpPointcloud->size()!=0) {
-            pcl::io::savePLYFile("Downsampled_"+outputName+'_'+to_string(snaps)+".ply",*tmpPointcloud);
+    if (tiledMemoryMB > 0) {
+        // one voxel grid over the whole scan instead of one per snap, spilled to disk in tiles
+        KKRecons::TiledVoxelFilter<PointT> tiled(leafSize, static_cast<size_t>(tiledMemoryMB) << 20, "./");
+        PointCloudT chunk;
+        while (reader.next(chunk, interval)) {
+            for (auto &p : chunk.points) tiled.add(p);
         }
-        for(auto &p:tmpPointcloud->points) allPointcloud->push_back(p);
-        if (!std::getline(file, str)) break;
-        file.close();
+        PointCloudT().swap(chunk);
+        cout << "tiled: before downsampling " << tiled.size() << " in " << tiled.numTiles() << " tiles";
+        tiled.filter(*allPointcloud);
+        cout << " after downsampling " << allPointcloud->size() << endl;
+        if (reader.droppedLines() > 0) cout << reader.droppedLines() << " lines are not \"x y z a r g b\" and skipped" << endl;
+        pcl::io::savePLYFile("Downsampled_"+outputName+"_all"+".ply",*allPointcloud);
+        return 0;
+    }
+
+    std::future<void> pending;
+    int snaps = 0;
+    while (true) {
+        PointCloudT::Ptr tmpPointcloud(new PointCloudT);
+        if (!reader.next(*tmpPointcloud, interval)) break;
+        if (pending.valid()) pending.get();
+        pending = std::async(std::launch::async, downsampleSnap, tmpPointcloud, leafSize, snaps, outputName, allPointcloud);
         snaps++;
-        total += interval;
     }
+    if (pending.valid()) pending.get();
+    if (reader.droppedLines() > 0) cout << reader.droppedLines() << " lines are not \"x y z a r g b\" and skipped" << endl;
     pcl::io::savePLYFile("Downsampled_"+outputName+"_all"+".ply",*allPointcloud);
 };
\ No newline at end of file
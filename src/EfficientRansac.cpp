@@ -0,0 +1,410 @@
+#include <cmath>
+#include <random>
+#include <limits>
+#include <algorithm>
+#include <unordered_map>
+#include <Eigen/Eigenvalues>
+#include <EfficientRansac.h>
+#include <Parallel.h>
+
+using namespace std;
+
+namespace {
+    const int octreeDepth = 10;          // levels of the sampling octree, 1024 cells per axis at the bottom
+    const size_t candidatesPerRound = 64;
+    const size_t maxPoolSize = 512;      // candidates kept between rounds, the best ones
+    const size_t minSubsetSize = 1000;
+    const int numSubsets = 16;           // the scoring subset holds 1 / numSubsets of the unassigned points
+
+    struct Candidate {
+        Eigen::Vector4f plane;
+        int samples[3];
+        int level;
+        double estimate; // compatible unassigned points, extrapolated from the subset
+        bool isStale;
+    };
+
+    // 10 bit integer -> every third bit of a 30 bit morton code
+    uint32_t spreadBits(uint32_t v) {
+        v &= 0x3ff;
+        v = (v ^ (v << 16)) & 0xff0000ff;
+        v = (v ^ (v << 8)) & 0x0300f00f;
+        v = (v ^ (v << 4)) & 0x030c30c3;
+        v = (v ^ (v << 2)) & 0x09249249;
+        return v;
+    }
+
+    template<typename PointType>
+    class PlaneDetector {
+    public:
+        PlaneDetector(const pcl::PointCloud<PointType> &cloud, const KKRecons::EfficientRansacParameters &parameters,
+                      int threads, uint32_t seed)
+            : points(cloud.points), parameters(parameters), threads(KKRecons::resolveThreads(threads)), seed(seed) {}
+
+        // returns the number of candidates drawn
+        size_t run(vector<KKRecons::DetectedPlane> &planes) {
+            planes.clear();
+            isAssigned.assign(points.size(), 1);
+            for (size_t i = 0; i < points.size(); ++i) {
+                const PointType &p = points[i];
+                if (!pcl::isFinite(p) || !std::isfinite(p.normal_x) || !std::isfinite(p.normal_y) || !std::isfinite(p.normal_z)) continue;
+                isAssigned[i] = 0;
+                remaining.push_back(static_cast<int>(i));
+            }
+            if (remaining.size() < static_cast<size_t>(max(parameters.minSupport, 3))) return 0;
+            buildOctree();
+            drawSubset(0);
+            fill(levelScore, levelScore + octreeDepth, 0.0);
+            fill(levelCount, levelCount + octreeDepth, 0.0);
+
+            vector<Candidate> pool;
+            size_t drawn = 0;
+            const double missTarget = 1.0 - parameters.probability;
+            const size_t maxCandidates = static_cast<size_t>(max(parameters.maxCandidates, 0));
+            while (remaining.size() >= static_cast<size_t>(parameters.minSupport) && drawn < maxCandidates) {
+                // 1. a round of candidates, each from its own seed
+                vector<double> levelCdf = levelDistribution();
+                size_t round = min(candidatesPerRound, maxCandidates - drawn);
+                vector<Candidate> fresh(round);
+                vector<char> isDrawn(round, 0);
+                KKRecons::parallelFor(round, threads, [&](size_t begin, size_t end, size_t) {
+                    for (size_t i = begin; i < end; ++i) isDrawn[i] = drawCandidate(drawn + i, levelCdf, fresh[i]);
+                });
+                drawn += round;
+                size_t firstFresh = pool.size();
+                for (size_t i = 0; i < round; ++i) {
+                    if (isDrawn[i]) pool.push_back(fresh[i]);
+                }
+                rescore(pool);
+                for (size_t i = firstFresh; i < pool.size(); ++i) {
+                    levelScore[pool[i].level] += pool[i].estimate;
+                    levelCount[pool[i].level] += 1;
+                }
+                // 2. extract the best candidates while a larger plane is unlikely to have been missed
+                while (!pool.empty()) {
+                    size_t best;
+                    size_t support = bestCandidate(pool, best);
+                    if (support < static_cast<size_t>(parameters.minSupport) || missProbability(support, drawn) >= missTarget) break;
+                    KKRecons::DetectedPlane plane;
+                    bool isExtracted = extract(pool[best].plane, plane);
+                    pool.erase(pool.begin() + best);
+                    if (!isExtracted) continue;
+                    assign(plane.indices);
+                    planes.push_back(plane);
+                    // candidates built on taken points are gone, the others must be scored again
+                    pool.erase(remove_if(pool.begin(), pool.end(), [&](const Candidate &c) {
+                        return isAssigned[c.samples[0]] || isAssigned[c.samples[1]] || isAssigned[c.samples[2]];
+                    }), pool.end());
+                    for (auto &c : pool) c.isStale = true;
+                    rescore(pool);
+                    if (remaining.size() < static_cast<size_t>(parameters.minSupport)) break;
+                }
+                if (pool.size() > maxPoolSize) {
+                    stable_sort(pool.begin(), pool.end(), [](const Candidate &l, const Candidate &r) { return l.estimate > r.estimate; });
+                    pool.resize(maxPoolSize);
+                }
+                // 3. done once even the smallest plane would have been drawn
+                if (missProbability(parameters.minSupport, drawn) < missTarget) break;
+            }
+            return drawn;
+        }
+
+    private:
+        const typename pcl::PointCloud<PointType>::VectorType &points;
+        const KKRecons::EfficientRansacParameters &parameters;
+        const int threads;
+        const uint32_t seed;
+        vector<char> isAssigned;
+        vector<int> remaining;          // unassigned points, ascending
+        vector<uint32_t> sortedCodes;   // morton codes of the octree, ascending
+        vector<int> sortedPoints;       // the point of every sorted code
+        vector<uint32_t> codeOf;
+        vector<int> subset;             // scoring subset, unassigned points of it are counted
+        size_t subsetRemaining = 0;
+        double levelScore[octreeDepth], levelCount[octreeDepth];
+
+        // chance that a plane of support points was never drawn in numDrawn candidates, P(n) of the paper
+        double missProbability(double support, size_t numDrawn) const {
+            double p = support / (static_cast<double>(remaining.size()) * octreeDepth * 4.0);
+            if (p >= 1) return 0;
+            return pow(1.0 - p, static_cast<double>(numDrawn));
+        }
+
+        bool isCompatible(int i, const Eigen::Vector4f &plane) const {
+            const PointType &p = points[i];
+            float distance = fabsf(plane[0] * p.x + plane[1] * p.y + plane[2] * p.z + plane[3]);
+            if (!(distance < parameters.distanceThreshold)) return false;
+            return fabsf(plane[0] * p.normal_x + plane[1] * p.normal_y + plane[2] * p.normal_z) >= parameters.normalThreshold;
+        }
+
+        void buildOctree() {
+            Eigen::Vector3f minP = Eigen::Vector3f::Constant(numeric_limits<float>::max());
+            Eigen::Vector3f maxP = -minP;
+            for (int i : remaining) {
+                minP = minP.cwiseMin(points[i].getVector3fMap());
+                maxP = maxP.cwiseMax(points[i].getVector3fMap());
+            }
+            float side = max((maxP - minP).maxCoeff(), numeric_limits<float>::min());
+            float scale = (1 << octreeDepth) / side;
+            codeOf.assign(points.size(), 0);
+            vector<pair<uint32_t, int> > codes;
+            codes.reserve(remaining.size());
+            for (int i : remaining) {
+                Eigen::Vector3f cell = (points[i].getVector3fMap() - minP) * scale;
+                uint32_t ijk[3];
+                for (int a = 0; a < 3; ++a) ijk[a] = min(static_cast<uint32_t>(cell[a]), (1u << octreeDepth) - 1);
+                codeOf[i] = spreadBits(ijk[0]) | (spreadBits(ijk[1]) << 1) | (spreadBits(ijk[2]) << 2);
+                codes.push_back(make_pair(codeOf[i], i));
+            }
+            sort(codes.begin(), codes.end());
+            sortedCodes.resize(codes.size());
+            sortedPoints.resize(codes.size());
+            for (size_t i = 0; i < codes.size(); ++i) {
+                sortedCodes[i] = codes[i].first;
+                sortedPoints[i] = codes[i].second;
+            }
+        }
+
+        void drawSubset(size_t generation) {
+            subset = remaining;
+            mt19937 rng(seed + static_cast<uint32_t>(generation));
+            shuffle(subset.begin(), subset.end(), rng);
+            subset.resize(min(subset.size(), max(minSubsetSize, remaining.size() / numSubsets)));
+            subsetRemaining = subset.size();
+        }
+
+        // levels are drawn by their mean candidate score so far, every level keeps a small share
+        vector<double> levelDistribution() const {
+            double mean[octreeDepth], best = 0, sum = 0;
+            for (int l = 0; l < octreeDepth; ++l) {
+                mean[l] = levelCount[l] > 0 ? levelScore[l] / levelCount[l] : -1;
+                best = max(best, mean[l]);
+            }
+            for (int l = 0; l < octreeDepth; ++l) {
+                if (mean[l] < 0) mean[l] = best; // untried levels look as good as the best one
+                sum += mean[l];
+            }
+            vector<double> cdf(octreeDepth);
+            double total = 0;
+            for (int l = 0; l < octreeDepth; ++l) {
+                total += sum > 0 ? 0.9 * mean[l] / sum + 0.1 / octreeDepth : 1.0 / octreeDepth;
+                cdf[l] = total;
+            }
+            return cdf;
+        }
+
+        bool drawCandidate(size_t id, const vector<double> &levelCdf, Candidate &candidate) const {
+            seed_seq seeds = {seed, static_cast<uint32_t>(id), static_cast<uint32_t>(static_cast<uint64_t>(id) >> 32)};
+            mt19937 rng(seeds);
+            int first = remaining[rng() % remaining.size()];
+            double u = uniform_real_distribution<double>(0, levelCdf.back())(rng);
+            int level = static_cast<int>(upper_bound(levelCdf.begin(), levelCdf.end(), u) - levelCdf.begin());
+            level = min(level, octreeDepth - 1);
+            // the points sharing the cell of the first one at this level
+            int shift = 3 * (octreeDepth - level);
+            uint32_t key = shift >= 32 ? 0 : codeOf[first] >> shift;
+            size_t lo = lower_bound(sortedCodes.begin(), sortedCodes.end(), shift >= 32 ? 0 : key << shift) - sortedCodes.begin();
+            size_t hi = shift >= 30 ? sortedCodes.size()
+                                    : lower_bound(sortedCodes.begin(), sortedCodes.end(), (key + 1) << shift) - sortedCodes.begin();
+            if (hi - lo < 3) return false;
+            int samples[3] = {first, -1, -1};
+            for (int s = 1; s < 3; ++s) {
+                for (int attempt = 0; attempt < 20 && samples[s] == -1; ++attempt) {
+                    int j = sortedPoints[lo + rng() % (hi - lo)];
+                    if (!isAssigned[j] && j != samples[0] && j != samples[1]) samples[s] = j;
+                }
+                if (samples[s] == -1) return false;
+            }
+            Eigen::Vector3f p0 = points[samples[0]].getVector3fMap();
+            Eigen::Vector3f normal = (points[samples[1]].getVector3fMap() - p0).cross(points[samples[2]].getVector3fMap() - p0);
+            float norm = normal.norm();
+            if (!(norm > 0) || !std::isfinite(norm)) return false;
+            normal /= norm;
+            candidate.plane = Eigen::Vector4f(normal[0], normal[1], normal[2], -normal.dot(p0));
+            // the samples have to agree with the plane themselves
+            for (int s = 0; s < 3; ++s) {
+                const PointType &p = points[samples[s]];
+                if (!(fabsf(normal[0] * p.normal_x + normal[1] * p.normal_y + normal[2] * p.normal_z) >= parameters.normalThreshold)) return false;
+                candidate.samples[s] = samples[s];
+            }
+            candidate.level = level;
+            candidate.estimate = 0;
+            candidate.isStale = true;
+            return true;
+        }
+
+        void rescore(vector<Candidate> &pool) {
+            if (subsetRemaining * 2 < min(minSubsetSize, remaining.size())) drawSubset(remaining.size());
+            double scale = subsetRemaining > 0 ? static_cast<double>(remaining.size()) / subsetRemaining : 0;
+            KKRecons::parallelFor(pool.size(), threads, [&](size_t begin, size_t end, size_t) {
+                for (size_t c = begin; c < end; ++c) {
+                    if (!pool[c].isStale) continue;
+                    size_t count = 0;
+                    for (int i : subset) count += !isAssigned[i] && isCompatible(i, pool[c].plane);
+                    pool[c].estimate = count * scale;
+                    pool[c].isStale = false;
+                }
+            });
+        }
+
+        size_t exactCount(const Eigen::Vector4f &plane) const {
+            vector<size_t> counts(threads, 0);
+            KKRecons::parallelFor(remaining.size(), threads, [&](size_t begin, size_t end, size_t t) {
+                size_t count = 0;
+                for (size_t r = begin; r < end; ++r) count += isCompatible(remaining[r], plane);
+                counts[t] = count;
+            });
+            size_t count = 0;
+            for (size_t c : counts) count += c;
+            return count;
+        }
+
+        // the estimates only rank the pool, the top few are counted exactly
+        size_t bestCandidate(const vector<Candidate> &pool, size_t &best) const {
+            vector<size_t> order(pool.size());
+            for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+            size_t numTop = min<size_t>(3, order.size());
+            partial_sort(order.begin(), order.begin() + numTop, order.end(), [&](size_t l, size_t r) {
+                return pool[l].estimate != pool[r].estimate ? pool[l].estimate > pool[r].estimate : l < r;
+            });
+            size_t bestSupport = 0;
+            best = order[0];
+            for (size_t i = 0; i < numTop; ++i) {
+                size_t support = exactCount(pool[order[i]].plane);
+                if (support > bestSupport) {
+                    bestSupport = support;
+                    best = order[i];
+                }
+            }
+            return bestSupport;
+        }
+
+        void compatiblePoints(const Eigen::Vector4f &plane, vector<int> &result) const {
+            vector<vector<int> > blocks(threads);
+            KKRecons::parallelFor(remaining.size(), threads, [&](size_t begin, size_t end, size_t t) {
+                for (size_t r = begin; r < end; ++r) {
+                    if (isCompatible(remaining[r], plane)) blocks[t].push_back(remaining[r]);
+                }
+            });
+            result.clear();
+            for (auto &block : blocks) result.insert(result.end(), block.begin(), block.end());
+        }
+
+        // the largest 8-connected component of the points in a bitmap on the plane
+        void largestComponent(const Eigen::Vector4f &plane, const vector<int> &candidates, vector<int> &component) const {
+            component.clear();
+            if (candidates.empty()) return;
+            Eigen::Vector3f normal = plane.head<3>();
+            Eigen::Vector3f u = normal.unitOrthogonal(), v = normal.cross(u);
+            float inverseCell = 1.0f / parameters.clusterEpsilon;
+            vector<pair<uint64_t, int> > cells(candidates.size());
+            for (size_t i = 0; i < candidates.size(); ++i) {
+                Eigen::Vector3f p = points[candidates[i]].getVector3fMap();
+                int32_t cu = static_cast<int32_t>(floor(p.dot(u) * inverseCell));
+                int32_t cv = static_cast<int32_t>(floor(p.dot(v) * inverseCell));
+                cells[i] = make_pair(static_cast<uint64_t>(static_cast<uint32_t>(cu)) << 32 | static_cast<uint32_t>(cv), candidates[i]);
+            }
+            sort(cells.begin(), cells.end());
+            // runs of equal keys are the occupied cells
+            vector<size_t> runStart;
+            unordered_map<uint64_t, int> runOf;
+            for (size_t i = 0; i < cells.size(); ++i) {
+                if (i > 0 && cells[i].first == cells[i - 1].first) continue;
+                runOf[cells[i].first] = static_cast<int>(runStart.size());
+                runStart.push_back(i);
+            }
+            runStart.push_back(cells.size());
+            size_t numRuns = runStart.size() - 1;
+            vector<int> label(numRuns, -1);
+            vector<size_t> componentSize;
+            vector<int> queue;
+            for (size_t start = 0; start < numRuns; ++start) {
+                if (label[start] != -1) continue;
+                int id = static_cast<int>(componentSize.size());
+                size_t size = 0;
+                label[start] = id;
+                queue.assign(1, static_cast<int>(start));
+                for (size_t q = 0; q < queue.size(); ++q) {
+                    int run = queue[q];
+                    size += runStart[run + 1] - runStart[run];
+                    uint64_t key = cells[runStart[run]].first;
+                    int32_t cu = static_cast<int32_t>(key >> 32), cv = static_cast<int32_t>(key & 0xffffffff);
+                    for (int du = -1; du <= 1; ++du) {
+                        for (int dv = -1; dv <= 1; ++dv) {
+                            if (du == 0 && dv == 0) continue;
+                            uint64_t neighbourKey = static_cast<uint64_t>(static_cast<uint32_t>(cu + du)) << 32 | static_cast<uint32_t>(cv + dv);
+                            auto it = runOf.find(neighbourKey);
+                            if (it == runOf.end() || label[it->second] != -1) continue;
+                            label[it->second] = id;
+                            queue.push_back(it->second);
+                        }
+                    }
+                }
+                componentSize.push_back(size);
+            }
+            int largest = static_cast<int>(max_element(componentSize.begin(), componentSize.end()) - componentSize.begin());
+            for (size_t run = 0; run < numRuns; ++run) {
+                if (label[run] != largest) continue;
+                for (size_t i = runStart[run]; i < runStart[run + 1]; ++i) component.push_back(cells[i].second);
+            }
+            sort(component.begin(), component.end());
+        }
+
+        // least squares plane, facing the way the candidate did
+        bool refit(const vector<int> &indices, Eigen::Vector4f &plane) const {
+            if (indices.size() < 3) return false;
+            Eigen::Vector3d sum = Eigen::Vector3d::Zero();
+            for (int i : indices) sum += points[i].getVector3fMap().template cast<double>();
+            Eigen::Vector3d centroid = sum / static_cast<double>(indices.size());
+            Eigen::Matrix3d covariance = Eigen::Matrix3d::Zero();
+            for (int i : indices) {
+                Eigen::Vector3d p = points[i].getVector3fMap().template cast<double>() - centroid;
+                covariance += p * p.transpose();
+            }
+            Eigen::SelfAdjointEigenSolver<Eigen::Matrix3d> solver(covariance);
+            Eigen::Vector3d normal = solver.eigenvectors().col(0);
+            if (!normal.allFinite()) return false;
+            if (normal.dot(plane.head<3>().cast<double>()) < 0) normal = -normal;
+            plane = Eigen::Vector4f(static_cast<float>(normal[0]), static_cast<float>(normal[1]), static_cast<float>(normal[2]),
+                                    static_cast<float>(-normal.dot(centroid)));
+            return true;
+        }
+
+        bool extract(const Eigen::Vector4f &candidatePlane, KKRecons::DetectedPlane &plane) const {
+            vector<int> compatible;
+            plane.coefficients = candidatePlane;
+            compatiblePoints(plane.coefficients, compatible);
+            largestComponent(plane.coefficients, compatible, plane.indices);
+            // one refinement, kept only if it does not lose points
+            Eigen::Vector4f refined = plane.coefficients;
+            if (refit(plane.indices, refined)) {
+                vector<int> refinedIndices;
+                compatiblePoints(refined, compatible);
+                largestComponent(refined, compatible, refinedIndices);
+                if (refinedIndices.size() >= plane.indices.size()) {
+                    plane.coefficients = refined;
+                    plane.indices.swap(refinedIndices);
+                }
+            }
+            return plane.indices.size() >= static_cast<size_t>(parameters.minSupport);
+        }
+
+        void assign(const vector<int> &indices) {
+            for (int i : indices) isAssigned[i] = 1;
+            remaining.erase(remove_if(remaining.begin(), remaining.end(), [&](int i) { return isAssigned[i] != 0; }), remaining.end());
+            subsetRemaining = 0;
+            for (int i : subset) subsetRemaining += !isAssigned[i];
+        }
+    };
+}
+
+template<typename PointType>
+void KKRecons::detectPlanes(const pcl::PointCloud<PointType> &cloud, const EfficientRansacParameters &parameters,
+                            vector<DetectedPlane> &planes, int threads, uint32_t seed, size_t *candidatesDrawn) {
+    PlaneDetector<PointType> detector(cloud, parameters, threads, seed);
+    size_t drawn = detector.run(planes);
+    if (candidatesDrawn) *candidatesDrawn = drawn;
+}
+
+template void KKRecons::detectPlanes<pcl::PointXYZRGBNormal>(const pcl::PointCloud<pcl::PointXYZRGBNormal>&,
+        const EfficientRansacParameters&, vector<DetectedPlane>&, int, uint32_t, size_t*);
@@ -0,0 +1,48 @@
+#include <cstring>
+#include <stdexcept>
+#include <pcl/search/kdtree.h>
+#include <KnnGraph.h>
+#include <Parallel.h>
+
+using namespace std;
+
+template<typename PointType>
+void KKRecons::KnnGraph<PointType>::build(const typename pcl::PointCloud<PointType>::ConstPtr &cloud, int k, int threads) {
+    if (k <= 0) throw invalid_argument("KnnGraph: k must be positive");
+    size_t n = cloud->size();
+    numNeighbours = k;
+    offsets.assign(n + 1, 0);
+    indices.resize(n * k);
+    if (n == 0) return;
+    pcl::search::KdTree<PointType> tree;
+    tree.setInputCloud(cloud);
+    // every point first fills its own k slots, offsets[i + 1] holds how many were found
+    parallelFor(n, threads, [&](size_t begin, size_t end, size_t) {
+        vector<int> nnIndices(k);
+        vector<float> nnDists(k);
+        for (size_t i = begin; i < end; ++i) {
+            int found = 0;
+            if (pcl::isFinite(cloud->points[i])) found = tree.nearestKSearch(cloud->points[i], k, nnIndices, nnDists);
+            copy(nnIndices.begin(), nnIndices.begin() + found, indices.begin() + i * k);
+            offsets[i + 1] = static_cast<size_t>(found);
+        }
+    });
+    for (size_t i = 0; i < n; ++i) offsets[i + 1] += offsets[i];
+    if (offsets[n] == n * k) return;
+    // close the gaps of points with fewer than k neighbours, offsets[i] <= i * k so moving forward is safe
+    for (size_t i = 0; i < n; ++i) {
+        memmove(indices.data() + offsets[i], indices.data() + i * k, count(i) * sizeof(int));
+    }
+    indices.resize(offsets[n]);
+    indices.shrink_to_fit();
+}
+
+template<typename PointType>
+void KKRecons::KnnGraph<PointType>::clear() {
+    numNeighbours = 0;
+    vector<size_t>().swap(offsets);
+    vector<int>().swap(indices);
+}
+
+template class KKRecons::KnnGraph<pcl::PointXYZRGB>;
+template class KKRecons::KnnGraph<pcl::PointXYZRGBNormal>;
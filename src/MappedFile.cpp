@@ -0,0 +1,67 @@
+#include <fstream>
+#include <algorithm>
+#include <MappedFile.h>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+bool KKRecons::MappedFile::open(const string &path) {
+    close();
+#ifndef _WIN32
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        ::close(fd);
+        return false;
+    }
+    if (st.st_size == 0) {
+        ::close(fd);
+        this->_isEmptyFile = true;
+        return true;
+    }
+    void* addr = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (addr != MAP_FAILED) {
+        madvise(addr, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+        this->_data = static_cast<const char*>(addr);
+        this->_size = static_cast<size_t>(st.st_size);
+        this->_isMapped = true;
+        return true;
+    }
+#endif
+    ifstream file(path, ios::binary | ios::ate);
+    if (!file) return false;
+    this->_buffer.resize(static_cast<size_t>(file.tellg()));
+    file.seekg(0);
+    file.read(this->_buffer.data(), this->_buffer.size());
+    this->_size = this->_buffer.size();
+    this->_isEmptyFile = this->_size == 0;
+    this->_data = this->_size == 0 ? nullptr : this->_buffer.data();
+    return true;
+}
+
+void KKRecons::MappedFile::close() {
+#ifndef _WIN32
+    if (this->_isMapped) munmap(const_cast<char*>(this->_data), this->_size);
+#endif
+    this->_data = nullptr;
+    this->_size = 0;
+    this->_isMapped = false;
+    this->_isEmptyFile = false;
+    vector<char>().swap(this->_buffer);
+}
+
+void KKRecons::MappedFile::release(size_t offset) {
+#ifndef _WIN32
+    if (!this->_isMapped) return;
+    size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    size_t length = min(offset, this->_size) / page * page;
+    if (length > 0) madvise(const_cast<char*>(this->_data), length, MADV_DONTNEED);
+#endif
+}
@@ -0,0 +1,36 @@
+#include <limits>
+#include <algorithm>
+#include <pcl/features/normal_3d.h>
+#include <NormalEstimation.h>
+#include <Parallel.h>
+
+using namespace std;
+
+template<typename PointType>
+void KKRecons::estimateNormals(pcl::PointCloud<PointType> &cloud, const KnnGraph<PointType> &graph, int k,
+                               int threads) {
+    const float nan = numeric_limits<float>::quiet_NaN();
+    const Eigen::Vector4f viewpoint = cloud.sensor_origin_;
+    const size_t numNeighbours = static_cast<size_t>(max(0, k));
+    parallelFor(cloud.size(), threads, [&](size_t begin, size_t end, size_t) {
+        vector<int> nnIndices;
+        Eigen::Vector4f planeParameters;
+        for (size_t i = begin; i < end; ++i) {
+            PointType &p = cloud.points[i];
+            float curvature;
+            nnIndices.assign(graph.begin(i), graph.begin(i) + min(graph.count(i), numNeighbours));
+            if (nnIndices.empty() || !pcl::computePointNormal(cloud, nnIndices, planeParameters, curvature)) {
+                p.normal_x = p.normal_y = p.normal_z = p.curvature = nan;
+                continue;
+            }
+            p.normal_x = planeParameters[0];
+            p.normal_y = planeParameters[1];
+            p.normal_z = planeParameters[2];
+            p.curvature = curvature;
+            pcl::flipNormalTowardsViewpoint(p, viewpoint[0], viewpoint[1], viewpoint[2], p.normal_x, p.normal_y, p.normal_z);
+        }
+    });
+}
+
+template void KKRecons::estimateNormals<pcl::PointXYZRGBNormal>(pcl::PointCloud<pcl::PointXYZRGBNormal>&,
+        const KnnGraph<pcl::PointXYZRGBNormal>&, int, int);
@@ -0,0 +1,125 @@
+#include <chrono>
+#include <ctime>
+#include <cstdio>
+#include <fstream>
+#include <PerfReport.h>
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#define KK_PERF_RUSAGE
+#endif
+
+using namespace std;
+
+namespace {
+    // s as a JSON string
+    void writeString(ostream &out, const string &s) {
+        out << '"';
+        for (char c : s) {
+            if (c == '"' || c == '\\') out << '\\' << c;
+            else if (static_cast<unsigned char>(c) < 0x20) {
+                char escaped[8];
+                snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned>(c));
+                out << escaped;
+            }
+            else out << c;
+        }
+        out << '"';
+    }
+}
+
+KKRecons::ResourceSample KKRecons::ResourceSample::now() {
+    ResourceSample sample;
+    sample.wallSeconds = chrono::duration<double>(chrono::steady_clock::now().time_since_epoch()).count();
+#ifdef KK_PERF_RUSAGE
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    sample.cpuSeconds = usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+                        (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1e-6;
+#ifdef __APPLE__
+    sample.peakRssKB = usage.ru_maxrss / 1024; // bytes there
+#else
+    sample.peakRssKB = usage.ru_maxrss;
+#endif
+#else
+    sample.cpuSeconds = static_cast<double>(clock()) / CLOCKS_PER_SEC;
+    sample.peakRssKB = 0;
+#endif
+    return sample;
+}
+
+void KKRecons::PerfReport::clear() {
+    records.clear();
+    start = ResourceSample::now();
+}
+
+void KKRecons::PerfReport::writeJson(ostream &out) const {
+    ResourceSample end = ResourceSample::now();
+    const streamsize precision = out.precision(9);
+    out << "{\n  \"wallSeconds\": " << end.wallSeconds - start.wallSeconds
+        << ",\n  \"cpuSeconds\": " << end.cpuSeconds - start.cpuSeconds
+        << ",\n  \"peakRssKB\": " << end.peakRssKB << ",\n  \"inputPoints\": " << numInputPoints
+        << ",\n  \"stages\": [";
+    for (size_t s = 0; s < records.size(); ++s) {
+        const StageRecord &r = records[s];
+        out << (s == 0 ? "\n" : ",\n") << "    {\"name\": ";
+        writeString(out, r.name);
+        out << ", \"wallSeconds\": " << r.wallSeconds << ", \"cpuSeconds\": " << r.cpuSeconds
+            << ", \"peakRssDeltaKB\": " << r.peakRssDeltaKB << ", \"itemsIn\": " << r.itemsIn
+            << ", \"itemsOut\": " << r.itemsOut << ", \"counters\": {";
+        for (size_t c = 0; c < r.counters.size(); ++c) {
+            if (c > 0) out << ", ";
+            writeString(out, r.counters[c].first);
+            out << ": " << r.counters[c].second;
+        }
+        out << "}}";
+    }
+    out << (records.empty() ? "]\n}\n" : "\n  ]\n}\n");
+    out.precision(precision);
+}
+
+bool KKRecons::PerfReport::writeJson(const string &path) const {
+    ofstream out(path.c_str());
+    if (!out) return false;
+    writeJson(out);
+    return static_cast<bool>(out);
+}
+
+KKRecons::PerfStage::PerfStage(PerfReport *report, const string &name, size_t itemsIn)
+        : report(report), index(0), start(), isFinished(report == nullptr) {
+    if (!report) return;
+    index = report->records.size();
+    report->records.push_back(StageRecord());
+    report->records.back().name = name;
+    report->records.back().itemsIn = itemsIn;
+    start = ResourceSample::now();
+}
+
+void KKRecons::PerfStage::setItemsIn(size_t items) {
+    if (report) report->records[index].itemsIn = items;
+}
+
+void KKRecons::PerfStage::setItemsOut(size_t items) {
+    if (report) report->records[index].itemsOut = items;
+}
+
+void KKRecons::PerfStage::addCounter(const string &name, uint64_t value) {
+    if (!report) return;
+    vector<pair<string, uint64_t> > &counters = report->records[index].counters;
+    for (auto &counter : counters) {
+        if (counter.first == name) {
+            counter.second += value;
+            return;
+        }
+    }
+    counters.push_back(make_pair(name, value));
+}
+
+void KKRecons::PerfStage::finish() {
+    if (isFinished) return;
+    isFinished = true;
+    ResourceSample end = ResourceSample::now();
+    StageRecord &record = report->records[index];
+    record.wallSeconds = end.wallSeconds - start.wallSeconds;
+    record.cpuSeconds = end.cpuSeconds - start.cpuSeconds;
+    record.peakRssDeltaKB = end.peakRssKB - start.peakRssKB;
+}
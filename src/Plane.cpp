@@ -1,4 +1,8 @@
 #include "Plane.h"
+#include "PlaneRansac.h"
+#include "Parallel.h"
+#include "QuadRaster.h"
+#include <cfloat>
 #include <iostream>
 #include <vector>
 using namespace std;
@@ -53,6 +57,70 @@ int colorType2int(PlaneColor colorType) {
 	return color;
 }
 
+PlaneQuad linesQuad(PointT a1, PointT a2, PointT b1, PointT b2, float pointPitch, int32_t color) {
+	PlaneQuad quad = PlaneQuad();
+	quad.shape = PlaneQuad::Lines;
+	quad.color = color;
+	quad.pointPitch = pointPitch;
+	quad.a1 = a1; quad.a2 = a2;
+	quad.b1 = b1; quad.b2 = b2;
+	return quad;
+}
+
+/** @brief the rotation around z filledPlane builds as a Matrix4f, applied in float the way transformPointCloud
+ *         applies it. z is kept as it is
+ */
+struct ZRotation {
+	float c00, c01, c10, c11;
+	explicit ZRotation(double angle) {
+		c00 = cos(angle); c01 = -sin(angle);
+		c10 = sin(angle); c11 = cos(angle);
+	}
+	float x(float px, float py) const { return c00 * px + c01 * py; }
+	float y(float px, float py) const { return c10 * px + c11 * py; }
+};
+
+/** @brief rows (along y) and columns (along z) of the loops filledPlane filled the grid with, 0 for a reversed range
+ */
+void gridSize(const PlaneQuad& quad, int pointPitch, size_t& rows, size_t& columns) {
+	float lastRow = pointPitch * (quad.maxY - quad.minY);
+	float lastColumn = pointPitch * (quad.maxZ - quad.minZ);
+	rows = lastRow >= 0 ? (size_t)floor(lastRow) + 1 : 0;
+	columns = lastColumn >= 0 ? (size_t)floor(lastColumn) + 1 : 0;
+}
+
+float gridY(const PlaneQuad& quad, int pointPitch, size_t i) {
+	return quad.minY + ((double)i / pointPitch);
+}
+
+float gridZ(const PlaneQuad& quad, int pointPitch, size_t j) {
+	return quad.minZ + ((double)j / pointPitch);
+}
+
+void foldMinMax(float x, float y, float z, PointT& min, PointT& max) {
+	min.x = x < min.x ? x : min.x;
+	min.y = y < min.y ? y : min.y;
+	min.z = z < min.z ? z : min.z;
+	max.x = x > max.x ? x : max.x;
+	max.y = y > max.y ? y : max.y;
+	max.z = z > max.z ? z : max.z;
+}
+
+/** @brief expand min and max by the box boxMin-boxMax, an empty box with max < min leaves them as they are
+ */
+void foldBox(const PointT& boxMin, const PointT& boxMax, PointT& min, PointT& max) {
+	min.x = boxMin.x < min.x ? boxMin.x : min.x;
+	min.y = boxMin.y < min.y ? boxMin.y : min.y;
+	min.z = boxMin.z < min.z ? boxMin.z : min.z;
+	max.x = boxMax.x > max.x ? boxMax.x : max.x;
+	max.y = boxMax.y > max.y ? boxMax.y : max.y;
+	max.z = boxMax.z > max.z ? boxMax.z : max.z;
+}
+
+void foldRotated(const PointT& p, const ZRotation& rotation, PointT& min, PointT& max) {
+	if (!std::isfinite(p.x) || !std::isfinite(p.y) || !std::isfinite(p.z)) return;
+	foldMinMax(rotation.x(p.x, p.y), rotation.y(p.x, p.y), p.z, min, max);
+}
 
 //void importTXT(const string path, PointCloudT::Ptr cloud) {
 //	ifstream fin(path);
@@ -94,14 +162,14 @@ int colorType2int(PlaneColor colorType) {
 Plane::Plane()
 {
 	PointCloudT::Ptr tmp(new PointCloudT);
-	this->pointCloud = tmp;
+	this->_pointCloud = tmp;
 }
 
 Plane::Plane(PointCloudT::Ptr rawPointCloud)
 {
 	PointCloudT::Ptr tmp(new PointCloudT);
-	this->pointCloud = tmp;
-	pcl::copyPointCloud(*rawPointCloud, *this->pointCloud);
+	this->_pointCloud = tmp;
+	pcl::copyPointCloud(*rawPointCloud, *this->_pointCloud);
 }
 
 /** @brief initialize plane based on raw point and plane vector
@@ -109,75 +177,89 @@ Plane::Plane(PointCloudT::Ptr rawPointCloud)
 Plane::Plane(PointCloudT::Ptr rawPointCloud, Eigen::Vector4d abcd)
 {
 	PointCloudT::Ptr tmp(new PointCloudT);
-	this->pointCloud = tmp;
-	pcl::copyPointCloud(*rawPointCloud, *this->pointCloud);
+	this->_pointCloud = tmp;
+	pcl::copyPointCloud(*rawPointCloud, *this->_pointCloud);
+	this->_abcd = abcd;
+}
+
+Plane::Plane(PointCloudT::ConstPtr source, vector<int> indices, Eigen::Vector4d abcd)
+{
+	PointCloudT::Ptr tmp(new PointCloudT);
+	this->_pointCloud = tmp;
+	this->_source = source;
+	this->_indices.swap(indices);
 	this->_abcd = abcd;
 }
 /** @brief initialize plane based on 4 pts a1-a2 => b1-b2
  */
 Plane::Plane(PointT a1, PointT a2, PointT b1, PointT b2, float pointPitch, PlaneColor color) {
 	PointCloudT::Ptr tmp(new PointCloudT);
-	this->pointCloud = tmp;
-	generatePlanePointCloud(a1, a2, b1, b2, pointPitch, colorType2int(color));
+	this->_pointCloud = tmp;
+	this->_quads.push_back(linesQuad(a1, a2, b1, b2, pointPitch, colorType2int(color)));
 	updateBoundary();
 }
 
+PointCloudT::ConstPtr Plane::pointCloud() {
+	if (!this->_quads.empty()) {
+		// a new cloud, copies of the plane keep their quads and must not see the points
+		PointCloudT::Ptr cloud(new PointCloudT);
+		appendPointsTo(*cloud);
+		cloud->is_dense = isView() ? this->_source->is_dense : this->_pointCloud->is_dense;
+		if (this->_isPointStatsKnown) {
+			this->_pointStats.merge(KKRecons::computeCloudStats(cloud->points.data() + size(), cloud->size() - size()));
+		}
+		this->_pointCloud = cloud;
+		this->_source.reset();
+		vector<int>().swap(this->_indices);
+		this->_quads.clear();
+		this->_holes.clear();
+		this->_isQuadsBoundsKnown = false;
+	}
+	copyView();
+	return this->_pointCloud;
+}
+
+void Plane::appendPointsTo(PointCloudT& cloud, float pointPitch) const {
+	cloud.points.reserve(cloud.points.size() + size());
+	for (size_t i = 0; i < size(); ++i) {
+		cloud.points.push_back(point(i));
+	}
+	for (size_t q = 0; q < this->_quads.size(); ++q) {
+		rasterizeQuad(q, pointPitch, cloud);
+	}
+	cloud.width = cloud.points.size();
+	cloud.height = 1;
+}
+
 void Plane::setType(PlaneType type) {
 	this->_type = type;
 }
 
 void Plane::setColor(PlaneColor colorType)
 {
-	int32_t color = colorType2int(colorType);
-	PointCloudT* p = pointCloud.get();
-	for (size_t i = 0; i < pointCloud.get()->size(); i++) {
-		p->at(i).rgba = color;
-	}
+	setColor(colorType2int(colorType));
 }
 
 void Plane::setColor(int32_t color)
 {
-	PointCloudT* p = pointCloud.get();
-	for (size_t i = 0; i < pointCloud.get()->size(); i++) {
+	if (size() > 0) copyView();
+	PointCloudT* p = this->_pointCloud.get();
+	for (size_t i = 0; i < p->size(); i++) {
 		p->at(i).rgba = color;
 	}
+	for (size_t q = 0; q < this->_quads.size(); ++q) {
+		this->_quads[q].color = color;
+	}
 }
 
 void Plane::filledPlane(int pointPitch) {
 	Eigen::Vector4d planePara = this->_abcd;
 	double angle = acos(abs(planePara[0]) / sqrt(planePara[0] * planePara[0] + planePara[1] * planePara[1] + planePara[2] * planePara[2])); //注意！！この方程式は、2平面のなす角度は、0〜90度
 	if (planePara[0] / planePara[1] > 0) angle = (-1) * angle;
-	Eigen::Matrix4f rotation = Eigen::Matrix4f::Identity();
-	rotation(0, 0) = cos(angle); rotation(0, 1) = -sin(angle);
-	rotation(1, 0) = sin(angle); rotation(1, 1) = cos(angle);
-	pcl::transformPointCloud(*this->pointCloud, *this->pointCloud, rotation);
 	PointT proj_min;
 	PointT proj_max;
-	pcl::getMinMax3D(*this->pointCloud, proj_min, proj_max);
-	PointCloudT::Ptr cloud_filled_temp(new PointCloudT);
-	int32_t color = colorType2int(Color_White);
-	for (int i = 0; i <= pointPitch * (proj_max.y - proj_min.y); i++) {
-		for (int j = 0; j <= pointPitch * (proj_max.z - proj_min.z); j++) {
-			PointT pointForFill;
-			if (planePara[0] / planePara[1] > 0 && planePara[0] < 0)
-				pointForFill.x += planePara[3]; //
-			else if (planePara[0] / planePara[1] < 0 && planePara[0] < 0)
-				pointForFill.x += planePara[3];
-			else if (planePara[0] / planePara[1] > 0 && planePara[0] > 0)
-				pointForFill.x -= planePara[3];
-			else if (planePara[0] / planePara[1] < 0 && planePara[0] > 0)
-				pointForFill.x -= planePara[3];
-			pointForFill.y = proj_min.y + ((double)i / pointPitch);
-			pointForFill.z = proj_min.z + ((double)j / pointPitch);
-			pointForFill.rgba = color;
-			cloud_filled_temp->points.push_back(pointForFill);
-		}
-	}
-
-	rotation(0, 0) = cos(-angle); rotation(0, 1) = -sin(-angle);
-	rotation(1, 0) = sin(-angle); rotation(1, 1) = cos(-angle);
-	pcl::transformPointCloud(*cloud_filled_temp, *this->pointCloud, rotation);
-	updateBoundary();
+	rotatedMinMax(angle, proj_min, proj_max);
+	setGrid(planePara, angle, pointPitch, proj_min, proj_max);
 	//PointT leftDown, rightDown, rightUp, leftUp;
 	//pcl::getMinMax3D(*cloud_filled_temp, leftDown, rightUp); //元に戻す前のy-z平面に平行な面を用いる
 	//rightDown.x = rightUp.x;
@@ -200,39 +282,12 @@ void Plane::filledPlane(int pointPitch, float heightUp, float heightDown) {
 		Eigen::Vector4d planePara = this->_abcd;
 		double angle = acos(abs(planePara[0]) / sqrt(planePara[0] * planePara[0] + planePara[1] * planePara[1] + planePara[2] * planePara[2])); //注意！！この方程式は、2平面のなす角度は、0〜90度
 		if (planePara[0] / planePara[1] > 0) angle = (-1) * angle;
-		Eigen::Matrix4f rotation = Eigen::Matrix4f::Identity();
-		rotation(0, 0) = cos(angle); rotation(0, 1) = -sin(angle);
-		rotation(1, 0) = sin(angle); rotation(1, 1) = cos(angle);
-		pcl::transformPointCloud(*this->pointCloud, *this->pointCloud, rotation);
 		PointT proj_min;
 		PointT proj_max;
-		pcl::getMinMax3D(*this->pointCloud, proj_min, proj_max);
+		rotatedMinMax(angle, proj_min, proj_max);
 		proj_max.z = heightUp;
 		proj_min.z = heightDown;
-		PointCloudT::Ptr cloud_filled_temp(new PointCloudT);
-		int32_t color = colorType2int(Color_White);
-		for (int i = 0; i <= pointPitch * (proj_max.y - proj_min.y); i++) {
-			for (int j = 0; j <= pointPitch * (proj_max.z - proj_min.z); j++) {
-				PointT pointForFill;
-				if (planePara[0] / planePara[1] > 0 && planePara[0] < 0)
-					pointForFill.x += planePara[3]; //
-				else if (planePara[0] / planePara[1] < 0 && planePara[0] < 0)
-					pointForFill.x += planePara[3];
-				else if (planePara[0] / planePara[1] > 0 && planePara[0] > 0)
-					pointForFill.x -= planePara[3];
-				else if (planePara[0] / planePara[1] < 0 && planePara[0] > 0)
-					pointForFill.x -= planePara[3];
-				pointForFill.y = proj_min.y + ((double)i / pointPitch);
-				pointForFill.z = proj_min.z + ((double)j / pointPitch);
-				pointForFill.rgba = color;
-				cloud_filled_temp->points.push_back(pointForFill);
-			}
-		}
-
-		rotation(0, 0) = cos(-angle); rotation(0, 1) = -sin(-angle);
-		rotation(1, 0) = sin(-angle); rotation(1, 1) = cos(-angle);
-		pcl::transformPointCloud(*cloud_filled_temp, *this->pointCloud, rotation);
-		updateBoundary();
+		setGrid(planePara, angle, pointPitch, proj_min, proj_max);
 		//PointT leftDown, rightDown, rightUp, leftUp;
 		//pcl::getMinMax3D(*cloud_filled_temp, leftDown, rightUp); //元に戻す前のy-z平面に平行な面を用いる
 		//rightDown.x = rightUp.x;
@@ -270,29 +325,68 @@ void Plane::applyFilter(const string axis, float min, float max) {
 		return;
 	}
 	pcl::PassThrough<PointT> filterHeight;
-	filterHeight.setInputCloud(this->pointCloud);
+	filterHeight.setInputCloud(pointCloud());
 	filterHeight.setFilterFieldName(axis);
 	filterHeight.setFilterLimits(min, max);
 	filterHeight.setFilterLimitsNegative(false);
-	filterHeight.filter(*this->pointCloud);
+	filterHeight.filter(*this->_pointCloud);
+	this->_pointStats = KKRecons::computeCloudStats(*this->_pointCloud);
+	this->_isPointStatsKnown = true;
 	// update the boundary points data
 	this->updateBoundary();
 }
 
 
 void Plane::extendPlane(PointT a1, PointT a2, PointT b1, PointT b2, float pointPitch) {
-	int color = this->pointCloud->points[0].rgba;
-	generatePlanePointCloud(a1, a2, b1, b2, pointPitch, color);
+	int color = pointCloud()->points[0].rgba;
+	this->_quads.push_back(linesQuad(a1, a2, b1, b2, pointPitch, color));
+	if (this->_isQuadsBoundsKnown) quadMinMax(this->_quads.size() - 1, 0, this->_quadsMin, this->_quadsMax);
 	updateBoundary();
 }
 void Plane::extendPlane(PointT a1, PointT a2, PointT b1, PointT b2, float pointPitch, PlaneColor colorType) {
-	generatePlanePointCloud(a1, a2, b1, b2, pointPitch, colorType2int(colorType));
+	this->_quads.push_back(linesQuad(a1, a2, b1, b2, pointPitch, colorType2int(colorType)));
+	if (this->_isQuadsBoundsKnown) quadMinMax(this->_quads.size() - 1, 0, this->_quadsMin, this->_quadsMax);
 	updateBoundary();
 }
 
+/** @brief the points of plane go after the points of this plane, its quads and holes after the quads.
+ *         The bounds of plane, or of its points when it has not got them yet, are merged into the bounds
+ */
 void Plane::append(Plane const &plane) {
-	for (int i = 0; i < plane.pointCloud->size(); ++i) {
-		this->pointCloud->points.push_back(plane.pointCloud->points[i]);
+	if (plane.size() > 0) {
+		if (!this->_quads.empty()) pointCloud(); // stored points can only follow the quads as points
+		copyView();
+		PointCloudT& cloud = *this->_pointCloud;
+		size_t first = cloud.points.size();
+		cloud.points.reserve(first + plane.size());
+		for (size_t i = 0; i < plane.size(); ++i) {
+			cloud.points.push_back(plane.point(i));
+		}
+		cloud.width = cloud.points.size();
+		cloud.height = 1;
+		if (this->_isPointStatsKnown) {
+			this->_pointStats.merge(plane._isPointStatsKnown ? plane._pointStats
+				: KKRecons::computeCloudStats(cloud.points.data() + first, cloud.points.size() - first));
+		}
+	}
+	if (!plane._quads.empty()) {
+		if (this->_quads.empty() && plane._isQuadsBoundsKnown) {
+			this->_quadsMin = plane._quadsMin;
+			this->_quadsMax = plane._quadsMax;
+			this->_isQuadsBoundsKnown = true;
+		}
+		else if (this->_isQuadsBoundsKnown && plane._isQuadsBoundsKnown) {
+			foldBox(plane._quadsMin, plane._quadsMax, this->_quadsMin, this->_quadsMax);
+		}
+		else this->_isQuadsBoundsKnown = false; // rasterizing the quads for their bounds is left to updateBoundary
+	}
+	size_t offset = this->_quads.size();
+	this->_quads.insert(this->_quads.end(), plane._quads.begin(), plane._quads.end());
+	for (size_t h = 0; h < plane._holes.size(); ++h) {
+		PlaneHole hole = plane._holes[h];
+		hole.firstQuad += offset;
+		hole.endQuad += offset;
+		this->_holes.push_back(hole);
 	}
 }
 
@@ -309,7 +403,7 @@ float Plane::getEdgeLength(edgeType type) {
 	}
 }
 
-Eigen::Vector3d Plane::getNormal() {
+Eigen::Vector3d Plane::getNormal() const {
 	Eigen::Vector3d v0(_leftUp.x, _leftUp.y, _leftUp.z);
 	Eigen::Vector3d v1(_rightUp.x, _rightUp.y, _rightUp.z);
 	Eigen::Vector3d v2(_leftDown.x, _leftDown.y, _leftDown.z);
@@ -319,114 +413,261 @@ Eigen::Vector3d Plane::getNormal() {
 }
 
 void Plane::removePointWithin(float xMin, float xMax, float yMin, float yMax, float zMin, float zMax) {
+	KKRecons::PointBox box = { xMin, xMax, yMin, yMax, zMin, zMax };
+	removePointsWithin(vector<KKRecons::PointBox>(1, box));
+}
 
-	if (xMin > xMax || yMin > yMax || zMin > zMax) {
-		PCL_ERROR("@removePointWithin, the value input max < min");
-		return;
+void Plane::removePointsWithin(const vector<KKRecons::PointBox>& boxes) {
+	vector<KKRecons::PointBox> valid;
+	valid.reserve(boxes.size());
+	for (size_t b = 0; b < boxes.size(); ++b) {
+		if (!boxes[b].isValid()) {
+			PCL_ERROR("@removePointWithin, the value input max < min");
+			continue;
+		}
+		valid.push_back(boxes[b]);
+		if (!this->_quads.empty()) {
+			PlaneHole hole = { boxes[b], 0, this->_quads.size() };
+			this->_holes.push_back(hole);
+			this->_isQuadsBoundsKnown = false;
+		}
+	}
+	if (valid.empty() || size() == 0) return;
+	copyView();
+	PointCloudT& cloud = *this->_pointCloud;
+	size_t kept = KKRecons::removeWithinBoxes(cloud.points.data(), cloud.points.size(), valid.data(), valid.size());
+	if (kept < cloud.points.size()) {
+		// a removed point may have been on the bounds, only the kept points can tell the new ones
+		this->_pointStats = KKRecons::computeCloudStats(cloud.points.data(), kept);
+		this->_isPointStatsKnown = true;
+	}
+	cloud.points.resize(kept);
+	cloud.width = kept;
+	cloud.height = 1;
+	cloud.is_dense = true;
+}
+
+
+/** @brief fit the plane with the smallest threshold distanceFromRANSACPlane + 0.1 * n keeping ratio of the points
+ *  @return false, leaving abcd unchanged, if no threshold of the 20 steps does
+ */
+bool Plane::runRANSAC(double distanceFromRANSACPlane, double ratio) {
+	const int maxSteps = 20;
+	Eigen::Vector4f sacCoefficients;
+	vector<int> sacInliers;
+	float threshold;
+	KKRecons::PlaneRansac ransac;
+	if (!this->_quads.empty()) {
+		PointCloudT points; // the quads are rasterized for the fit only
+		appendPointsTo(points);
+		ransac.setInputCloud(points);
 	}
-	pcl::ConditionOr<PointT>::Ptr range1(new pcl::ConditionOr<PointT>);  // this is not filter, but remain which parts we want
-	range1->addComparison(pcl::FieldComparison<PointT>::ConstPtr(new pcl::FieldComparison<PointT>("z", pcl::ComparisonOps::LT, zMin)));
-	range1->addComparison(pcl::FieldComparison<PointT>::ConstPtr(new pcl::FieldComparison<PointT>("z", pcl::ComparisonOps::GT, zMax)));
-
-	pcl::ConditionOr<PointT>::Ptr range2(new pcl::ConditionOr<PointT>);
-	range2->addComparison(pcl::FieldComparison<PointT>::ConstPtr(new pcl::FieldComparison<PointT>("x", pcl::ComparisonOps::LT, xMin)));
-	range2->addComparison(pcl::FieldComparison<PointT>::ConstPtr(new pcl::FieldComparison<PointT>("x", pcl::ComparisonOps::GT, xMax)));
-
-	pcl::ConditionAnd<PointT>::Ptr range3(new pcl::ConditionAnd<PointT>);
-	range3->addComparison(pcl::FieldComparison<PointT>::ConstPtr(new pcl::FieldComparison<PointT>("y", pcl::ComparisonOps::LT, yMin)));
-	range3->addComparison(pcl::FieldComparison<PointT>::ConstPtr(new pcl::FieldComparison<PointT>("y", pcl::ComparisonOps::GT, yMax)));
-	pcl::ConditionOr<PointT>::Ptr range(new pcl::ConditionOr<PointT>);
-	range->addCondition(range1);
-	range->addCondition(range2);
-	range->addCondition(range3);
-	pcl::ConditionalRemoval<PointT> condrem;
-	condrem.setCondition(range);
-	condrem.setInputCloud(this->pointCloud);
-	condrem.setKeepOrganized(false);
-	condrem.filter(*this->pointCloud);
-}
-
-
-void Plane::runRANSAC(double distanceFromRANSACPlane, double ratio) {
-	int erateTimes = 0;
-	pcl::ModelCoefficients::Ptr sacCoefficients(new pcl::ModelCoefficients);
-	pcl::PointIndices::Ptr sacInliers(new pcl::PointIndices);
-	while (true) {
-		erateTimes++;
-		if (erateTimes == 20) PCL_WARN("too many times in loop, change the value/n");
-		pcl::SACSegmentation<PointT> seg;
-		seg.setOptimizeCoefficients(true);
-		seg.setModelType(pcl::SACMODEL_PLANE);
-		seg.setMethodType(pcl::SAC_RANSAC);
-		seg.setDistanceThreshold(distanceFromRANSACPlane);
-		seg.setInputCloud(this->pointCloud);
-		seg.segment(*sacInliers, *sacCoefficients);
-		if (sacInliers->indices.size() / this->pointCloud->size() >= ratio) break;
-		distanceFromRANSACPlane += 0.1;
-		sacInliers->indices.clear();
-		sacCoefficients->values.clear();
+	else if (isView()) ransac.setInputCloud(*this->_source, this->_indices);
+	else ransac.setInputCloud(*this->_pointCloud);
+	if (!ransac.segmentToRatio(ratio, distanceFromRANSACPlane, 0.1f, maxSteps, sacInliers, sacCoefficients, threshold)) {
+		PCL_WARN("no plane keeps %.0f%% of the points within %.2f\n", ratio * 100, distanceFromRANSACPlane + 0.1 * (maxSteps - 1));
+		return false;
 	}
-	Eigen::Vector4d abcd(sacCoefficients->values[0], sacCoefficients->values[1], sacCoefficients->values[2], sacCoefficients->values[3]);
+	Eigen::Vector4d abcd(sacCoefficients[0], sacCoefficients[1], sacCoefficients[2], sacCoefficients[3]);
 	this->_abcd = abcd;
+	return true;
 }
 /**\paragraph Private Methods
  */
 
- /**@bug remember to update the boundary infomation
-  */
-void Plane::generatePlanePointCloud(PointT a1, PointT a2, PointT b1, PointT b2, float pointPitch, int color) {
-	int num1 = (pcl::geometry::distance(a1, a2) * pointPitch);
-	int num2 = (pcl::geometry::distance(b1, b2) * pointPitch);
-	int num = num1 < num2 ? num1 : num2;
-	vector<Eigen::Vector3f> pt1;
-	pt1.push_back(Eigen::Vector3f(a1.x, a1.y, a1.z));
-	pt1.push_back(Eigen::Vector3f(a2.x, a2.y, a2.z));
-	vector<Eigen::Vector3f> pt2;
-	pt2.push_back(Eigen::Vector3f(b1.x, b1.y, b1.z));
-	pt2.push_back(Eigen::Vector3f(b2.x, b2.y, b2.z));
-	Eigen::Vector3f stepLine1 = (-pt1[0] + pt1[1]) / num;
-	Eigen::Vector3f stepLine2 = (-pt2[0] + pt2[1]) / num;
-	vector<PointT> line1Points;
-	vector<PointT> line2Points;
-	for (size_t i = 0; i < num; i++) {
-		PointT p;
-		p.x = pt1[0][0] + i * stepLine1[0];
-		p.y = pt1[0][1] + i * stepLine1[1];
-		p.z = pt1[0][2] + i * stepLine1[2];
-		line1Points.push_back(p);
+/** @brief append the points filledPlane used to generate for a grid quad, in the same order.
+ *         The grid turns around z only, so a row has one x and y and all rows share the heights of the columns,
+ *         the rows are written in parallel straight into their place in output
+ */
+void Plane::generateGridPointCloud(const PlaneQuad& quad, int pointPitch, PointCloudT& output) {
+	size_t rows, columns;
+	gridSize(quad, pointPitch, rows, columns);
+	if (rows == 0 || columns == 0) return;
+	vector<float> heights(columns);
+	for (size_t j = 0; j < columns; ++j) {
+		heights[j] = gridZ(quad, pointPitch, j);
 	}
+	size_t offset = output.points.size();
+	output.points.resize(offset + rows * columns);
+	PointT* points = &output.points[offset];
+	const ZRotation rotation(-quad.angle);
+	int threads = rows * columns < KKRecons::minParallelItems ? 1 : 0;
+	KKRecons::parallelFor(rows, threads, [&](size_t begin, size_t end, size_t) {
+		PointT pointForFill;
+		pointForFill.rgba = quad.color;
+		for (size_t i = begin; i < end; ++i) {
+			float y = gridY(quad, pointPitch, i);
+			pointForFill.x = rotation.x(quad.x, y);
+			pointForFill.y = rotation.y(quad.x, y);
+			PointT* row = points + i * columns;
+			for (size_t j = 0; j < columns; ++j) {
+				pointForFill.z = heights[j];
+				row[j] = pointForFill;
+			}
+		}
+	});
+	output.width = output.points.size();
+	output.height = 1;
+}
+
+/** @brief the quad filledPlane fills, the stored points and quads are dropped
+ */
+void Plane::setGrid(const Eigen::Vector4d& planePara, double angle, int pointPitch, const PointT& proj_min, const PointT& proj_max) {
+	PointT pointForFill;
+	if (planePara[0] / planePara[1] > 0 && planePara[0] < 0)
+		pointForFill.x += planePara[3]; //
+	else if (planePara[0] / planePara[1] < 0 && planePara[0] < 0)
+		pointForFill.x += planePara[3];
+	else if (planePara[0] / planePara[1] > 0 && planePara[0] > 0)
+		pointForFill.x -= planePara[3];
+	else if (planePara[0] / planePara[1] < 0 && planePara[0] > 0)
+		pointForFill.x -= planePara[3];
+	PlaneQuad quad = PlaneQuad();
+	quad.shape = PlaneQuad::Grid;
+	quad.color = colorType2int(Color_White);
+	quad.pointPitch = pointPitch;
+	quad.x = pointForFill.x;
+	quad.minY = proj_min.y; quad.maxY = proj_max.y;
+	quad.minZ = proj_min.z; quad.maxZ = proj_max.z;
+	quad.angle = angle;
+
+	PointCloudT::Ptr tmp(new PointCloudT);
+	this->_pointCloud = tmp;
+	this->_source.reset();
+	vector<int>().swap(this->_indices);
+	this->_quads.assign(1, quad);
+	this->_holes.clear();
+	this->_pointStats = KKRecons::CloudStats();
+	this->_isPointStatsKnown = true;
+	this->_isQuadsBoundsKnown = false;
+	updateBoundary();
+}
 
-	for (size_t i = 0; i < num; i++) {
-		PointT p;
-		p.x = pt2[0][0] + i * stepLine2[0];
-		p.y = pt2[0][1] + i * stepLine2[1];
-		p.z = pt2[0][2] + i * stepLine2[2];
-		line2Points.push_back(p);
+/** @brief append the points of a quad the holes have left, at pointPitch or at its own pitch when it is 0
+ */
+void Plane::rasterizeQuad(size_t quad, float pointPitch, PointCloudT& cloud) const {
+	const PlaneQuad& q = this->_quads[quad];
+	if (pointPitch <= 0) pointPitch = q.pointPitch;
+	vector<KKRecons::PointBox> holes;
+	for (size_t h = 0; h < this->_holes.size(); ++h) {
+		if (this->_holes[h].firstQuad <= quad && quad < this->_holes[h].endQuad) holes.push_back(this->_holes[h].box);
 	}
+	size_t first = cloud.points.size();
+	if (q.shape == PlaneQuad::Grid) generateGridPointCloud(q, pointPitch, cloud);
+	else {
+		KKRecons::QuadRaster<PointT> raster;
+		raster.addQuad(q.a1, q.a2, q.b1, q.b2, pointPitch, q.color);
+		raster.rasterize(cloud);
+	}
+	if (holes.empty()) return;
+	size_t kept = KKRecons::removeWithinBoxes(cloud.points.data() + first, cloud.points.size() - first,
+	                                          holes.data(), holes.size());
+	cloud.points.resize(first + kept);
+}
 
-	for (size_t i = 0; i < num; i++) {
-		generateLinePointCloud(line1Points[i], line2Points[i], pointPitch, color);
+/** @brief expand min and max by the points of the quads rotated by angle around z
+ */
+void Plane::quadsMinMax(double angle, PointT& min, PointT& max) const {
+	for (size_t q = 0; q < this->_quads.size(); ++q) {
+		quadMinMax(q, angle, min, max);
+	}
+}
+
+/** @brief expand min and max by the points of a quad rotated by angle around z.
+ *         A grid without holes is bounded row by row: x and y are the same along a row and z is the same
+ *         for all rows, so its lowest and highest column bound the row
+ */
+void Plane::quadMinMax(size_t q, double angle, PointT& min, PointT& max) const {
+	const ZRotation rotation(angle);
+	const PlaneQuad& quad = this->_quads[q];
+	bool hasHole = false;
+	for (size_t h = 0; h < this->_holes.size(); ++h) {
+		hasHole |= this->_holes[h].firstQuad <= q && q < this->_holes[h].endQuad;
+	}
+	if (quad.shape == PlaneQuad::Grid && !hasHole) {
+		int pointPitch = quad.pointPitch;
+		size_t rows, columns;
+		gridSize(quad, pointPitch, rows, columns);
+		if (rows == 0 || columns == 0) return;
+		float lowest = gridZ(quad, pointPitch, 0), highest = gridZ(quad, pointPitch, columns - 1);
+		const ZRotation back(-quad.angle);
+		for (size_t i = 0; i < rows; ++i) {
+			float y = gridY(quad, pointPitch, i);
+			float x = back.x(quad.x, y);
+			y = back.y(quad.x, y);
+			foldMinMax(rotation.x(x, y), rotation.y(x, y), lowest, min, max);
+			foldMinMax(rotation.x(x, y), rotation.y(x, y), highest, min, max);
+		}
+	}
+	else {
+		PointCloudT points;
+		rasterizeQuad(q, 0, points);
+		for (size_t i = 0; i < points.size(); ++i) {
+			foldRotated(points.points[i], rotation, min, max);
+		}
+	}
+}
+
+/** @brief a view copies its points and stops being a view, the quads are kept
+ */
+void Plane::copyView() {
+	if (isView()) {
+		pcl::copyPointCloud(*this->_source, this->_indices, *this->_pointCloud);
+		this->_source.reset();
+		vector<int>().swap(this->_indices);
+	}
+}
+
+/** @brief the bounding box of the points rotated by angle around z in one pass, the plane is not changed.
+ *         Points that are not finite are skipped, every thread bounds a block of the points
+ */
+void Plane::rotatedMinMax(double angle, PointT& min, PointT& max) const {
+	min.x = min.y = min.z = FLT_MAX;
+	max.x = max.y = max.z = -FLT_MAX;
+	const ZRotation rotation(angle);
+	const size_t n = size();
+	int threads = n < KKRecons::minParallelItems ? 1 : KKRecons::resolveThreads(0);
+	vector<PointT> mins(threads, min), maxs(threads, max);
+	KKRecons::parallelFor(n, threads, [&](size_t begin, size_t end, size_t t) {
+		PointT& ownMin = mins[t];
+		PointT& ownMax = maxs[t];
+		for (size_t i = begin; i < end; ++i) {
+			foldRotated(point(i), rotation, ownMin, ownMax);
+		}
+	});
+	for (size_t t = 0; t < mins.size(); ++t) {
+		foldBox(mins[t], maxs[t], min, max);
+	}
+	quadsMinMax(angle, min, max);
+}
+
+/** @brief the stats of the stored points, a pass over them the first time only
+ */
+const KKRecons::CloudStats& Plane::pointStats() {
+	if (!this->_isPointStatsKnown) {
+		this->_pointStats = isView() ? KKRecons::computeCloudStats(*this->_source, this->_indices)
+			: KKRecons::computeCloudStats(*this->_pointCloud);
+		this->_isPointStatsKnown = true;
 	}
+	return this->_pointStats;
 }
 
-void Plane::generateLinePointCloud(PointT pt1, PointT pt2, int pointPitch, int color) {
-	int numPoints = pcl::geometry::distance(pt1, pt2) * pointPitch;
-	float ratioX = (pt1.x - pt2.x) / numPoints;
-	float ratioY = (pt1.y - pt2.y) / numPoints;
-	float ratioZ = (pt1.z - pt2.z) / numPoints;
-	for (size_t i = 0; i <= numPoints; i++) {
-		PointT p;
-		p.x = pt2.x + i * (ratioX);
-		p.y = pt2.y + i * (ratioY);
-		p.z = pt2.z + i * (ratioZ);
-		p.rgba = color;
-		this->pointCloud->points.push_back(p);
+void Plane::bounds(PointT& min, PointT& max) {
+	if (!this->_isQuadsBoundsKnown) {
+		this->_quadsMin.x = this->_quadsMin.y = this->_quadsMin.z = FLT_MAX;
+		this->_quadsMax.x = this->_quadsMax.y = this->_quadsMax.z = -FLT_MAX;
+		quadsMinMax(0, this->_quadsMin, this->_quadsMax);
+		this->_isQuadsBoundsKnown = true;
 	}
+	const KKRecons::CloudStats& stats = pointStats();
+	min.getVector3fMap() = stats.min;
+	max.getVector3fMap() = stats.max;
+	foldBox(this->_quadsMin, this->_quadsMax, min, max);
 }
 
 void Plane::updateBoundary() {
 	PointT min, max;
-	pcl::getMinMax3D(*this->pointCloud, min, max);
+	bounds(min, max);
 	PointT leftUp, leftDown, rightUp, rightDown;
 	leftUp.z = max.z;
 	leftDown.z = min.z;
@@ -0,0 +1,440 @@
+#include <cmath>
+#include <limits>
+#include <random>
+#include <algorithm>
+#include <Eigen/Eigenvalues>
+#include <PlaneRansac.h>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define KK_RANSAC_SIMD
+#endif
+
+using namespace std;
+
+namespace {
+    const size_t padding = 16;
+
+    // every kernel computes |((a x + b y) + c z) + d| in the same order and without fused multiply-add,
+    // so they all agree on borderline points. A batch of planes is scored in one pass over the points.
+    template<int batch>
+    __attribute__((optimize("fp-contract=off")))
+    void countScalar(const float* x, const float* y, const float* z, size_t n, const float planes[][4], float threshold, size_t counts[]) {
+        for (int h = 0; h < batch; ++h) counts[h] = 0;
+        for (size_t i = 0; i < n; ++i) {
+            for (int h = 0; h < batch; ++h) {
+                float distance = fabsf(planes[h][0] * x[i] + planes[h][1] * y[i] + planes[h][2] * z[i] + planes[h][3]);
+                counts[h] += distance < threshold;
+            }
+        }
+    }
+
+#ifdef KK_RANSAC_SIMD
+    template<int batch>
+    __attribute__((target("avx2"), optimize("fp-contract=off")))
+    void countAVX2(const float* x, const float* y, const float* z, size_t n, const float planes[][4], float threshold, size_t counts[]) {
+        __m256 a[batch], b[batch], c[batch], d[batch];
+        __m256i sums[batch];
+        for (int h = 0; h < batch; ++h) {
+            a[h] = _mm256_set1_ps(planes[h][0]);
+            b[h] = _mm256_set1_ps(planes[h][1]);
+            c[h] = _mm256_set1_ps(planes[h][2]);
+            d[h] = _mm256_set1_ps(planes[h][3]);
+            sums[h] = _mm256_setzero_si256();
+        }
+        const __m256 limit = _mm256_set1_ps(threshold);
+        const __m256 signMask = _mm256_set1_ps(-0.0f);
+        // n is padded to a multiple of 16, the NaN padding never compares below the threshold
+        for (size_t i = 0; i < n; i += 8) {
+            __m256 px = _mm256_loadu_ps(x + i), py = _mm256_loadu_ps(y + i), pz = _mm256_loadu_ps(z + i);
+            for (int h = 0; h < batch; ++h) {
+                __m256 distance = _mm256_add_ps(_mm256_mul_ps(a[h], px), _mm256_mul_ps(b[h], py));
+                distance = _mm256_add_ps(distance, _mm256_mul_ps(c[h], pz));
+                distance = _mm256_andnot_ps(signMask, _mm256_add_ps(distance, d[h]));
+                // an inlier lane is all ones, -1 as an integer
+                sums[h] = _mm256_sub_epi32(sums[h], _mm256_castps_si256(_mm256_cmp_ps(distance, limit, _CMP_LT_OQ)));
+            }
+        }
+        for (int h = 0; h < batch; ++h) {
+            alignas(32) uint32_t lanes[8];
+            _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), sums[h]);
+            counts[h] = 0;
+            for (int lane = 0; lane < 8; ++lane) counts[h] += lanes[lane];
+        }
+    }
+
+    template<int batch>
+    __attribute__((target("avx512f"), optimize("fp-contract=off")))
+    void countAVX512(const float* x, const float* y, const float* z, size_t n, const float planes[][4], float threshold, size_t counts[]) {
+        __m512 a[batch], b[batch], c[batch], d[batch];
+        for (int h = 0; h < batch; ++h) {
+            a[h] = _mm512_set1_ps(planes[h][0]);
+            b[h] = _mm512_set1_ps(planes[h][1]);
+            c[h] = _mm512_set1_ps(planes[h][2]);
+            d[h] = _mm512_set1_ps(planes[h][3]);
+            counts[h] = 0;
+        }
+        const __m512 limit = _mm512_set1_ps(threshold);
+        for (size_t i = 0; i < n; i += 16) {
+            __m512 px = _mm512_loadu_ps(x + i), py = _mm512_loadu_ps(y + i), pz = _mm512_loadu_ps(z + i);
+            for (int h = 0; h < batch; ++h) {
+                __m512 distance = _mm512_add_ps(_mm512_mul_ps(a[h], px), _mm512_mul_ps(b[h], py));
+                distance = _mm512_add_ps(distance, _mm512_mul_ps(c[h], pz));
+                distance = _mm512_abs_ps(_mm512_add_ps(distance, d[h]));
+                counts[h] += __builtin_popcount(_mm512_cmp_ps_mask(distance, limit, _CMP_LT_OQ));
+            }
+        }
+    }
+
+    // the histogram kernels count, for every plane h and threshold j, the points closer than the threshold into
+    // below[h * numSteps + j], one branch-free compare per threshold instead of a search for the bin
+    template<int batch>
+    __attribute__((target("avx2"), optimize("fp-contract=off")))
+    void belowAVX2(const float* x, const float* y, const float* z, size_t n, const float planes[][4],
+                   const float* thresholds, int numSteps, size_t* below) {
+        __m256 a[batch], b[batch], c[batch], d[batch];
+        for (int h = 0; h < batch; ++h) {
+            a[h] = _mm256_set1_ps(planes[h][0]);
+            b[h] = _mm256_set1_ps(planes[h][1]);
+            c[h] = _mm256_set1_ps(planes[h][2]);
+            d[h] = _mm256_set1_ps(planes[h][3]);
+        }
+        const __m256 signMask = _mm256_set1_ps(-0.0f);
+        // eight lanes of counts per plane and threshold
+        vector<uint32_t> sums(static_cast<size_t>(batch) * numSteps * 8, 0);
+        for (size_t i = 0; i < n; i += 8) {
+            __m256 px = _mm256_loadu_ps(x + i), py = _mm256_loadu_ps(y + i), pz = _mm256_loadu_ps(z + i);
+            for (int h = 0; h < batch; ++h) {
+                __m256 distance = _mm256_add_ps(_mm256_mul_ps(a[h], px), _mm256_mul_ps(b[h], py));
+                distance = _mm256_add_ps(distance, _mm256_mul_ps(c[h], pz));
+                distance = _mm256_andnot_ps(signMask, _mm256_add_ps(distance, d[h]));
+                __m256i* sum = reinterpret_cast<__m256i*>(sums.data() + static_cast<size_t>(h) * numSteps * 8);
+                for (int j = 0; j < numSteps; ++j) {
+                    __m256i isBelow = _mm256_castps_si256(_mm256_cmp_ps(distance, _mm256_set1_ps(thresholds[j]), _CMP_LT_OQ));
+                    _mm256_storeu_si256(sum + j, _mm256_sub_epi32(_mm256_loadu_si256(sum + j), isBelow));
+                }
+            }
+        }
+        for (int k = 0; k < batch * numSteps; ++k) {
+            below[k] = 0;
+            for (int lane = 0; lane < 8; ++lane) below[k] += sums[static_cast<size_t>(k) * 8 + lane];
+        }
+    }
+
+    template<int batch>
+    __attribute__((target("avx512f"), optimize("fp-contract=off")))
+    void belowAVX512(const float* x, const float* y, const float* z, size_t n, const float planes[][4],
+                     const float* thresholds, int numSteps, size_t* below) {
+        __m512 a[batch], b[batch], c[batch], d[batch];
+        for (int h = 0; h < batch; ++h) {
+            a[h] = _mm512_set1_ps(planes[h][0]);
+            b[h] = _mm512_set1_ps(planes[h][1]);
+            c[h] = _mm512_set1_ps(planes[h][2]);
+            d[h] = _mm512_set1_ps(planes[h][3]);
+        }
+        fill(below, below + batch * numSteps, 0);
+        for (size_t i = 0; i < n; i += 16) {
+            __m512 px = _mm512_loadu_ps(x + i), py = _mm512_loadu_ps(y + i), pz = _mm512_loadu_ps(z + i);
+            for (int h = 0; h < batch; ++h) {
+                __m512 distance = _mm512_add_ps(_mm512_mul_ps(a[h], px), _mm512_mul_ps(b[h], py));
+                distance = _mm512_add_ps(distance, _mm512_mul_ps(c[h], pz));
+                distance = _mm512_abs_ps(_mm512_add_ps(distance, d[h]));
+                size_t* counts = below + h * numSteps;
+                for (int j = 0; j < numSteps; ++j) {
+                    counts[j] += __builtin_popcount(_mm512_cmp_ps_mask(distance, _mm512_set1_ps(thresholds[j]), _CMP_LT_OQ));
+                }
+            }
+        }
+    }
+#endif
+
+    // histograms[h * (numSteps + 1) + j] counts the points whose first threshold above their distance to plane h is j,
+    // j == numSteps for points beyond the last threshold
+    template<int batch>
+    __attribute__((optimize("fp-contract=off")))
+    void histogramsScalar(const float* x, const float* y, const float* z, size_t n, const float planes[][4],
+                          const float* thresholds, int numSteps, size_t* histograms) {
+        fill(histograms, histograms + batch * (numSteps + 1), 0);
+        for (size_t i = 0; i < n; ++i) {
+            for (int h = 0; h < batch; ++h) {
+                float distance = fabsf(planes[h][0] * x[i] + planes[h][1] * y[i] + planes[h][2] * z[i] + planes[h][3]);
+                histograms[h * (numSteps + 1) + (upper_bound(thresholds, thresholds + numSteps, distance) - thresholds)]++;
+            }
+        }
+    }
+
+    // the histograms of n points from the counts below every threshold, the thresholds being sorted
+    void histogramsFromBelow(const size_t* below, int batch, int numSteps, size_t n, size_t* histograms) {
+        for (int h = 0; h < batch; ++h) {
+            size_t previous = 0;
+            for (int j = 0; j < numSteps; ++j) {
+                histograms[h * (numSteps + 1) + j] = below[h * numSteps + j] - previous;
+                previous = below[h * numSteps + j];
+            }
+            histograms[h * (numSteps + 1) + numSteps] = n - previous;
+        }
+    }
+
+    bool isSupported(KKRecons::ScoreKernel kernel) {
+#ifdef KK_RANSAC_SIMD
+        if (kernel == KKRecons::ScoreKernel_AVX512) return __builtin_cpu_supports("avx512f");
+        if (kernel == KKRecons::ScoreKernel_AVX2) return __builtin_cpu_supports("avx2");
+#endif
+        return kernel == KKRecons::ScoreKernel_Scalar;
+    }
+}
+
+KKRecons::PlaneRansac::PlaneRansac() {
+    setKernel(ScoreKernel_Auto);
+}
+
+void KKRecons::PlaneRansac::setKernel(ScoreKernel kernel) {
+    if (kernel == ScoreKernel_Auto) kernel = ScoreKernel_AVX512;
+    while (kernel != ScoreKernel_Scalar && !isSupported(kernel)) {
+        kernel = kernel == ScoreKernel_AVX512 ? ScoreKernel_AVX2 : ScoreKernel_Scalar;
+    }
+    activeKernel = kernel;
+}
+
+template<typename PointType>
+void KKRecons::PlaneRansac::setInputCloud(const pcl::PointCloud<PointType> &cloud) {
+    resizePoints(cloud.size());
+    for (size_t i = 0; i < numPoints; ++i) {
+        x[i] = cloud.points[i].x;
+        y[i] = cloud.points[i].y;
+        z[i] = cloud.points[i].z;
+    }
+}
+
+template<typename PointType>
+void KKRecons::PlaneRansac::setInputCloud(const pcl::PointCloud<PointType> &cloud, const vector<int> &indices) {
+    resizePoints(indices.size());
+    for (size_t i = 0; i < numPoints; ++i) {
+        const PointType &p = cloud.points[indices[i]];
+        x[i] = p.x;
+        y[i] = p.y;
+        z[i] = p.z;
+    }
+}
+
+void KKRecons::PlaneRansac::resizePoints(size_t size) {
+    numPoints = size;
+    size_t padded = (numPoints + padding - 1) / padding * padding;
+    const float nan = numeric_limits<float>::quiet_NaN();
+    x.assign(padded, nan);
+    y.assign(padded, nan);
+    z.assign(padded, nan);
+}
+
+size_t KKRecons::PlaneRansac::countWithinDistance(const Eigen::Vector4f &plane, float threshold) const {
+    size_t counts[batchSize];
+    countWithinDistance(&plane, 1, threshold, counts);
+    return counts[0];
+}
+
+void KKRecons::PlaneRansac::countWithinDistance(const Eigen::Vector4f* planes, int numPlanes, float threshold, size_t counts[]) const {
+    for (int first = 0; first < numPlanes; first += batchSize) {
+        // a lone plane gets its own pass, unused slots of a batch get a NaN plane, which has no inliers
+        float batchPlanes[batchSize][4];
+        size_t batchCounts[batchSize];
+        for (int h = 0; h < batchSize; ++h) {
+            for (int j = 0; j < 4; ++j) {
+                batchPlanes[h][j] = first + h < numPlanes ? planes[first + h][j] : numeric_limits<float>::quiet_NaN();
+            }
+        }
+        bool isSingle = numPlanes - first == 1;
+#ifdef KK_RANSAC_SIMD
+        if (activeKernel == ScoreKernel_AVX512) {
+            if (isSingle) countAVX512<1>(x.data(), y.data(), z.data(), x.size(), batchPlanes, threshold, batchCounts);
+            else countAVX512<batchSize>(x.data(), y.data(), z.data(), x.size(), batchPlanes, threshold, batchCounts);
+        }
+        else if (activeKernel == ScoreKernel_AVX2) {
+            if (isSingle) countAVX2<1>(x.data(), y.data(), z.data(), x.size(), batchPlanes, threshold, batchCounts);
+            else countAVX2<batchSize>(x.data(), y.data(), z.data(), x.size(), batchPlanes, threshold, batchCounts);
+        }
+        else
+#endif
+        if (isSingle) countScalar<1>(x.data(), y.data(), z.data(), numPoints, batchPlanes, threshold, batchCounts);
+        else countScalar<batchSize>(x.data(), y.data(), z.data(), numPoints, batchPlanes, threshold, batchCounts);
+        for (int h = 0; h < batchSize && first + h < numPlanes; ++h) counts[first + h] = batchCounts[h];
+    }
+}
+
+void KKRecons::PlaneRansac::residualHistograms(const float planes[][4], int numPlanes, const float* thresholds,
+                                               int numSteps, size_t* histograms) const {
+    bool isSingle = numPlanes == 1;
+#ifdef KK_RANSAC_SIMD
+    if (activeKernel != ScoreKernel_Scalar) {
+        // the padding is NaN and never below a threshold, the points beyond the last one follow from numPoints
+        vector<size_t> below(static_cast<size_t>(batchSize) * numSteps);
+        if (activeKernel == ScoreKernel_AVX512) {
+            if (isSingle) belowAVX512<1>(x.data(), y.data(), z.data(), x.size(), planes, thresholds, numSteps, below.data());
+            else belowAVX512<batchSize>(x.data(), y.data(), z.data(), x.size(), planes, thresholds, numSteps, below.data());
+        }
+        else {
+            if (isSingle) belowAVX2<1>(x.data(), y.data(), z.data(), x.size(), planes, thresholds, numSteps, below.data());
+            else belowAVX2<batchSize>(x.data(), y.data(), z.data(), x.size(), planes, thresholds, numSteps, below.data());
+        }
+        histogramsFromBelow(below.data(), isSingle ? 1 : batchSize, numSteps, numPoints, histograms);
+        return;
+    }
+#endif
+    if (isSingle) histogramsScalar<1>(x.data(), y.data(), z.data(), numPoints, planes, thresholds, numSteps, histograms);
+    else histogramsScalar<batchSize>(x.data(), y.data(), z.data(), numPoints, planes, thresholds, numSteps, histograms);
+}
+
+__attribute__((optimize("fp-contract=off")))
+void KKRecons::PlaneRansac::selectWithinDistance(const Eigen::Vector4f &plane, float threshold, vector<int> &inliers) const {
+    inliers.clear();
+    for (size_t i = 0; i < numPoints; ++i) {
+        float distance = fabsf(plane[0] * x[i] + plane[1] * y[i] + plane[2] * z[i] + plane[3]);
+        if (distance < threshold) inliers.push_back(static_cast<int>(i));
+    }
+}
+
+bool KKRecons::PlaneRansac::segment(vector<int> &inliers, Eigen::Vector4f &coefficients, uint32_t seed) {
+    inliers.clear();
+    numIterations = 0;
+    if (numPoints < 3) return false;
+    mt19937 rng(seed);
+    // the loop of pcl::RandomSampleConsensus::computeModel
+    const double logProbability = log(1.0 - probability);
+    const double eps = numeric_limits<double>::epsilon();
+    double k = 1.0;
+    size_t bestCount = 0;
+    bool isFound = false;
+    int skipped = 0, maxSkip = maxIterations * 10;
+    // hypotheses are drawn and scored a batch at a time but taken in order, so the result is the one of the plain loop
+    Eigen::Vector4f planes[batchSize];
+    size_t counts[batchSize];
+    bool isStopped = false;
+    while (!isStopped && numIterations < k && skipped < maxSkip) {
+        int numPlanes = 0;
+        while (numPlanes < batchSize && skipped < maxSkip) {
+            int i0 = static_cast<int>(rng() % numPoints), i1 = static_cast<int>(rng() % numPoints), i2 = static_cast<int>(rng() % numPoints);
+            if (i0 == i1 || i0 == i2 || i1 == i2 || !planeFromSample(i0, i1, i2, planes[numPlanes])) skipped++;
+            else numPlanes++;
+        }
+        countWithinDistance(planes, numPlanes, distanceThreshold, counts);
+        for (int h = 0; h < numPlanes && !isStopped; ++h) {
+            if (!(numIterations < k)) {
+                isStopped = true;
+                break;
+            }
+            if (counts[h] > bestCount || !isFound) {
+                bestCount = counts[h];
+                coefficients = planes[h];
+                isFound = true;
+                double w = static_cast<double>(bestCount) / numPoints;
+                double pNoOutliers = min(max(1.0 - w * w * w, eps), 1.0 - eps);
+                k = logProbability / log(pNoOutliers);
+            }
+            if (++numIterations > maxIterations) isStopped = true;
+        }
+    }
+    if (!isFound) return false;
+    selectWithinDistance(coefficients, distanceThreshold, inliers);
+    refinePlane(inliers, coefficients);
+    selectWithinDistance(coefficients, distanceThreshold, inliers);
+    return true;
+}
+
+bool KKRecons::PlaneRansac::segmentToRatio(double ratio, float baseThreshold, float step, int maxSteps, vector<int> &inliers,
+                                           Eigen::Vector4f &coefficients, float &threshold, uint32_t seed) {
+    inliers.clear();
+    numIterations = 0;
+    if (numPoints < 3 || maxSteps <= 0) return false;
+    const size_t needed = static_cast<size_t>(ceil(ratio * numPoints));
+    vector<float> thresholds(maxSteps);
+    for (int j = 0; j < maxSteps; ++j) thresholds[j] = static_cast<float>(baseThreshold + static_cast<double>(step) * j);
+    mt19937 rng(seed);
+    int bestStep = maxSteps, skipped = 0, maxSkip = maxIterations * 10;
+    size_t bestCount = 0;
+    Eigen::Vector4f planes[batchSize];
+    vector<size_t> histograms(batchSize * (maxSteps + 1));
+    // no plane can do better than the first threshold, so the budget ends early once one gets there
+    while (numIterations < maxIterations && skipped < maxSkip && bestStep > 0) {
+        int numPlanes = 0;
+        while (numPlanes < min(batchSize, maxIterations - numIterations) && skipped < maxSkip) {
+            int i0 = static_cast<int>(rng() % numPoints), i1 = static_cast<int>(rng() % numPoints), i2 = static_cast<int>(rng() % numPoints);
+            if (i0 == i1 || i0 == i2 || i1 == i2 || !planeFromSample(i0, i1, i2, planes[numPlanes])) skipped++;
+            else numPlanes++;
+        }
+        if (numPlanes == 0) break;
+        float batchPlanes[batchSize][4];
+        for (int h = 0; h < batchSize; ++h) {
+            for (int j = 0; j < 4; ++j) batchPlanes[h][j] = h < numPlanes ? planes[h][j] : numeric_limits<float>::quiet_NaN();
+        }
+        residualHistograms(batchPlanes, batchSize, thresholds.data(), maxSteps, histograms.data());
+        for (int h = 0; h < numPlanes; ++h) {
+            numIterations++;
+            const size_t* histogram = histograms.data() + h * (maxSteps + 1);
+            size_t count = 0;
+            int j = 0;
+            for (; j < maxSteps; ++j) {
+                count += histogram[j];
+                if (count >= needed) break;
+            }
+            if (j < bestStep || (j == bestStep && j < maxSteps && count > bestCount)) {
+                bestStep = j;
+                bestCount = count;
+                coefficients = planes[h];
+            }
+        }
+    }
+    if (bestStep == maxSteps) return false;
+    // the least squares plane of those inliers usually gets there with fewer steps
+    selectWithinDistance(coefficients, thresholds[bestStep], inliers);
+    Eigen::Vector4f refined = coefficients;
+    refinePlane(inliers, refined);
+    float refinedPlane[batchSize][4] = {{refined[0], refined[1], refined[2], refined[3]}};
+    residualHistograms(refinedPlane, 1, thresholds.data(), maxSteps, histograms.data());
+    size_t count = 0;
+    for (int j = 0; j <= bestStep; ++j) {
+        count += histograms[j];
+        if (count < needed) continue;
+        coefficients = refined;
+        bestStep = j;
+        break;
+    }
+    threshold = thresholds[bestStep];
+    selectWithinDistance(coefficients, threshold, inliers);
+    return true;
+}
+
+bool KKRecons::PlaneRansac::planeFromSample(int i0, int i1, int i2, Eigen::Vector4f &plane) const {
+    Eigen::Array3f p0(x[i0], y[i0], z[i0]), p1(x[i1], y[i1], z[i1]), p2(x[i2], y[i2], z[i2]);
+    Eigen::Array3f p1p0 = p1 - p0, p2p0 = p2 - p0;
+    Eigen::Array3f dy1dy2 = p1p0 / p2p0;
+    if (dy1dy2[0] == dy1dy2[1] && dy1dy2[2] == dy1dy2[1]) return false; // collinear
+    Eigen::Vector3f normal(p1p0[1] * p2p0[2] - p1p0[2] * p2p0[1],
+                           p1p0[2] * p2p0[0] - p1p0[0] * p2p0[2],
+                           p1p0[0] * p2p0[1] - p1p0[1] * p2p0[0]);
+    float norm = normal.norm();
+    if (!(norm > 0) || !std::isfinite(norm)) return false;
+    normal /= norm;
+    plane = Eigen::Vector4f(normal[0], normal[1], normal[2], -normal.dot(p0.matrix()));
+    return true;
+}
+
+// least squares plane of the inliers, what SampleConsensusModelPlane::optimizeModelCoefficients does
+void KKRecons::PlaneRansac::refinePlane(const vector<int> &inliers, Eigen::Vector4f &plane) const {
+    if (inliers.size() < 3) return;
+    Eigen::Vector3d sum = Eigen::Vector3d::Zero();
+    for (int i : inliers) sum += Eigen::Vector3d(x[i], y[i], z[i]);
+    Eigen::Vector3d centroid = sum / static_cast<double>(inliers.size());
+    Eigen::Matrix3d covariance = Eigen::Matrix3d::Zero();
+    for (int i : inliers) {
+        Eigen::Vector3d p = Eigen::Vector3d(x[i], y[i], z[i]) - centroid;
+        covariance += p * p.transpose();
+    }
+    Eigen::SelfAdjointEigenSolver<Eigen::Matrix3d> solver(covariance);
+    Eigen::Vector3d normal = solver.eigenvectors().col(0); // the smallest eigenvalue comes first
+    if (!normal.allFinite()) return;
+    plane = Eigen::Vector4f(static_cast<float>(normal[0]), static_cast<float>(normal[1]), static_cast<float>(normal[2]),
+                            static_cast<float>(-normal.dot(centroid)));
+}
+
+template void KKRecons::PlaneRansac::setInputCloud<pcl::PointXYZRGB>(const pcl::PointCloud<pcl::PointXYZRGB>&);
+template void KKRecons::PlaneRansac::setInputCloud<pcl::PointXYZRGBNormal>(const pcl::PointCloud<pcl::PointXYZRGBNormal>&);
+template void KKRecons::PlaneRansac::setInputCloud<pcl::PointXYZRGB>(const pcl::PointCloud<pcl::PointXYZRGB>&, const vector<int>&);
+template void KKRecons::PlaneRansac::setInputCloud<pcl::PointXYZRGBNormal>(const pcl::PointCloud<pcl::PointXYZRGBNormal>&, const vector<int>&);
@@ -0,0 +1,417 @@
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+#include <PlaneSet.h>
+
+using namespace std;
+
+namespace {
+    // isOverlap of extract_walls: the wall line y = k0 x + b0 meets its perpendicular through (px, py) at a point
+    // within the x or y extent of the corners (lx, ly), (rx, ry). The 2x2 system it solved has this closed form
+    inline bool crossesWithin(float k0, float b0, float lx, float ly, float rx, float ry, float px, float py) {
+        float k1 = -1 / k0;
+        float b1 = py - k1 * px;
+        float x = (b1 - b0) / (k0 - k1);
+        float y = k0 * x + b0;
+        float largeX = lx > rx ? lx : rx;
+        float smallX = lx < rx ? lx : rx;
+        float largeY = ly > ry ? ly : ry;
+        float smallY = ly < ry ? ly : ry;
+        return ((x >= smallX) & (x <= largeX)) | ((y >= smallY) & (y <= largeY));
+    }
+
+    // the angle between two normals is at most the one whose cosine is limit
+    inline bool normalWithin(double x, double y, double z, double length,
+                             double nx, double ny, double nz, double nLength, double limit) {
+        double cosine = (x * nx + y * ny + z * nz) / (length * nLength);
+        // a cosine rounded below -1 made acos NaN, which never exceeded the angle
+        return !(cosine < limit) | (cosine < -1);
+    }
+
+    // getDistance of extract_walls: mean distance of the corners (lx, ly), (rx, ry) from the line y = k x + b0
+    inline float lineDistance(float k, float b0, float scale, float lx, float ly, float rx, float ry) {
+        float b1 = ly - k * lx;
+        float b2 = ry - k * rx;
+        return (abs(b0 - b1) / scale + abs(b0 - b2) / scale) / 2;
+    }
+
+    inline float distance2D(float dx, float dy) {
+        return sqrt(dx * dx + dy * dy);
+    }
+
+    // cell of a coordinate, clamped so the cell ranges of far away corners cannot overflow
+    inline int64_t cellOf(float coordinate, float cellSize) {
+        double cell = floor((double) coordinate / cellSize);
+        const double limit = 1e15;
+        return (int64_t) (cell < -limit ? -limit : cell > limit ? limit : cell);
+    }
+
+    struct GridCorner {
+        int64_t cellX, cellY;
+        float x, y;
+        size_t plane;
+        bool operator<(const GridCorner &other) const {
+            return cellX != other.cellX ? cellX < other.cellX : cellY < other.cellY;
+        }
+    };
+
+    // a plane whose corner box bounds the planes it joins as a target: finite corners, a horizontal, finite normal
+    // across the top edge and a wall line crossesWithin rounds little on, or never passes on as along x or y.
+    // Nearly flat or steep lines round their perpendicular foot far along the line, such planes are tested against
+    // every plane
+    inline bool isIndexable(const KKRecons::PlaneSet &set, size_t i) {
+        const float corners[4] = {set.leftX[i], set.leftY[i], set.rightX[i], set.rightY[i]};
+        for (int c = 0; c < 4; ++c) {
+            if (!std::isfinite(corners[c])) return false;
+        }
+        if (set.normalZ[i] != 0 || !(set.normalLength[i] > 0) || !std::isfinite(set.normalLength[i])) return false;
+        // the angle between normals bounds the one between wall lines as getNormal() stands on the top edge
+        double dx = (double) set.rightX[i] - set.leftX[i], dy = (double) set.rightY[i] - set.leftY[i];
+        double across = fabs(set.normalX[i] * dx + set.normalY[i] * dy);
+        if (!(across <= 1e-7 * set.normalLength[i] * sqrt(dx * dx + dy * dy))) return false;
+        float k = fabs(set.slope[i]);
+        if (!std::isfinite(k) || k == 0) return true;
+        return k >= 1e-4f && k <= 1e4f && std::isfinite(set.intercept[i]) && std::isfinite(set.lineScale[i]);
+    }
+
+    // an indexable plane that is also bounded as the member joined through, with a line the distance test is
+    // finite for. A line x = const passes every distance and looks up every plane
+    inline bool isBoundedSource(const KKRecons::PlaneSet &set, size_t i) {
+        return std::isfinite(set.slope[i]) && std::isfinite(set.intercept[i]) && std::isfinite(set.lineScale[i]);
+    }
+
+    // heading of the normal seen from above, in degrees within [0, 360)
+    inline double headingOf(const KKRecons::PlaneSet &set, size_t i) {
+        double heading = atan2(set.normalY[i], set.normalX[i]) * 180 / M_PI;
+        return heading < 0 ? heading + 360 : heading;
+    }
+
+    /** the planes that can join a group through a member. Two joined planes are at most maxDegrees apart, so their
+     *  headings are too, up to a half turn. The corners of the one lie within 2 maxDistance of the wall line of the
+     *  other, and a left top corner has its perpendicular foot on the other wall: that puts the corner boxes of the
+     *  two within 2 maxDistance / cos(maxDegrees) of each other. The indexable planes are sorted by heading bucket and
+     *  by the grid cells their corner box covers, a member looks up the buckets around its heading and the cells
+     *  around its box, widened by far more than the rounding of the pair tests. */
+    class CandidateIndex {
+    public:
+        CandidateIndex(const KKRecons::PlaneSet &set, float maxDegrees, float maxDistance);
+        // a superset of the planes that pass the pair tests with source, source itself possibly among them
+        void candidates(size_t source, vector<size_t> &result);
+
+    private:
+        struct Entry {
+            int64_t bucket, cellX, cellY;
+            size_t plane;
+            bool operator<(const Entry &other) const {
+                if (bucket != other.bucket) return bucket < other.bucket;
+                return cellX != other.cellX ? cellX < other.cellX : cellY < other.cellY;
+            }
+        };
+        int64_t bucketOf(double heading) const;
+
+        const KKRecons::PlaneSet &set;
+        bool isPruning;
+        double degrees, bucketWidth;
+        int64_t buckets;
+        float cellSize, bound;
+        // widening of the corner box of a plane for the rounding of the pair tests
+        vector<float> margin;
+        vector<char> isIndexed, isSource;
+        // planes tested against every source
+        vector<size_t> unindexed;
+        vector<Entry> entries;
+        // source + 1 of the last lookup a plane was collected for
+        vector<size_t> stamp;
+        vector<int64_t> searched;
+    };
+
+    CandidateIndex::CandidateIndex(const KKRecons::PlaneSet &set, float maxDegrees, float maxDistance)
+            : set(set), isPruning(false), degrees(fabs(maxDegrees)), bucketWidth(360), buckets(1), cellSize(1),
+              bound(0) {
+        size_t n = set.size();
+        isIndexed.assign(n, 0);
+        isSource.assign(n, 0);
+        stamp.assign(n, 0);
+        // a right angle bounds nothing, cos(maxDegrees) = cos(-maxDegrees) limits both the same
+        if (!(degrees < 89) || !std::isfinite(maxDistance)) return;
+        double distanceBound = 2 * max(maxDistance, 0.0f) / cos(degrees / 180 * M_PI);
+        bound = (float) (1.01 * distanceBound);
+        margin.assign(n, 0);
+        double extents = 0;
+        size_t indexed = 0;
+        for (size_t i = 0; i < n; ++i) {
+            if (!isIndexable(set, i)) {
+                unindexed.push_back(i);
+                continue;
+            }
+            isIndexed[i] = 1;
+            isSource[i] = isBoundedSource(set, i);
+            // the pair tests round by a few float steps of the coordinates around the plane, times the slope or
+            // its inverse for the foot of a perpendicular on its line. Lines along x or y never find that foot
+            double k = fabs(set.slope[i]), rounding = 4;
+            if (std::isfinite(k) && k > 0) rounding = (1 + k) * (1 + 1 / k);
+            float coordinate = max(max(fabs(set.leftX[i]), fabs(set.leftY[i])),
+                                   max(fabs(set.rightX[i]), fabs(set.rightY[i])));
+            margin[i] = (float) (2e-6 * rounding * (1 + coordinate + distanceBound));
+            if (!std::isfinite(margin[i])) {
+                isIndexed[i] = isSource[i] = 0;
+                unindexed.push_back(i);
+                continue;
+            }
+            extents += max(fabs(set.leftX[i] - set.rightX[i]), fabs(set.leftY[i] - set.rightY[i])) + margin[i];
+            ++indexed;
+        }
+        isPruning = true;
+        cellSize = max(bound, indexed > 0 ? (float) (extents / indexed) : 0.0f);
+        if (!(cellSize > 0)) cellSize = 1;
+        // coordinates near the float range, nothing to prune
+        if (!std::isfinite(bound) || !std::isfinite(cellSize)) {
+            isPruning = false;
+            return;
+        }
+        bucketWidth = max(degrees, 1.0);
+        buckets = max((int64_t) (360 / bucketWidth), (int64_t) 1);
+        bucketWidth = 360.0 / buckets;
+        // a plane takes the cells of its corner box widened by its margin, a member looks around its own box
+        // widened by the bound and its margin
+        for (size_t i = 0; i < n; ++i) {
+            if (!isIndexed[i]) continue;
+            int64_t bucket = bucketOf(headingOf(set, i));
+            int64_t lowX = cellOf(min(set.leftX[i], set.rightX[i]) - margin[i], cellSize);
+            int64_t highX = cellOf(max(set.leftX[i], set.rightX[i]) + margin[i], cellSize);
+            int64_t lowY = cellOf(min(set.leftY[i], set.rightY[i]) - margin[i], cellSize);
+            int64_t highY = cellOf(max(set.leftY[i], set.rightY[i]) + margin[i], cellSize);
+            // a wall far longer than the others would fill many cells, it is tested against every plane instead
+            if (highX - lowX >= 1024 || highY - lowY >= 1024 || (highX - lowX + 1) * (highY - lowY + 1) > 1024) {
+                isIndexed[i] = isSource[i] = 0;
+                unindexed.push_back(i);
+                continue;
+            }
+            for (int64_t cellX = lowX; cellX <= highX; ++cellX) {
+                for (int64_t cellY = lowY; cellY <= highY; ++cellY) {
+                    Entry entry = {bucket, cellX, cellY, i};
+                    entries.push_back(entry);
+                }
+            }
+        }
+        sort(entries.begin(), entries.end());
+    }
+
+    int64_t CandidateIndex::bucketOf(double heading) const {
+        int64_t bucket = (int64_t) floor(heading / bucketWidth) % buckets;
+        return bucket < 0 ? bucket + buckets : bucket;
+    }
+
+    void CandidateIndex::candidates(size_t source, vector<size_t> &result) {
+        result.clear();
+        if (!isPruning || !isSource[source]) {
+            for (size_t i = 0; i < set.size(); ++i) result.push_back(i);
+            return;
+        }
+        // the headings within the angle, and those half a turn away for normals pointing the other way
+        searched.clear();
+        const double heading = headingOf(set, source), slack = 0.01;
+        const double centers[2] = {heading, heading + 180};
+        for (int c = 0; c < 2; ++c) {
+            int64_t low = (int64_t) floor((centers[c] - degrees - slack) / bucketWidth);
+            int64_t high = (int64_t) floor((centers[c] + degrees + slack) / bucketWidth);
+            for (int64_t b = low; b <= high && b - low < buckets; ++b) {
+                searched.push_back(bucketOf(b * bucketWidth + bucketWidth / 2));
+            }
+        }
+        sort(searched.begin(), searched.end());
+        searched.erase(unique(searched.begin(), searched.end()), searched.end());
+
+        const float reach = bound + margin[source];
+        const float lowX = min(set.leftX[source], set.rightX[source]) - reach;
+        const float highX = max(set.leftX[source], set.rightX[source]) + reach;
+        const float lowY = min(set.leftY[source], set.rightY[source]) - reach;
+        const float highY = max(set.leftY[source], set.rightY[source]) + reach;
+        const int64_t lowCellY = cellOf(lowY, cellSize), highCellY = cellOf(highY, cellSize);
+        const int64_t highCellX = cellOf(highX, cellSize);
+        for (size_t b = 0; b < searched.size(); ++b) {
+            for (int64_t cellX = cellOf(lowX, cellSize); cellX <= highCellX; ++cellX) {
+                Entry low = {searched[b], cellX, lowCellY, 0}, high = {searched[b], cellX, highCellY, 0};
+                auto end = upper_bound(entries.begin(), entries.end(), high);
+                for (auto entry = lower_bound(entries.begin(), entries.end(), low); entry != end; ++entry) {
+                    if (stamp[entry->plane] == source + 1) continue;
+                    stamp[entry->plane] = source + 1;
+                    result.push_back(entry->plane);
+                }
+            }
+        }
+        result.insert(result.end(), unindexed.begin(), unindexed.end());
+    }
+
+    // the pair tests of the grouping, source a member and target a plane that is not grouped yet
+    inline bool joins(const KKRecons::PlaneSet &set, size_t source, size_t target, double limit, float maxDistance) {
+        if (!normalWithin(set.normalX[source], set.normalY[source], set.normalZ[source], set.normalLength[source],
+                          set.normalX[target], set.normalY[target], set.normalZ[target], set.normalLength[target],
+                          limit)) {
+            return false;
+        }
+        float distance = lineDistance(set.slope[source], set.intercept[source], set.lineScale[source],
+                                      set.leftX[target], set.leftY[target], set.rightX[target], set.rightY[target]);
+        if (distance > maxDistance) return false;
+        return crossesWithin(set.slope[source], set.intercept[source], set.leftX[source], set.leftY[source],
+                             set.rightX[source], set.rightY[source], set.leftX[target], set.leftY[target]) ||
+               crossesWithin(set.slope[target], set.intercept[target], set.leftX[target], set.leftY[target],
+                             set.rightX[target], set.rightY[target], set.leftX[source], set.leftY[source]);
+    }
+}
+
+void KKRecons::PlaneSet::assign(const vector<Plane> &planes) {
+    size_t n = planes.size();
+    normalX.resize(n); normalY.resize(n); normalZ.resize(n); normalLength.resize(n);
+    leftX.resize(n); leftY.resize(n); rightX.resize(n); rightY.resize(n);
+    slope.resize(n); intercept.resize(n); lineScale.resize(n);
+    group.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+        const Plane &plane = planes[i];
+        Eigen::Vector3d normal = plane.getNormal();
+        normalX[i] = normal[0];
+        normalY[i] = normal[1];
+        normalZ[i] = normal[2];
+        normalLength[i] = normal.norm();
+        leftX[i] = plane.leftUp().x;
+        leftY[i] = plane.leftUp().y;
+        rightX[i] = plane.rightUp().x;
+        rightY[i] = plane.rightUp().y;
+        // the same float expressions getDistance and isOverlap evaluated per pair
+        slope[i] = (leftY[i] - rightY[i]) / (leftX[i] - rightX[i]);
+        intercept[i] = leftY[i] - slope[i] * leftX[i];
+        lineScale[i] = sqrt(slope[i] * slope[i] + 1);
+        group[i] = plane.group_index;
+    }
+}
+
+// the kernels read through local pointers, a char store could alias the members of the vectors and keep the loops
+// from being vectorized. The file is built without errno, which the vector square root cannot set
+void KKRecons::PlaneSet::nearCorners(size_t source, float distance, vector<char> &isNear) const {
+    size_t n = size();
+    isNear.resize(n);
+    const float *lx = leftX.data(), *ly = leftY.data(), *rx = rightX.data(), *ry = rightY.data();
+    const float sLeftX = lx[source], sLeftY = ly[source], sRightX = rx[source], sRightY = ry[source];
+    char *result = isNear.data();
+    for (size_t i = 0; i < n; ++i) {
+        result[i] = (distance2D(sLeftX - lx[i], sLeftY - ly[i]) <= distance) |
+                    (distance2D(sLeftX - rx[i], sLeftY - ry[i]) <= distance) |
+                    (distance2D(sRightX - lx[i], sRightY - ly[i]) <= distance) |
+                    (distance2D(sRightX - rx[i], sRightY - ry[i]) <= distance);
+    }
+    result[source] = 0;
+}
+
+void KKRecons::PlaneSet::anyNearCorners(float distance, vector<char> &hasNear) const {
+    size_t n = size();
+    hasNear.assign(n, 0);
+    // any cell size finds every near corner, as the cells searched cover the distance around a corner;
+    // it only decides how many corners are tested
+    const float cellSize = distance > 0 ? distance : 1;
+    vector<GridCorner> corners;
+    corners.reserve(2 * n);
+    for (size_t i = 0; i < n; ++i) {
+        const float xs[2] = {leftX[i], rightX[i]}, ys[2] = {leftY[i], rightY[i]};
+        for (int c = 0; c < 2; ++c) {
+            // a corner that is not finite is never within the distance of another
+            if (!std::isfinite(xs[c]) || !std::isfinite(ys[c])) continue;
+            GridCorner corner = {cellOf(xs[c], cellSize), cellOf(ys[c], cellSize), xs[c], ys[c], i};
+            corners.push_back(corner);
+        }
+    }
+    sort(corners.begin(), corners.end());
+    for (size_t k = 0; k < corners.size(); ++k) {
+        const GridCorner &corner = corners[k];
+        if (hasNear[corner.plane]) continue;
+        // the distance widened by a few float steps, a pair the rounded test accepts lies within it
+        float reachX = distance + (fabs(corner.x) + distance) * 1e-6f;
+        float reachY = distance + (fabs(corner.y) + distance) * 1e-6f;
+        int64_t lowY = cellOf(corner.y - reachY, cellSize), highY = cellOf(corner.y + reachY, cellSize);
+        int64_t highX = cellOf(corner.x + reachX, cellSize);
+        for (int64_t cellX = cellOf(corner.x - reachX, cellSize); cellX <= highX; ++cellX) {
+            GridCorner low = {cellX, lowY, 0, 0, 0}, high = {cellX, highY, 0, 0, 0};
+            auto end = upper_bound(corners.begin(), corners.end(), high);
+            for (auto other = lower_bound(corners.begin(), corners.end(), low); other != end; ++other) {
+                if (other->plane == corner.plane) continue;
+                if (distance2D(corner.x - other->x, corner.y - other->y) <= distance) {
+                    hasNear[corner.plane] = 1;
+                    hasNear[other->plane] = 1;
+                }
+            }
+        }
+    }
+}
+
+void KKRecons::PlaneSet::normalsWithin(size_t source, float maxDegrees, vector<char> &isWithin) const {
+    size_t n = size();
+    isWithin.resize(n);
+    // acos is decreasing, so angle <= maxDegrees is cosine >= cos(maxDegrees)
+    const double limit = cos(maxDegrees / 180.0 * M_PI);
+    const double *nx = normalX.data(), *ny = normalY.data(), *nz = normalZ.data(), *length = normalLength.data();
+    const double x = nx[source], y = ny[source], z = nz[source], sourceLength = length[source];
+    char *result = isWithin.data();
+    for (size_t i = 0; i < n; ++i) {
+        result[i] = normalWithin(x, y, z, sourceLength, nx[i], ny[i], nz[i], length[i], limit);
+    }
+}
+
+void KKRecons::PlaneSet::lineDistances(size_t source, vector<float> &distances) const {
+    size_t n = size();
+    distances.resize(n);
+    const float *lx = leftX.data(), *ly = leftY.data(), *rx = rightX.data(), *ry = rightY.data();
+    const float k = slope[source], b0 = intercept[source], scale = lineScale[source];
+    float *result = distances.data();
+    for (size_t i = 0; i < n; ++i) {
+        result[i] = lineDistance(k, b0, scale, lx[i], ly[i], rx[i], ry[i]);
+    }
+}
+
+void KKRecons::PlaneSet::overlaps(size_t source, vector<char> &isOverlap) const {
+    size_t n = size();
+    isOverlap.resize(n);
+    const float *px = leftX.data(), *py = leftY.data();
+    const float k0 = slope[source], b0 = intercept[source];
+    const float lx = leftX[source], ly = leftY[source], rx = rightX[source], ry = rightY[source];
+    char *result = isOverlap.data();
+    for (size_t i = 0; i < n; ++i) {
+        result[i] = crossesWithin(k0, b0, lx, ly, rx, ry, px[i], py[i]);
+    }
+}
+
+void KKRecons::PlaneSet::overlappedBy(size_t target, vector<char> &isOverlap) const {
+    size_t n = size();
+    isOverlap.resize(n);
+    const float *k0 = slope.data(), *b0 = intercept.data();
+    const float *lx = leftX.data(), *ly = leftY.data(), *rx = rightX.data(), *ry = rightY.data();
+    const float px = lx[target], py = ly[target];
+    char *result = isOverlap.data();
+    for (size_t i = 0; i < n; ++i) {
+        result[i] = crossesWithin(k0[i], b0[i], lx[i], ly[i], rx[i], ry[i], px, py);
+    }
+}
+
+int KKRecons::PlaneSet::groupPlanes(float maxDegrees, float maxDistance) {
+    const double limit = cos(maxDegrees / 180.0 * M_PI);
+    CandidateIndex index(*this, maxDegrees, maxDistance);
+    vector<size_t> candidates, stack;
+    int groups = 0;
+    for (size_t s = 0; s < size(); ++s) {
+        if (group[s] != -1) continue;
+        group[s] = groups;
+        stack.push_back(s);
+        // a plane joins through any member, so the group is the same whatever order the members are taken in
+        while (!stack.empty()) {
+            size_t member = stack.back();
+            stack.pop_back();
+            index.candidates(member, candidates);
+            for (size_t c = 0; c < candidates.size(); ++c) {
+                size_t t = candidates[c];
+                if (group[t] != -1 || !joins(*this, member, t, limit, maxDistance)) continue;
+                group[t] = groups;
+                stack.push_back(t);
+            }
+        }
+        ++groups;
+    }
+    return groups;
+}
@@ -0,0 +1,291 @@
+#include <cstring>
+#include <cstdlib>
+#include <cstdint>
+#include <cmath>
+#include <vector>
+#include <string>
+#include <PointLoader.h>
+#include <MappedFile.h>
+#include <Parallel.h>
+
+using namespace std;
+
+namespace {
+    const int maxReportedLines = 10;
+    const double exactPow10[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+    inline bool isBlank(char c) {
+        return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\v' || c == '\f';
+    }
+
+    inline bool isDigit(char c) {
+        return c >= '0' && c <= '9';
+    }
+
+    // move pos to the start of the next line, so each line belongs to the range holding its first char
+    const char* alignToLine(const char* data, const char* pos, const char* end) {
+        if (pos == data || pos >= end || pos[-1] == '\n') return pos;
+        const void* nl = memchr(pos, '\n', end - pos);
+        return nl ? static_cast<const char*>(nl) + 1 : end;
+    }
+
+    template<typename Func>
+    void forEachLine(const char* begin, const char* end, Func func) {
+        while (begin < end) {
+            const char* nl = static_cast<const char*>(memchr(begin, '\n', end - begin));
+            const char* lineEnd = nl ? nl : end;
+            func(begin, lineEnd);
+            begin = nl ? nl + 1 : end;
+        }
+    }
+
+    enum RecordType {
+        Record_Point,
+        Record_Normal,
+        Record_None,
+    };
+
+    // every line of a txt file is a point, only "v" and "vn" lines of an obj file matter
+    RecordType recordType(KKRecons::AsciiFormat format, const char* begin, const char* end) {
+        if (format != KKRecons::Ascii_ObjVertex) return Record_Point;
+        while (begin < end && isBlank(*begin)) begin++;
+        if (end - begin < 2 || begin[0] != 'v') return Record_None;
+        if (isBlank(begin[1])) return Record_Point;
+        if (begin[1] == 'n' && end - begin > 2 && isBlank(begin[2])) return Record_Normal;
+        return Record_None;
+    }
+
+    // read the whitespace separated numbers following the "v"/"vn" tag
+    bool parseObjRecord(const char* begin, const char* end, float* values) {
+        while (begin < end && isBlank(*begin)) begin++;
+        while (begin < end && !isBlank(*begin)) begin++; // skip the tag
+        for (int i = 0; i < 3; ++i) {
+            while (begin < end && isBlank(*begin)) begin++;
+            const char* tokenEnd = begin;
+            while (tokenEnd < end && !isBlank(*tokenEnd)) tokenEnd++;
+            if (begin == tokenEnd || !KKRecons::parseFloat(begin, tokenEnd, values[i])) return false;
+            begin = tokenEnd;
+        }
+        return true;
+    }
+
+    // parse the point record [begin, end) into p, which is left as it is if the record can not be parsed
+    template<typename PointType>
+    bool parsePoint(KKRecons::AsciiFormat format, const char* begin, const char* end, PointType &p) {
+        float values[7];
+        if (format == KKRecons::Ascii_ObjVertex) {
+            if (!parseObjRecord(begin, end, values)) return false;
+        }
+        else if (!KKRecons::parseFloatFields(begin, end, format == KKRecons::Ascii_CommaXYZARGB ? ',' : ' ', values, 7)) {
+            return false;
+        }
+        p.x = values[0]; p.y = values[1]; p.z = values[2];
+        if (format != KKRecons::Ascii_ObjVertex) {
+            p.a = format == KKRecons::Ascii_SpaceXYZARGB ? values[3] / 2 : values[3]; // the scanner doubles it
+            p.r = values[4]; p.g = values[5]; p.b = values[6];
+        }
+        return true;
+    }
+
+    template<typename PointType>
+    inline void setNormal(PointType &, const float*) {}
+
+    inline void setNormal(pcl::PointXYZRGBNormal &p, const float* n) {
+        p.normal_x = n[0]; p.normal_y = n[1]; p.normal_z = n[2];
+    }
+
+    struct RangeResult {
+        size_t numPoints = 0;
+        size_t numNormals = 0;
+        size_t numBadLines = 0;
+        vector<string> badLines;
+    };
+}
+
+bool KKRecons::parseFloat(const char* begin, const char* end, float &value) {
+    const char* p = begin;
+    while (p < end && isBlank(*p)) p++;
+    bool isNegative = false;
+    if (p < end && (*p == '-' || *p == '+')) isNegative = *p++ == '-';
+    uint64_t mantissa = 0;
+    int exponent = 0, numDigits = 0, numSignificant = 0;
+    for (; p < end && isDigit(*p); ++p, ++numDigits) {
+        if (numSignificant < 19) {
+            mantissa = mantissa * 10 + (*p - '0');
+            if (mantissa != 0) numSignificant++;
+        }
+        else exponent++;
+    }
+    if (p < end && *p == '.') {
+        for (++p; p < end && isDigit(*p); ++p, ++numDigits) {
+            if (numSignificant < 19) {
+                mantissa = mantissa * 10 + (*p - '0');
+                if (mantissa != 0) numSignificant++;
+                exponent--;
+            }
+        }
+    }
+    if (numDigits == 0) {
+        // not a plain decimal number (nan, inf, hex ...), let strtof decide on a bounded copy
+        char buffer[64];
+        size_t length = min<size_t>(end - begin, sizeof(buffer) - 1);
+        memcpy(buffer, begin, length);
+        buffer[length] = '\0';
+        char* parsedEnd = nullptr;
+        value = strtof(buffer, &parsedEnd);
+        return parsedEnd != buffer;
+    }
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        const char* q = p + 1;
+        bool isNegativeExp = false;
+        if (q < end && (*q == '-' || *q == '+')) isNegativeExp = *q++ == '-';
+        if (q < end && isDigit(*q)) {
+            int e = 0;
+            for (; q < end && isDigit(*q); ++q) if (e < 10000) e = e * 10 + (*q - '0');
+            exponent += isNegativeExp ? -e : e;
+        }
+    }
+    double result = static_cast<double>(mantissa);
+    if (mantissa != 0 && exponent != 0) {
+        if (exponent > 0 && exponent <= 22) result *= exactPow10[exponent];
+        else if (exponent < 0 && exponent >= -22) result /= exactPow10[-exponent];
+        else result *= pow(10.0, exponent);
+    }
+    value = static_cast<float>(isNegative ? -result : result);
+    return true;
+}
+
+bool KKRecons::parseFloatFields(const char* begin, const char* end, char delimiter, float* values, int count) {
+    int n = 0;
+    const char* p = begin;
+    while (p < end) {
+        const char* fieldEnd = static_cast<const char*>(memchr(p, delimiter, end - p));
+        if (!fieldEnd) fieldEnd = end;
+        if (n == count || !parseFloat(p, fieldEnd, values[n])) return false;
+        n++;
+        p = fieldEnd == end ? end : fieldEnd + 1;
+    }
+    return n == count;
+}
+
+template<typename PointType>
+long KKRecons::loadAsciiPoints(const string &path, AsciiFormat format, pcl::PointCloud<PointType> &cloud, int threads) {
+    MappedFile file;
+    if (!file.open(path)) return -1;
+    const char* data = file.data();
+    const char* dataEnd = data + file.size();
+
+    // cut the file into one range per thread on line boundaries
+    size_t numRanges = static_cast<size_t>(resolveThreads(threads));
+    vector<const char*> bounds(numRanges + 1, dataEnd);
+    bounds[0] = data;
+    for (size_t i = 1; i < numRanges; ++i) {
+        bounds[i] = alignToLine(data, data + file.size() / numRanges * i, dataEnd);
+        if (bounds[i] < bounds[i - 1]) bounds[i] = bounds[i - 1];
+    }
+
+    // pass 1: count the records of each range to know where it writes
+    vector<RangeResult> results(numRanges);
+    parallelFor(numRanges, threads, [&](size_t begin, size_t end, size_t) {
+        for (size_t r = begin; r < end; ++r) {
+            forEachLine(bounds[r], bounds[r + 1], [&](const char* lineBegin, const char* lineEnd) {
+                RecordType type = recordType(format, lineBegin, lineEnd);
+                if (type == Record_Point) results[r].numPoints++;
+                else if (type == Record_Normal) results[r].numNormals++;
+            });
+        }
+    });
+    vector<size_t> pointOffsets(numRanges + 1, 0), normalOffsets(numRanges + 1, 0);
+    for (size_t r = 0; r < numRanges; ++r) {
+        pointOffsets[r + 1] = pointOffsets[r] + results[r].numPoints;
+        normalOffsets[r + 1] = normalOffsets[r] + results[r].numNormals;
+    }
+    cloud.points.resize(pointOffsets[numRanges]);
+    vector<char> isValid(pointOffsets[numRanges], 1);
+    vector<float> normals(normalOffsets[numRanges] * 3, 0);
+
+    // pass 2: parse each range straight into its slice of the cloud
+    parallelFor(numRanges, threads, [&](size_t begin, size_t end, size_t) {
+        for (size_t r = begin; r < end; ++r) {
+            RangeResult &result = results[r];
+            size_t pointIndex = pointOffsets[r], normalIndex = normalOffsets[r];
+            forEachLine(bounds[r], bounds[r + 1], [&](const char* lineBegin, const char* lineEnd) {
+                RecordType type = recordType(format, lineBegin, lineEnd);
+                if (type == Record_None) return;
+                if (type == Record_Normal) {
+                    float values[3];
+                    if (parseObjRecord(lineBegin, lineEnd, values)) memcpy(&normals[3 * normalIndex], values, 3 * sizeof(float));
+                    normalIndex++;
+                    return;
+                }
+                if (!parsePoint(format, lineBegin, lineEnd, cloud.points[pointIndex++])) {
+                    isValid[pointIndex - 1] = 0;
+                    result.numBadLines++;
+                    if (result.badLines.size() < maxReportedLines) result.badLines.push_back(string(lineBegin, lineEnd));
+                }
+            });
+        }
+    });
+
+    // normals of an obj file only make sense when they pair up with the vertices
+    if (format == Ascii_ObjVertex && normalOffsets[numRanges] == pointOffsets[numRanges]) {
+        for (size_t i = 0; i < cloud.points.size(); ++i) setNormal(cloud.points[i], &normals[3 * i]);
+    }
+
+    size_t numBadLines = 0;
+    int numReported = 0;
+    for (auto &result : results) {
+        numBadLines += result.numBadLines;
+        for (auto &line : result.badLines) {
+            if (numReported++ < maxReportedLines) PCL_WARN("%s IMPORT FAILIURE\n", line.c_str());
+        }
+    }
+    if (numBadLines > 0) {
+        size_t kept = 0;
+        for (size_t i = 0; i < cloud.points.size(); ++i) {
+            if (isValid[i]) cloud.points[kept++] = cloud.points[i];
+        }
+        cloud.points.resize(kept);
+        PCL_WARN("%zu lines of %s can not be imported\n", numBadLines, path.c_str());
+    }
+    cloud.width = static_cast<uint32_t>(cloud.points.size());
+    cloud.height = 1;
+    cloud.is_dense = true;
+    return static_cast<long>(numBadLines);
+}
+
+template long KKRecons::loadAsciiPoints<pcl::PointXYZRGB>(const string&, AsciiFormat, pcl::PointCloud<pcl::PointXYZRGB>&, int);
+template long KKRecons::loadAsciiPoints<pcl::PointXYZRGBNormal>(const string&, AsciiFormat, pcl::PointCloud<pcl::PointXYZRGBNormal>&, int);
+
+bool KKRecons::AsciiChunkReader::open(const string &path, AsciiFormat format) {
+    if (!file.open(path)) return false;
+    this->format = format;
+    cursor = file.data();
+    numDroppedLines = 0;
+    return true;
+}
+
+template<typename PointType>
+bool KKRecons::AsciiChunkReader::next(pcl::PointCloud<PointType> &cloud, size_t maxPoints) {
+    cloud.points.clear();
+    const char* end = file.data() + file.size();
+    while (cursor < end && cloud.points.size() < maxPoints) {
+        const char* nl = static_cast<const char*>(memchr(cursor, '\n', end - cursor));
+        const char* lineEnd = nl ? nl : end;
+        if (recordType(format, cursor, lineEnd) == Record_Point) {
+            PointType p;
+            if (parsePoint(format, cursor, lineEnd, p)) cloud.points.push_back(p);
+            else if (numDroppedLines++ < maxReportedLines) PCL_WARN("%s IMPORT FAILIURE\n", string(cursor, lineEnd).c_str());
+        }
+        cursor = nl ? nl + 1 : end;
+    }
+    file.release(static_cast<size_t>(cursor - file.data()));
+    cloud.width = static_cast<uint32_t>(cloud.points.size());
+    cloud.height = 1;
+    cloud.is_dense = true;
+    return !cloud.points.empty();
+}
+
+template bool KKRecons::AsciiChunkReader::next<pcl::PointXYZRGB>(pcl::PointCloud<pcl::PointXYZRGB>&, size_t);
+template bool KKRecons::AsciiChunkReader::next<pcl::PointXYZRGBNormal>(pcl::PointCloud<pcl::PointXYZRGBNormal>&, size_t);
@@ -0,0 +1,75 @@
+#include <Eigen/Core>
+#include <pcl/common/geometry.h>
+#include <QuadRaster.h>
+#include <Parallel.h>
+
+using namespace std;
+
+template<typename PointType>
+void KKRecons::QuadRaster<PointType>::addLine(const PointType &pt1, const PointType &pt2, int pointPitch,
+                                              int32_t color, bool withEnd) {
+    int numPoints = pcl::geometry::distance(pt1, pt2) * pointPitch;
+    Line line;
+    line.x = pt2.x;
+    line.y = pt2.y;
+    line.z = pt2.z;
+    line.stepX = (pt1.x - pt2.x) / numPoints;
+    line.stepY = (pt1.y - pt2.y) / numPoints;
+    line.stepZ = (pt1.z - pt2.z) / numPoints;
+    line.count = numPoints < 0 ? 0 : (size_t) numPoints + (withEnd ? 1 : 0);
+    line.offset = total;
+    line.color = color;
+    lines.push_back(line);
+    total += line.count;
+}
+
+template<typename PointType>
+void KKRecons::QuadRaster<PointType>::addQuad(const PointType &a1, const PointType &a2, const PointType &b1,
+                                              const PointType &b2, float pointPitch, int32_t color) {
+    int num1 = (pcl::geometry::distance(a1, a2) * pointPitch);
+    int num2 = (pcl::geometry::distance(b1, b2) * pointPitch);
+    int num = num1 < num2 ? num1 : num2;
+    Eigen::Vector3f start1(a1.x, a1.y, a1.z), end1(a2.x, a2.y, a2.z);
+    Eigen::Vector3f start2(b1.x, b1.y, b1.z), end2(b2.x, b2.y, b2.z);
+    Eigen::Vector3f stepLine1 = (-start1 + end1) / num;
+    Eigen::Vector3f stepLine2 = (-start2 + end2) / num;
+    lines.reserve(lines.size() + (num > 0 ? num : 0));
+    for (size_t i = 0; i < num; i++) {
+        PointType p1, p2;
+        p1.x = start1[0] + i * stepLine1[0];
+        p1.y = start1[1] + i * stepLine1[1];
+        p1.z = start1[2] + i * stepLine1[2];
+        p2.x = start2[0] + i * stepLine2[0];
+        p2.y = start2[1] + i * stepLine2[1];
+        p2.z = start2[2] + i * stepLine2[2];
+        addLine(p1, p2, pointPitch, color, true);
+    }
+}
+
+template<typename PointType>
+void KKRecons::QuadRaster<PointType>::rasterize(pcl::PointCloud<PointType> &output) {
+    size_t offset = output.points.size();
+    output.points.resize(offset + total);
+    PointType *points = output.points.data() + offset;
+    const Line *queued = lines.data();
+    parallelFor(lines.size(), total < minParallelItems ? 1 : threads, [&](size_t begin, size_t end, size_t) {
+        PointType p;
+        for (size_t l = begin; l < end; ++l) {
+            const Line &line = queued[l];
+            PointType *out = points + line.offset;
+            p.rgba = line.color;
+            for (size_t i = 0; i < line.count; ++i) {
+                p.x = line.x + i * line.stepX;
+                p.y = line.y + i * line.stepY;
+                p.z = line.z + i * line.stepZ;
+                out[i] = p;
+            }
+        }
+    });
+    output.width = output.points.size();
+    output.height = 1;
+    lines.clear();
+    total = 0;
+}
+
+template class KKRecons::QuadRaster<pcl::PointXYZRGBNormal>;
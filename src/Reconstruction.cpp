@@ -1,6 +1,9 @@
 #include <iostream>
 #include <vector>
 #include <stdexcept>
+#include <limits>
+#include <algorithm>
+#include <atomic>
 #include <math.h>
 #include <pcl/point_types.h>
 #include <pcl/io/pcd_io.h>
@@ -9,7 +12,6 @@
 #include <pcl/search/search.h>
 #include <pcl/search/kdtree.h>
 #include <pcl/features/normal_3d.h>
-#include <pcl/segmentation/region_growing.h>
 #include <pcl/segmentation/sac_segmentation.h>
 #include <pcl/common/pca.h>
 #include <pcl/common/common.h>
@@ -21,6 +23,15 @@
 #include <pcl/filters/passthrough.h>
 #include "Reconstruction.h"
 #include "Plane.h"
+#include "PointLoader.h"
+#include "CloudCache.h"
+#include "TiledVoxelFilter.h"
+#include "VoxelGridEngine.h"
+#include "Parallel.h"
+#include "RegionGrowingEngine.h"
+#include "NormalEstimation.h"
+#include "PlaneRansac.h"
+#include "EfficientRansac.h"
 using namespace std;
 
 
@@ -30,29 +41,108 @@ void Reconstruction::debugPrint(stringstream& ss) {
 }
 
 
-std::vector<std::string> split(const std::string& s, char delimiter)
-{
-	std::vector<std::string> tokens;
-	std::string token;
-	std::istringstream tokenStream(s);
-	while (std::getline(tokenStream, token, delimiter))
-	{
-		tokens.push_back(token);
+Reconstruction::Reconstruction(const string filePath, bool isUseCache) {
+	stringstream ss;
+	ss << "Input File: " << filePath;
+	debugPrint(ss);
+	PointCloudT::Ptr tmp(new PointCloudT);
+	this->pointCloud = tmp;
+	this->sourcePath = filePath;
+	this->isUseCache = isUseCache;
+	KKRecons::PerfStage stage(&this->perfReport, "load");
+	if (this->isUseCache && loadCache(0)) {
+		stage.setItemsOut(this->pointCloud->size());
+		this->perfReport.setInputPoints(this->pointCloud->size());
+		stage.addCounter("cacheHits", 1);
+		return;
 	}
-	return tokens;
-}
 
+	loadPointCloud(filePath);
+	ss.str("");
+	ss << "Loaded points: " << this->pointCloud->size();
+	debugPrint(ss);
+	stage.setItemsOut(this->pointCloud->size());
+	this->perfReport.setInputPoints(this->pointCloud->size());
+	if (this->isUseCache) {
+		PointT p = this->pointCloud->points.empty() ? PointT() : this->pointCloud->points[0];
+		bool hasNormals = p.normal_x != 0 || p.normal_y != 0 || p.normal_z != 0;
+		saveCache(0, hasNormals ? -1 : 0, hasNormals);
+	}
+}
 
-Reconstruction::Reconstruction(const string filePath) {
+Reconstruction::Reconstruction(const string filePath, float leafSize, int outOfCoreMemoryMB, bool isUseCache) {
+	if (leafSize == -1) {
+		throw invalid_argument("please set leafSize parameters");
+	}
+	if (outOfCoreMemoryMB <= 0) {
+		throw invalid_argument("OutOfCoreMemoryMB must be positive to load into tiles");
+	}
 	stringstream ss;
 	ss << "Input File: " << filePath;
 	debugPrint(ss);
 	PointCloudT::Ptr tmp(new PointCloudT);
 	this->pointCloud = tmp;
+	this->sourcePath = filePath;
+	this->isUseCache = isUseCache;
+	this->currentVoxelEngine = KKRecons::VoxelEngine_Tiled;
+	KKRecons::PerfStage loadStage(&this->perfReport, "load");
+	if (this->isUseCache && loadCache(leafSize)) {
+		loadStage.setItemsOut(this->pointCloud->size());
+		loadStage.addCounter("cacheHits", 1);
+		return;
+	}
+
+	KKRecons::TiledVoxelFilter<PointT> tiled(leafSize, static_cast<size_t>(outOfCoreMemoryMB) << 20, "./");
+	string fileType = checkFileType(filePath);
+	size_t numPoints = 0;
+	if (fileType == "txt") {
+		const size_t chunkPoints = 1 << 20;
+		KKRecons::AsciiChunkReader reader;
+		if (!reader.open(filePath, KKRecons::Ascii_CommaXYZARGB)) {
+			throw invalid_argument("Cannot load the input file, please check and try again!\n");
+		}
+		PointCloudT chunk;
+		while (reader.next(chunk, chunkPoints)) {
+			numPoints += chunk.size();
+			for (auto &p : chunk.points) tiled.add(p);
+		}
+	}
+	else {
+		loadPointCloud(filePath);
+		numPoints = this->pointCloud->size();
+		tiled.add(*this->pointCloud);
+		PointCloudT().swap(*this->pointCloud);
+	}
+	ss.str("");
+	ss << "Loaded points: " << numPoints << " into " << tiled.numTiles() << " tiles";
+	debugPrint(ss);
+	loadStage.setItemsOut(numPoints);
+	loadStage.finish();
+	this->perfReport.setInputPoints(numPoints);
+
+	ss.str("");
+	ss << "\nDownSampling...: leafSize-> " << leafSize << "\n";
+	ss << "Before-> " << numPoints;
+	KKRecons::PerfStage stage(&this->perfReport, "downSampling", numPoints);
+	stage.addCounter("tiles", tiled.numTiles());
+	tiled.filter(*this->pointCloud);
+	this->currentLeafSize = leafSize;
+	ss << "  After-> " << this->pointCloud->points.size();
+	debugPrint(ss);
+	stage.setItemsOut(this->pointCloud->size());
+}
 
+string Reconstruction::checkFileType(const string& filePath)
+{
 	string fileType = filePath.substr(filePath.length() - 3);
 	if (!(fileType == "ply" || fileType == "obj" || fileType == "txt" || fileType == "pcd"))
 		throw invalid_argument("the file type is not allowed");
+	return fileType;
+}
+
+void Reconstruction::loadPointCloud(const string& filePath)
+{
+	string fileType = checkFileType(filePath);
 	if (fileType == "ply") {
 		if (pcl::io::loadPLYFile <PointT>(filePath, *this->pointCloud) == -1) { // the file doesnt exist
 			PCL_ERROR("The file does not exist\n");
@@ -60,7 +150,7 @@ Reconstruction::Reconstruction(const string filePath) {
 		}
 	}
 	else if (fileType == "obj") {
-		if (pcl::io::loadOBJFile <PointT>(filePath, *this->pointCloud) == -1) { // the file doesnt exist
+		if (KKRecons::loadAsciiPoints(filePath, KKRecons::Ascii_ObjVertex, *this->pointCloud) == -1) { // the file doesnt exist
 			throw invalid_argument("Cannot load the input file, please check and try again!\n");
 		}
 	}
@@ -70,75 +160,86 @@ Reconstruction::Reconstruction(const string filePath) {
 		}
 	}
 	else if (fileType == "txt") {
-		std::ifstream file(filePath);
-		std::string str;
-		while (std::getline(file, str))
-		{
-			vector<string> tokens;
-			tokens = split(str, ',');
-			if (tokens.size() != 7) {
-				PCL_WARN("@s IMPORT FAILIURE\n", str);
-				continue;
-			}
-			PointT p;
-			p.x = stof(tokens[0]); p.y = stof(tokens[1]); p.z = stof(tokens[2]);
-			p.r = stof(tokens[4]); p.g = stof(tokens[5]); p.b = stof(tokens[6]);
-			p.a = stof(tokens[3]);
-			this->pointCloud->push_back(p);
+		if (KKRecons::loadAsciiPoints(filePath, KKRecons::Ascii_CommaXYZARGB, *this->pointCloud) == -1) { // the file doesnt exist
+			throw invalid_argument("Cannot load the input file, please check and try again!\n");
 		}
 	}
 }
 
-void Reconstruction::downSampling(float leafSize)
+void Reconstruction::downSampling(float leafSize, int outOfCoreMemoryMB)
 {
 	if (leafSize == -1) {
 		throw invalid_argument("please set leafSize parameters");
 	}
+	if (outOfCoreMemoryMB < 0) {
+		throw invalid_argument("OutOfCoreMemoryMB must not be negative");
+	}
+	this->knnGraph.clear(); // the neighbours belong to the cloud before downsampling
+	this->clusters.clear(); // so do the cluster indices
+	this->clusterLabels.clear();
 	stringstream ss;
 	ss << "\nDownSampling...: leafSize-> " << leafSize << "\n";
 
 	ss << "Before-> " << this->pointCloud->points.size();
+	KKRecons::PerfStage stage(&this->perfReport, "downSampling", this->pointCloud->size());
+	this->currentVoxelEngine = outOfCoreMemoryMB > 0 ? KKRecons::VoxelEngine_Tiled : KKRecons::VoxelEngine_InMemory;
+	if (this->isUseCache && loadCache(leafSize)) {
+		ss << "  After-> " << this->pointCloud->points.size() << " (cached)";
+		debugPrint(ss);
+		stage.setItemsOut(this->pointCloud->size());
+		stage.addCounter("cacheHits", 1);
+		return;
+	}
 
-	pcl::VoxelGrid<PointT> sor;
-	sor.setInputCloud(this->pointCloud);
-
-	sor.setLeafSize(leafSize, leafSize, leafSize); //5mm“_ŒQ‚É‘Î‚µ‚ÄA0.01‚¾‚ÆA’l‚ª¬‚³‚·‚¬‚é‚Æ‚¢‚¤ƒGƒ‰[‚ªo‚é
-	sor.filter(*this->pointCloud);
+	if (outOfCoreMemoryMB > 0) {
+		// spill the cloud into tiles and release it before the tiles are voxelized one by one
+		KKRecons::TiledVoxelFilter<PointT> tiled(leafSize, static_cast<size_t>(outOfCoreMemoryMB) << 20, "./");
+		tiled.add(*this->pointCloud);
+		PointCloudT().swap(*this->pointCloud);
+		ss << "  Tiles-> " << tiled.numTiles();
+		stage.addCounter("tiles", tiled.numTiles());
+		tiled.filter(*this->pointCloud);
+	}
+	else {
+		KKRecons::voxelGridFilter(*this->pointCloud, leafSize, *this->pointCloud, this->numberOfThreads);
+	}
+	this->currentLeafSize = leafSize;
+	this->isCacheLoaded = false;
 	ss << "  After-> " << this->pointCloud->points.size();
 	debugPrint(ss);
+	stage.setItemsOut(this->pointCloud->size());
 }
 
 void Reconstruction::applyRegionGrow(int NumberOfNeighbours, int SmoothnessThreshold, int CurvatureThreshold, int MinSizeOfCluster, int KSearch)
 {
 	stringstream ss;
-	ss << "\nRegionGrowing..." << "\n" << "MaxClusterSize: 100000 - NumberOfNeighbours: " << NumberOfNeighbours << "\n";
+	ss << "\nRegionGrowing..." << "\n" << "NumberOfNeighbours: " << NumberOfNeighbours << "\n";
 	ss << "SmoothnessThreshold: " << SmoothnessThreshold << "\n" << "CurvatureThreshold: " << CurvatureThreshold << "\n";
 	ss << "Min size of Cluster: " << MinSizeOfCluster << "\n";
 	std::vector <pcl::PointIndices> clustersIndices;
-	pcl::search::Search<PointT>::Ptr tree = boost::shared_ptr<pcl::search::Search<PointT> >(new pcl::search::KdTree<PointT>);
-	pcl::PointCloud <pcl::Normal>::Ptr normals_all(new pcl::PointCloud <pcl::Normal>);
-	calculateNormals(normals_all, KSearch);
-	pcl::RegionGrowing<PointT, pcl::Normal> reg;
-	reg.setMinClusterSize(0);
-	reg.setMaxClusterSize(100000);
-	reg.setSearchMethod(tree);
-	reg.setNumberOfNeighbours(NumberOfNeighbours);
-	reg.setInputCloud(this->pointCloud);
-	reg.setInputNormals(normals_all);
-	reg.setSmoothnessThreshold(static_cast<float>(SmoothnessThreshold / 180.0 * M_PI));
-	reg.setCurvatureThreshold(CurvatureThreshold);
-	reg.extract(clustersIndices);
-	pcl::PointCloud<pcl::PointXYZRGB>::Ptr colored_cloud = reg.getColoredCloud();
+	KKRecons::PerfStage stage(&this->perfReport, "regionGrow", this->pointCloud->size());
+	// one neighbour query per point serves both the normals and the region growing
+	buildKnnGraph(max(KSearch, NumberOfNeighbours));
+	calculateNormals(KSearch);
+	size_t queuePushes = 0;
+	KKRecons::growRegions(*this->pointCloud, this->knnGraph, NumberOfNeighbours,
+		static_cast<float>(SmoothnessThreshold / 180.0 * M_PI), CurvatureThreshold, clustersIndices, this->numberOfThreads,
+		&queuePushes);
+	stage.addCounter("queuePushes", queuePushes);
+	stage.addCounter("regions", clustersIndices.size());
+	// clusters keep indices into pointCloud, no point is copied
+	this->clusterLabels.assign(this->pointCloud->size(), -1);
 	for (size_t i = 0; i < clustersIndices.size(); ++i) {
 		if (clustersIndices[i].indices.size() < MinSizeOfCluster) continue;
-		PointCloudT::Ptr singleCluster(new PointCloudT);
-		for (auto &p : clustersIndices[i].indices) {
-			singleCluster->points.push_back(this->pointCloud->points[p]);
+		for (int p : clustersIndices[i].indices) {
+			this->clusterLabels[p] = static_cast<int>(this->clusters.size());
 		}
-		this->clusters.push_back(singleCluster);
+		this->clusters.push_back(pcl::PointIndices());
+		this->clusters.back().indices.swap(clustersIndices[i].indices);
 	}
 	ss << "num of Clusters: " << this->clusters.size();
 	debugPrint(ss);
+	stage.setItemsOut(this->clusters.size());
 }
 
 void Reconstruction::applyRANSACtoClusters(float RANSAC_DistThreshold, float RANSAC_PlaneVectorThreshold,
@@ -152,49 +253,110 @@ void Reconstruction::applyRANSACtoClusters(float RANSAC_DistThreshold, float RAN
 	if (this->clusters.size() == 0) {
 		throw invalid_argument("Cluster Size == 0!\n");
 	}
-	for (auto &cluster : this->clusters)
-	{
+	KKRecons::PerfStage stage(&this->perfReport, "ransacClusters", this->clusters.size());
+	// largest clusters first, every cluster has its own result slot so ransacPlanes keeps the cluster order
+	vector<size_t> order(this->clusters.size());
+	for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+	stable_sort(order.begin(), order.end(), [&](size_t l, size_t r) {
+		return this->clusters[l].indices.size() > this->clusters[r].indices.size();
+	});
+	vector<Plane> results(this->clusters.size());
+	vector<char> isAccepted(this->clusters.size(), 0);
+	atomic<uint64_t> iterations(0);
+	KKRecons::workStealingFor(order, this->numberOfThreads, [&](size_t c, size_t) {
+		const vector<int> &cluster = this->clusters[c].indices;
 		// mark:  apply ransac
 		pcl::ModelCoefficients::Ptr sacCoefficients(new pcl::ModelCoefficients);
 		pcl::PointIndices::Ptr sacInliers(new pcl::PointIndices);
-		calculateRANSAC_plane(cluster, sacInliers, sacCoefficients, RANSAC_DistThreshold);
+		iterations += calculateRANSAC_plane(cluster, sacInliers, sacCoefficients, RANSAC_DistThreshold, static_cast<uint32_t>(c)); // seeded per cluster
 		double a1, b1, c1, d1;
 		a1 = sacCoefficients->values[0];
 		b1 = sacCoefficients->values[1];
 		c1 = sacCoefficients->values[2];
 		d1 = sacCoefficients->values[3];
 		Eigen::Vector4d abcd(a1, b1, c1, d1);
-		PointCloudT::Ptr extracted_cloud(new PointCloudT);
-		pcl::ExtractIndices<PointT> extract;
-		extract.setInputCloud(cluster);
-		extract.setIndices(sacInliers);
-		extract.setNegative(false);
-		extract.filter(*extracted_cloud);
 		// control the num of RANSAC plane
 		float threshold = RANSAC_PlaneVectorThreshold;
-		if (sacInliers->indices.size() / cluster->size() >= RANSAC_MinInliers) {
-			Plane plane(extracted_cloud, abcd);
+		if (static_cast<double>(sacInliers->indices.size()) / cluster.size() >= RANSAC_MinInliers) {
+			// the inliers are positions in the cluster, the plane views them in pointCloud
+			vector<int> planeIndices(sacInliers->indices.size());
+			for (size_t i = 0; i < planeIndices.size(); ++i) planeIndices[i] = cluster[sacInliers->indices[i]];
+			Plane plane(this->pointCloud, std::move(planeIndices), abcd);
 			if (threshold > abs(a1) && threshold > abs(b1)) {
 				plane.orientation = PlaneOrientation::Horizontal;
 			}
 			else {
 				plane.orientation = PlaneOrientation::Vertical;
 			}
-			this->ransacPlanes.push_back(plane);
+			results[c] = plane;
+			isAccepted[c] = 1;
 		}
+	});
+	size_t numAccepted = 0;
+	for (size_t c = 0; c < results.size(); ++c) {
+		if (!isAccepted[c]) continue;
+		this->ransacPlanes.push_back(results[c]);
+		++numAccepted;
 	}
+	stage.addCounter("ransacIterations", iterations);
+	stage.setItemsOut(numAccepted);
 
 	ss << "\nInput nums of clusters: " << this->clusters.size();
 	ss << "\nOutput nums of ransac clusters: " << this->ransacPlanes.size();
 	debugPrint(ss);
 }
 
+void Reconstruction::applyEfficientRANSAC(float RANSAC_DistThreshold, float RANSAC_PlaneVectorThreshold,
+	float NormalThreshold, float ClusterEpsilon, int MinSupport, int KSearch) {
+	stringstream ss;
+	ss << "\nApplying efficient RANSAC to the whole cloud...";
+	ss << "\nRANSAC DistThreshold: " << RANSAC_DistThreshold;
+	ss << "\nRANSAC PlaneVectorThreshold: " << RANSAC_PlaneVectorThreshold;
+	ss << "\nNormalThreshold: " << NormalThreshold << "\nClusterEpsilon: " << ClusterEpsilon;
+	ss << "\nMin support: " << MinSupport;
+
+	KKRecons::PerfStage stage(&this->perfReport, "efficientRansac", this->pointCloud->size());
+	buildKnnGraph(KSearch);
+	calculateNormals(KSearch);
+	KKRecons::EfficientRansacParameters parameters;
+	parameters.distanceThreshold = RANSAC_DistThreshold;
+	parameters.normalThreshold = static_cast<float>(cos(NormalThreshold / 180.0 * M_PI));
+	parameters.clusterEpsilon = ClusterEpsilon;
+	parameters.minSupport = MinSupport;
+	vector<KKRecons::DetectedPlane> detected;
+	size_t candidates = 0;
+	KKRecons::detectPlanes(*this->pointCloud, parameters, detected, this->numberOfThreads, 12345, &candidates);
+	stage.addCounter("candidatesDrawn", candidates);
+	for (auto &d : detected) {
+		Eigen::Vector4d abcd = d.coefficients.cast<double>();
+		Plane plane(this->pointCloud, std::move(d.indices), abcd);
+		// same orientation rule as applyRANSACtoClusters
+		if (RANSAC_PlaneVectorThreshold > abs(abcd[0]) && RANSAC_PlaneVectorThreshold > abs(abcd[1])) {
+			plane.orientation = PlaneOrientation::Horizontal;
+		}
+		else {
+			plane.orientation = PlaneOrientation::Vertical;
+		}
+		this->ransacPlanes.push_back(plane);
+	}
+
+	ss << "\nOutput nums of ransac planes: " << this->ransacPlanes.size();
+	debugPrint(ss);
+	stage.setItemsOut(detected.size());
+}
+
 
 void Reconstruction::outputFile(const string path)
 {
 	pcl::io::savePLYFile(path, *this->pointCloud);
 }
 
+PointCloudT::Ptr Reconstruction::clusterCloud(size_t cluster) const {
+	PointCloudT::Ptr cloud(new PointCloudT);
+	pcl::copyPointCloud(*this->pointCloud, this->clusters.at(cluster).indices, *cloud);
+	return cloud;
+}
+
 void Reconstruction::getPlane(PlaneOrientation ori, vector<Plane>& planes) {
 	if (this->ransacPlanes.size() < 1) {
 		throw invalid_argument("The ransac Planes equals to 0");
@@ -211,50 +373,76 @@ void Reconstruction::getPlane(PlaneOrientation ori, vector<Plane>& planes) {
 
 // private methods
 
-void Reconstruction::calculateNormals(pcl::PointCloud <pcl::Normal>::Ptr &normals_all, int KSearch)
+void Reconstruction::calculateNormals(int KSearch)
 {
-
 	//1-1. generating the normal for each point
-	if (this->pointCloud->points[0].normal_x == 0 &&
-		this->pointCloud->points[0].normal_y == 0 &&
-		this->pointCloud->points[0].normal_z == 0) {
+	bool hasNormals = this->pointCloud->points[0].normal_x != 0 ||
+		this->pointCloud->points[0].normal_y != 0 ||
+		this->pointCloud->points[0].normal_z != 0;
+	if (this->normalsKSearch > 0) hasNormals = this->normalsKSearch == KSearch; // normals of a cache
+	bool isComputed = !hasNormals;
+	if (!hasNormals) {
 		stringstream ss;
 		ss << "The point you input doesn't contain normals, calculating normals...";
 		debugPrint(ss);
-		pcl::search::Search<PointT>::Ptr tree = boost::shared_ptr<pcl::search::Search<PointT> >(new pcl::search::KdTree<PointT>);
-		pcl::NormalEstimation<PointT, pcl::Normal> normal_estimator;
-		normal_estimator.setSearchMethod(tree);
-		normal_estimator.setInputCloud(this->pointCloud);
-		normal_estimator.setKSearch(KSearch);
-		normal_estimator.compute(*normals_all);
-
-		for (size_t i = 0; i < normals_all->points.size(); ++i)
-		{
-			this->pointCloud->points[i].normal_x = normals_all->points[i].normal_x;
-			this->pointCloud->points[i].normal_y = normals_all->points[i].normal_y;
-			this->pointCloud->points[i].normal_z = normals_all->points[i].normal_z;
-		}
+		KKRecons::PerfStage stage(&this->perfReport, "normals", this->pointCloud->size());
+		// same result as pcl::NormalEstimation, but the neighbours come from the kNN graph
+		buildKnnGraph(KSearch);
+		KKRecons::estimateNormals(*this->pointCloud, this->knnGraph, KSearch, this->numberOfThreads);
+		this->normalsKSearch = KSearch;
+		stage.setItemsOut(this->pointCloud->size());
 	}
-	else
-	{
-		for (size_t i = 0; i < this->pointCloud->points.size(); ++i)
-		{
-			pcl::Normal normal_temp;
-			normal_temp.normal_x = this->pointCloud->points[i].normal_x;
-			normal_temp.normal_y = this->pointCloud->points[i].normal_y;
-			normal_temp.normal_z = this->pointCloud->points[i].normal_z;
-			normals_all->push_back(normal_temp);
-		}
+	else if (this->normalsKSearch == 0) {
+		this->normalsKSearch = -1;
+	}
+	// the downsampled cloud with its normals is what a second run needs
+	if (this->isUseCache && this->currentLeafSize != 0 && (isComputed || !this->isCacheLoaded)) {
+		saveCache(this->currentLeafSize, this->normalsKSearch, true);
+	}
+}
+
+void Reconstruction::buildKnnGraph(int k)
+{
+	if (this->knnGraph.size() == this->pointCloud->size() && this->knnGraph.k() >= k) return;
+	KKRecons::PerfStage stage(&this->perfReport, "knnGraph", this->pointCloud->size());
+	this->knnGraph.build(this->pointCloud, k, this->numberOfThreads);
+	stage.addCounter("knnQueries", this->pointCloud->size());
+	stage.setItemsOut(this->knnGraph.size());
+}
+
+bool Reconstruction::loadCache(float leafSize)
+{
+	KKRecons::CloudCache cache;
+	string path = KKRecons::CloudCache::cachePath(this->sourcePath, leafSize, this->currentVoxelEngine);
+	if (!cache.open(path) || !cache.isFresh(this->sourcePath, leafSize, this->currentVoxelEngine)) return false;
+	cache.toPointCloud(*this->pointCloud);
+	this->currentLeafSize = leafSize;
+	this->normalsKSearch = cache.header().hasNormals ? cache.header().kSearch : 0;
+	this->isCacheLoaded = true;
+	stringstream ss;
+	ss << "Loaded cache: " << path << " points: " << cache.size();
+	debugPrint(ss);
+	return true;
+}
+
+void Reconstruction::saveCache(float leafSize, int kSearch, bool hasNormals)
+{
+	string path = KKRecons::CloudCache::cachePath(this->sourcePath, leafSize, this->currentVoxelEngine);
+	if (!KKRecons::CloudCache::write(path, this->sourcePath, *this->pointCloud, leafSize, kSearch, hasNormals,
+		this->numberOfThreads, this->currentVoxelEngine)) {
+		PCL_WARN("Cannot write the cache %s\n", path.c_str());
 	}
 }
 
-void Reconstruction::calculateRANSAC_plane(PointCloudT::Ptr cloud_cluster, pcl::PointIndices::Ptr sacInliers,
-	pcl::ModelCoefficients::Ptr sacCoefficients, double distanceFromRANSACPlane) {
-	pcl::SACSegmentation<PointT> seg;
-	seg.setOptimizeCoefficients(true);
-	seg.setModelType(pcl::SACMODEL_PLANE);
-	seg.setMethodType(pcl::SAC_RANSAC);
-	seg.setDistanceThreshold(distanceFromRANSACPlane);
-	seg.setInputCloud(cloud_cluster);
-	seg.segment(*sacInliers, *sacCoefficients);
+/** @return hypotheses scored
+ */
+int Reconstruction::calculateRANSAC_plane(const vector<int>& cluster, pcl::PointIndices::Ptr sacInliers,
+	pcl::ModelCoefficients::Ptr sacCoefficients, double distanceFromRANSACPlane, uint32_t seed) {
+	KKRecons::PlaneRansac ransac;
+	ransac.setInputCloud(*this->pointCloud, cluster);
+	ransac.setDistanceThreshold(static_cast<float>(distanceFromRANSACPlane));
+	Eigen::Vector4f coefficients = Eigen::Vector4f::Zero(); // stays zero, with no inliers, if no plane is found
+	ransac.segment(sacInliers->indices, coefficients, seed);
+	sacCoefficients->values.assign(coefficients.data(), coefficients.data() + 4);
+	return ransac.iterations();
 }
\ No newline at end of file
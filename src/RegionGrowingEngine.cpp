@@ -0,0 +1,194 @@
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+#include <atomic>
+#include <stdexcept>
+#include <limits>
+#include <algorithm>
+#include <RegionGrowingEngine.h>
+#include <Parallel.h>
+
+using namespace std;
+
+namespace {
+    const int histogramBins = 4096;
+
+    // lock-free union-find, a root is always linked below the smaller root so every region ends at its smallest root
+    class AtomicUnionFind {
+    public:
+        explicit AtomicUnionFind(size_t n) : parent(n) {
+            for (auto &p : parent) p.store(-1, memory_order_relaxed);
+        }
+        int get(int x) const { return parent[x].load(memory_order_relaxed); }
+        void set(int x, int p) { parent[x].store(p, memory_order_relaxed); }
+        int find(int x) {
+            while (true) {
+                int p = parent[x].load(memory_order_acquire);
+                if (p == x) return x;
+                int gp = parent[p].load(memory_order_acquire);
+                if (p != gp) parent[x].compare_exchange_weak(p, gp, memory_order_acq_rel); // path halving
+                x = gp;
+            }
+        }
+        void unite(int a, int b) {
+            while (true) {
+                a = find(a);
+                b = find(b);
+                if (a == b) return;
+                if (a < b) swap(a, b);
+                int expected = a;
+                if (parent[a].compare_exchange_strong(expected, b, memory_order_acq_rel)) return;
+            }
+        }
+    private:
+        vector<atomic<int> > parent;
+    };
+
+    // one slab of roughly equal point count per thread, cut along x from a histogram
+    template<typename PointType>
+    void slabPartition(const pcl::PointCloud<PointType> &cloud, int numSlabs, vector<int> &slabOf) {
+        float minX = numeric_limits<float>::max(), maxX = -numeric_limits<float>::max();
+        for (auto &p : cloud.points) {
+            if (!std::isfinite(p.x)) continue;
+            minX = min(minX, p.x);
+            maxX = max(maxX, p.x);
+        }
+        slabOf.assign(cloud.size(), 0);
+        if (numSlabs <= 1 || !(maxX > minX)) return;
+        float scale = histogramBins / (maxX - minX);
+        auto binOf = [&](float x) { return min(histogramBins - 1, static_cast<int>((x - minX) * scale)); };
+        vector<size_t> histogram(histogramBins, 0);
+        for (auto &p : cloud.points) {
+            if (std::isfinite(p.x)) histogram[binOf(p.x)]++;
+        }
+        vector<int> slabOfBin(histogramBins);
+        size_t perSlab = cloud.size() / numSlabs + 1, filled = 0;
+        for (int b = 0; b < histogramBins; ++b) {
+            slabOfBin[b] = min(numSlabs - 1, static_cast<int>(filled / perSlab));
+            filled += histogram[b];
+        }
+        for (size_t i = 0; i < cloud.size(); ++i) {
+            if (std::isfinite(cloud.points[i].x)) slabOf[i] = slabOfBin[binOf(cloud.points[i].x)];
+        }
+    }
+}
+
+template<typename PointType>
+void KKRecons::growRegions(const pcl::PointCloud<PointType> &cloud, const KnnGraph<PointType> &graph, int numberOfNeighbours,
+                           float smoothnessThreshold, float curvatureThreshold, vector<pcl::PointIndices> &clusters,
+                           int threads, size_t *queuePushes) {
+    clusters.clear();
+    if (queuePushes) *queuePushes = 0;
+    size_t n = cloud.size();
+    if (n == 0) return;
+    if (graph.size() != n) throw invalid_argument("growRegions: the kNN graph does not belong to the cloud");
+    const auto &points = cloud.points;
+    const float cosThreshold = cosf(smoothnessThreshold);
+    const size_t k = static_cast<size_t>(max(0, numberOfNeighbours));
+    // the tests of pcl::RegionGrowing::validatePoint, written so that NaN normals pass the same way
+    auto isSeed = [&](int i) { return !(points[i].curvature > curvatureThreshold); };
+    auto isSmooth = [&](int a, int b) {
+        float dot = fabsf(points[a].normal_x * points[b].normal_x + points[a].normal_y * points[b].normal_y +
+                          points[a].normal_z * points[b].normal_z);
+        return !(dot < cosThreshold);
+    };
+    auto neighbourEnd = [&](int i) { return graph.begin(i) + min(graph.count(i), k); };
+
+    int numSlabs = resolveThreads(threads);
+    vector<int> slabOf;
+    slabPartition(cloud, numSlabs, slabOf);
+    vector<vector<int> > slabPoints(numSlabs);
+    for (size_t i = 0; i < n; ++i) slabPoints[slabOf[i]].push_back(static_cast<int>(i));
+
+    // 1. grow regions of seed points inside each slab, edges leaving the slab are kept for the merge
+    AtomicUnionFind regions(n);
+    vector<vector<pair<int, int> > > borderEdges(numSlabs);
+    vector<size_t> slabPushes(numSlabs, 0);
+    parallelFor(numSlabs, numSlabs, [&](size_t begin, size_t end, size_t) {
+        vector<int> queue;
+        for (size_t slab = begin; slab < end; ++slab) {
+            for (int start : slabPoints[slab]) {
+                if (regions.get(start) != -1 || !isSeed(start)) continue;
+                regions.set(start, start);
+                queue.assign(1, start);
+                for (size_t q = 0; q < queue.size(); ++q) {
+                    int current = queue[q];
+                    for (const int* nb = graph.begin(current); nb != neighbourEnd(current); ++nb) {
+                        int neighbour = *nb;
+                        if (neighbour == current || !isSeed(neighbour) || !isSmooth(current, neighbour)) continue;
+                        if (slabOf[neighbour] != static_cast<int>(slab)) {
+                            borderEdges[slab].push_back(make_pair(current, neighbour));
+                            continue;
+                        }
+                        if (regions.get(neighbour) != -1) { // kNN lists are not symmetric, so the edge may not
+                            regions.unite(current, neighbour); // lead back: merge here whichever seed came first
+                            continue;
+                        }
+                        regions.set(neighbour, start);
+                        queue.push_back(neighbour);
+                    }
+                }
+                slabPushes[slab] += queue.size();
+            }
+        }
+    });
+    if (queuePushes) {
+        for (size_t pushes : slabPushes) *queuePushes += pushes;
+    }
+
+    // 2. stitch the slabs together
+    parallelFor(numSlabs, numSlabs, [&](size_t begin, size_t end, size_t) {
+        for (size_t slab = begin; slab < end; ++slab) {
+            for (auto &edge : borderEdges[slab]) regions.unite(edge.first, edge.second);
+        }
+    });
+
+    // 3. a point which may not grow joins the nearest seed which reaches it, as pcl::RegionGrowing adds any point
+    //    in the neighbours of a seed, or stays alone. Keys are (squared distance, seed), the float bits of a
+    //    non-negative distance order like the distance
+    const uint64_t unreached = numeric_limits<uint64_t>::max();
+    vector<atomic<uint64_t> > nearestSeed(n);
+    for (auto &key : nearestSeed) key.store(unreached, memory_order_relaxed);
+    parallelFor(n, threads, [&](size_t begin, size_t end, size_t) {
+        for (size_t i = begin; i < end; ++i) {
+            int seed = static_cast<int>(i);
+            if (!isSeed(seed)) continue;
+            for (const int* nb = graph.begin(seed); nb != neighbourEnd(seed); ++nb) {
+                int point = *nb;
+                if (regions.get(point) != -1 || !isSmooth(seed, point)) continue;
+                float distance = (points[seed].getVector3fMap() - points[point].getVector3fMap()).squaredNorm();
+                uint32_t bits;
+                memcpy(&bits, &distance, sizeof(bits));
+                uint64_t key = (static_cast<uint64_t>(bits) << 32) | static_cast<uint32_t>(seed);
+                uint64_t current = nearestSeed[point].load(memory_order_relaxed);
+                while (key < current && !nearestSeed[point].compare_exchange_weak(current, key, memory_order_relaxed)) {}
+            }
+        }
+    });
+    parallelFor(n, threads, [&](size_t begin, size_t end, size_t) {
+        for (size_t i = begin; i < end; ++i) {
+            int point = static_cast<int>(i);
+            if (regions.get(point) != -1) continue;
+            uint64_t key = nearestSeed[i].load(memory_order_relaxed);
+            regions.set(point, key == unreached ? point : static_cast<int>(key & 0xffffffffu));
+        }
+    });
+    vector<int> roots(n);
+    parallelFor(n, threads, [&](size_t begin, size_t end, size_t) {
+        for (size_t i = begin; i < end; ++i) roots[i] = regions.find(static_cast<int>(i));
+    });
+
+    // 4. clusters in the order of their first point
+    vector<int> clusterOfRoot(n, -1);
+    for (size_t i = 0; i < n; ++i) {
+        int &cluster = clusterOfRoot[roots[i]];
+        if (cluster == -1) {
+            cluster = static_cast<int>(clusters.size());
+            clusters.push_back(pcl::PointIndices());
+        }
+        clusters[cluster].indices.push_back(static_cast<int>(i));
+    }
+}
+
+template void KKRecons::growRegions<pcl::PointXYZRGBNormal>(const pcl::PointCloud<pcl::PointXYZRGBNormal>&,
+        const KnnGraph<pcl::PointXYZRGBNormal>&, int, float, float, vector<pcl::PointIndices>&, int, size_t*);
@@ -8,6 +8,12 @@ typedef pcl::PointXYZRGBNormal PointT;
 typedef pcl::PointCloud<PointT> PointCloudT;
 typedef pcl::PointCloud<pcl::PointXYZRGB> PointCloudRGB;
 
+static bool isViewHeadless = false;
+
+void setSimpleViewHeadless(bool isHeadless) {
+	isViewHeadless = isHeadless;
+}
+
 void copyOnlyRgba(PointCloudT::Ptr input, PointCloudRGB::Ptr output) {
 	for (auto &i : input->points) {
 		pcl::PointXYZRGB p;
@@ -20,6 +26,7 @@ void copyOnlyRgba(PointCloudT::Ptr input, PointCloudRGB::Ptr output) {
 }
 
 void simpleView(const string &title, const pcl::PointCloud<pcl::PointXYZRGBNormal>::Ptr &cloud) {
+	if (isViewHeadless) return;
 	boost::shared_ptr<pcl::visualization::PCLVisualizer> viewer(new pcl::visualization::PCLVisualizer(title));
 	pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_noNormal(new pcl::PointCloud<pcl::PointXYZRGB>);
 	copyOnlyRgba(cloud, cloud_noNormal);
@@ -35,11 +42,13 @@ void simpleView(const string &title, const pcl::PointCloud<pcl::PointXYZRGBNorma
 }
 
 void simpleView(const string& title, vector<Plane> &planes) {
+	if (isViewHeadless) return;
 
 	boost::shared_ptr<pcl::visualization::PCLVisualizer> viewer(new pcl::visualization::PCLVisualizer(title));
 	pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_noNormal(new pcl::PointCloud<pcl::PointXYZRGB>);
-	for (auto plane : planes) {
-		PointCloudT::Ptr cloud = plane.pointCloud;
+	for (auto &plane : planes) {
+		PointCloudT::Ptr cloud(new PointCloudT); // a view stays a view, quads are rasterized for the viewer only
+		plane.appendPointsTo(*cloud);
 		copyOnlyRgba(cloud, cloud_noNormal);
 	}
 	viewer->setBackgroundColor(0, 0, 0);
@@ -54,6 +63,7 @@ void simpleView(const string& title, vector<Plane> &planes) {
 }
 
 void simpleView(const string& title, Reconstruction &re) {
+	if (isViewHeadless) return;
 	boost::shared_ptr<pcl::visualization::PCLVisualizer> viewer(new pcl::visualization::PCLVisualizer(title));
 	pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_noNormal(new pcl::PointCloud<pcl::PointXYZRGB>);
 	copyOnlyRgba(re.pointCloud, cloud_noNormal);
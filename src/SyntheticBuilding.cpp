@@ -0,0 +1,250 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <SyntheticBuilding.h>
+#include <Parallel.h>
+
+using namespace std;
+typedef pcl::PointXYZRGBNormal PointT;
+
+namespace {
+    // points drawn from one random stream, the unit the scan is cut in and written by
+    const uint64_t blockSize = 1 << 16;
+
+    enum FileFormat { Format_Ply, Format_Pcd, Format_Txt, Format_Obj, Format_Unknown };
+
+    FileFormat formatOf(const string &path) {
+        size_t dot = path.rfind('.');
+        string extension = dot == string::npos ? "" : path.substr(dot + 1);
+        if (extension == "ply") return Format_Ply;
+        if (extension == "pcd") return Format_Pcd;
+        if (extension == "txt") return Format_Txt;
+        if (extension == "obj") return Format_Obj;
+        return Format_Unknown;
+    }
+
+    // mt19937 and seed_seq are fully specified by the standard, the distributions are not,
+    // so the few used here are spelled out to draw the same scan with every standard library
+    float unit(mt19937 &rng) {
+        return (rng() >> 8) * (1.0f / 16777216.0f); // [0, 1)
+    }
+
+    float gaussian(mt19937 &rng) {
+        float u1 = 1.0f - unit(rng), u2 = unit(rng); // u1 in (0, 1]
+        return sqrt(-2.0f * log(u1)) * cos(6.2831853f * u2);
+    }
+
+    // hole of an opening width x height at offset up from the bottom, centred along a wall of length,
+    // no wider than 80% of the wall
+    Eigen::Vector4f centredHole(float length, float wallHeight, float width, float offset, float height) {
+        width = min(width, 0.8f * length);
+        float s0 = 0.5f * (length - width) / length, t0 = offset / wallHeight;
+        return Eigen::Vector4f(s0, t0, 1 - s0, min(1.0f, (offset + height) / wallHeight));
+    }
+
+    // bytes of the points in the format of the file
+    void encode(FileFormat format, const PointT *points, size_t count, vector<char> &bytes) {
+        bytes.clear();
+        char line[96];
+        for (size_t i = 0; i < count; ++i) {
+            const PointT &p = points[i];
+            int length = 0;
+            if (format == Format_Ply) { // binary_little_endian, as written on the little endian hosts this runs on
+                memcpy(line, &p.x, 12);
+                line[12] = static_cast<char>(p.r);
+                line[13] = static_cast<char>(p.g);
+                line[14] = static_cast<char>(p.b);
+                length = 15;
+            }
+            else if (format == Format_Pcd) {
+                memcpy(line, &p.x, 12);
+                memcpy(line + 12, &p.rgba, 4);
+                length = 16;
+            }
+            else if (format == Format_Txt) {
+                length = snprintf(line, sizeof(line), "%.4f,%.4f,%.4f,255,%u,%u,%u\n", p.x, p.y, p.z,
+                                  static_cast<unsigned>(p.r), static_cast<unsigned>(p.g), static_cast<unsigned>(p.b));
+            }
+            else {
+                length = snprintf(line, sizeof(line), "v %.4f %.4f %.4f\n", p.x, p.y, p.z);
+            }
+            bytes.insert(bytes.end(), line, line + length);
+        }
+    }
+
+    string header(FileFormat format, uint64_t numPoints) {
+        string n = to_string(numPoints);
+        if (format == Format_Ply) {
+            return "ply\nformat binary_little_endian 1.0\nelement vertex " + n + "\nproperty float x\nproperty float y\n"
+                   "property float z\nproperty uchar red\nproperty uchar green\nproperty uchar blue\nend_header\n";
+        }
+        if (format == Format_Pcd) {
+            return "# .PCD v0.7 - Point Cloud Data file format\nVERSION 0.7\nFIELDS x y z rgb\nSIZE 4 4 4 4\n"
+                   "TYPE F F F F\nCOUNT 1 1 1 1\nWIDTH " + n + "\nHEIGHT 1\nVIEWPOINT 0 0 0 1 0 0 0\nPOINTS " + n +
+                   "\nDATA binary\n";
+        }
+        if (format == Format_Obj) return "# synthetic building, " + n + " points\n";
+        return "";
+    }
+}
+
+KKRecons::SyntheticBuilding::SyntheticBuilding(const BuildingSpec &spec) : _spec(spec), numStructure(0) {
+    typedef Eigen::Vector3f V;
+    const float rw = spec.roomWidth, rd = spec.roomDepth, h = spec.height, half = 0.5f * spec.wallThickness;
+    const float width = spec.roomsX * rw, depth = spec.roomsY * rd;
+    const uint32_t floorColor = 0xff8c7b6b, wallColor = 0xffdcdcd2, ceilingColor = 0xfff0f0f0;
+    const vector<Eigen::Vector4f> none;
+
+    addSurface(V(0, 0, 0), V(width, 0, 0), V(0, depth, 0), V(0, 0, 1), floorColor, none);
+    addSurface(V(0, 0, h), V(width, 0, 0), V(0, depth, 0), V(0, 0, -1), ceilingColor, none);
+    // exterior walls, one segment with a window per room, facing in
+    vector<Eigen::Vector4f> windowX(1, centredHole(rw, h, spec.windowWidth, spec.sillHeight, spec.windowHeight));
+    vector<Eigen::Vector4f> windowY(1, centredHole(rd, h, spec.windowWidth, spec.sillHeight, spec.windowHeight));
+    for (int i = 0; i < spec.roomsX; ++i) {
+        addSurface(V(i * rw, 0, 0), V(rw, 0, 0), V(0, 0, h), V(0, 1, 0), wallColor, windowX);
+        addSurface(V(i * rw, depth, 0), V(rw, 0, 0), V(0, 0, h), V(0, -1, 0), wallColor, windowX);
+    }
+    for (int j = 0; j < spec.roomsY; ++j) {
+        addSurface(V(0, j * rd, 0), V(0, rd, 0), V(0, 0, h), V(1, 0, 0), wallColor, windowY);
+        addSurface(V(width, j * rd, 0), V(0, rd, 0), V(0, 0, h), V(-1, 0, 0), wallColor, windowY);
+    }
+    // interior walls, both faces, one door per room
+    vector<Eigen::Vector4f> doorX(1, centredHole(rw, h, spec.doorWidth, 0, spec.doorHeight));
+    vector<Eigen::Vector4f> doorY(1, centredHole(rd, h, spec.doorWidth, 0, spec.doorHeight));
+    for (int i = 1; i < spec.roomsX; ++i) {
+        for (int j = 0; j < spec.roomsY; ++j) {
+            addSurface(V(i * rw - half, j * rd, 0), V(0, rd, 0), V(0, 0, h), V(-1, 0, 0), wallColor, doorY);
+            addSurface(V(i * rw + half, j * rd, 0), V(0, rd, 0), V(0, 0, h), V(1, 0, 0), wallColor, doorY);
+        }
+    }
+    for (int j = 1; j < spec.roomsY; ++j) {
+        for (int i = 0; i < spec.roomsX; ++i) {
+            addSurface(V(i * rw, j * rd - half, 0), V(rw, 0, 0), V(0, 0, h), V(0, -1, 0), wallColor, doorX);
+            addSurface(V(i * rw, j * rd + half, 0), V(rw, 0, 0), V(0, 0, h), V(0, 1, 0), wallColor, doorX);
+        }
+    }
+    numStructure = surfaces.size();
+
+    // furniture, a top and 4 sides per box, 0.3 m off the walls
+    const uint32_t palette[] = {0xff6b4f3a, 0xff3a5f8c, 0xff9a9a9a, 0xff5c8c3a};
+    for (int i = 0; i < spec.roomsX; ++i) {
+        for (int j = 0; j < spec.roomsY; ++j) {
+            seed_seq seq = {spec.seed, 0x0f0f0f0fu, static_cast<uint32_t>(i), static_cast<uint32_t>(j)};
+            mt19937 rng(seq);
+            for (int b = 0; b < spec.boxesPerRoom; ++b) {
+                float w = 0.4f + 1.2f * unit(rng), d = 0.4f + 0.6f * unit(rng), bh = 0.4f + 0.8f * unit(rng);
+                w = min(w, max(0.1f, rw - 0.6f));
+                d = min(d, max(0.1f, rd - 0.6f));
+                float x = i * rw + 0.3f + unit(rng) * max(0.0f, rw - 0.6f - w);
+                float y = j * rd + 0.3f + unit(rng) * max(0.0f, rd - 0.6f - d);
+                uint32_t color = palette[rng() % 4];
+                addSurface(V(x, y, bh), V(w, 0, 0), V(0, d, 0), V(0, 0, 1), color, none);
+                addSurface(V(x, y, 0), V(w, 0, 0), V(0, 0, bh), V(0, -1, 0), color, none);
+                addSurface(V(x, y + d, 0), V(w, 0, 0), V(0, 0, bh), V(0, 1, 0), color, none);
+                addSurface(V(x, y, 0), V(0, d, 0), V(0, 0, bh), V(-1, 0, 0), color, none);
+                addSurface(V(x + w, y, 0), V(0, d, 0), V(0, 0, bh), V(1, 0, 0), color, none);
+            }
+        }
+    }
+}
+
+void KKRecons::SyntheticBuilding::addSurface(const Eigen::Vector3f &origin, const Eigen::Vector3f &u,
+                                             const Eigen::Vector3f &v, const Eigen::Vector3f &normal, uint32_t rgba,
+                                             const vector<Eigen::Vector4f> &holes) {
+    Surface surface;
+    surface.origin = origin;
+    surface.u = u;
+    surface.v = v;
+    surface.normal = normal;
+    surface.rgba = rgba;
+    surface.holes = holes;
+    double open = 1;
+    for (auto &hole : holes) open -= (hole[2] - hole[0]) * (hole[3] - hole[1]);
+    double area = static_cast<double>(u.norm()) * v.norm() * max(0.0, open);
+    surfaces.push_back(surface);
+    cumulativeArea.push_back((cumulativeArea.empty() ? 0 : cumulativeArea.back()) + area);
+}
+
+void KKRecons::SyntheticBuilding::generateBlock(uint64_t block, PointT *out, size_t count) const {
+    seed_seq seq = {_spec.seed, static_cast<uint32_t>(block), static_cast<uint32_t>(block >> 32)};
+    mt19937 rng(seq);
+    const double structureArea = cumulativeArea[numStructure - 1], totalArea = cumulativeArea.back();
+    const bool hasClutter = totalArea > structureArea && _spec.clutter > 0;
+    for (size_t i = 0; i < count; ++i) {
+        bool isClutter = hasClutter && unit(rng) < _spec.clutter;
+        double target = isClutter ? structureArea + unit(rng) * (totalArea - structureArea) : unit(rng) * structureArea;
+        size_t index = upper_bound(cumulativeArea.begin(), cumulativeArea.end(), target) - cumulativeArea.begin();
+        const Surface &surface = surfaces[min(index, isClutter ? surfaces.size() - 1 : numStructure - 1)];
+        float s, t;
+        bool isInHole;
+        do {
+            s = unit(rng);
+            t = unit(rng);
+            isInHole = false;
+            for (auto &hole : surface.holes) {
+                isInHole = isInHole || (s >= hole[0] && s < hole[2] && t >= hole[1] && t < hole[3]);
+            }
+        } while (isInHole);
+        Eigen::Vector3f p = surface.origin + s * surface.u + t * surface.v + (_spec.noise * gaussian(rng)) * surface.normal;
+        PointT &point = out[i];
+        point.x = p[0];
+        point.y = p[1];
+        point.z = p[2];
+        point.normal_x = surface.normal[0];
+        point.normal_y = surface.normal[1];
+        point.normal_z = surface.normal[2];
+        point.curvature = 0;
+        point.rgba = surface.rgba;
+    }
+}
+
+void KKRecons::SyntheticBuilding::generate(uint64_t begin, uint64_t end, PointT *out, int threads) const {
+    if (begin >= end) return;
+    const uint64_t firstBlock = begin / blockSize, numBlocks = (end - 1) / blockSize - firstBlock + 1;
+    parallelFor(numBlocks, threads, [&](size_t blockBegin, size_t blockEnd, size_t) {
+        vector<PointT, Eigen::aligned_allocator<PointT> > edge;
+        for (size_t b = blockBegin; b < blockEnd; ++b) {
+            uint64_t block = firstBlock + b, start = block * blockSize;
+            uint64_t from = max(begin, start), to = min(end, start + blockSize);
+            if (from == start && to == start + blockSize) {
+                generateBlock(block, out + (start - begin), blockSize);
+                continue;
+            }
+            edge.resize(blockSize); // a block cut by the range is drawn from its start, the stream cannot skip ahead
+            generateBlock(block, edge.data(), to - start);
+            copy(edge.begin() + (from - start), edge.begin() + (to - start), out + (from - begin));
+        }
+    });
+}
+
+bool KKRecons::SyntheticBuilding::write(const string &path, int threads) const {
+    FileFormat format = formatOf(path);
+    if (format == Format_Unknown) return false;
+    ofstream file(path.c_str(), ios::binary);
+    if (!file) return false;
+    string head = header(format, _spec.numPoints);
+    file.write(head.data(), head.size());
+
+    // a batch of blocks is drawn and encoded by the threads, then written in order
+    const int numThreads = resolveThreads(threads);
+    const uint64_t numBlocks = (_spec.numPoints + blockSize - 1) / blockSize;
+    const uint64_t batchBlocks = 4 * static_cast<uint64_t>(numThreads);
+    vector<vector<char> > bytes(batchBlocks);
+    for (uint64_t batch = 0; batch < numBlocks && file; batch += batchBlocks) {
+        size_t count = static_cast<size_t>(min(batchBlocks, numBlocks - batch));
+        parallelFor(count, numThreads, [&](size_t blockBegin, size_t blockEnd, size_t) {
+            vector<PointT, Eigen::aligned_allocator<PointT> > points(blockSize);
+            for (size_t b = blockBegin; b < blockEnd; ++b) {
+                uint64_t start = (batch + b) * blockSize;
+                size_t n = static_cast<size_t>(min(blockSize, _spec.numPoints - start));
+                generateBlock(batch + b, points.data(), n);
+                encode(format, points.data(), n, bytes[b]);
+            }
+        });
+        for (size_t b = 0; b < count; ++b) file.write(bytes[b].data(), bytes[b].size());
+    }
+    return static_cast<bool>(file);
+}
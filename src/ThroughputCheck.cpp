@@ -0,0 +1,60 @@
+#include <map>
+#include <yaml-cpp/yaml.h>
+#include <ThroughputCheck.h>
+
+using namespace std;
+
+double KKRecons::stageThroughput(const StageRecord &stage) {
+    size_t items = stage.itemsIn > 0 ? stage.itemsIn : stage.itemsOut;
+    return stage.wallSeconds > 0 ? items / stage.wallSeconds : 0;
+}
+
+vector<KKRecons::StageThroughput> KKRecons::compareThroughput(const vector<StageRecord> &baseline,
+                                                              const vector<StageRecord> &current, double tolerance,
+                                                              double minSeconds) {
+    map<string, vector<const StageRecord *> > byName;
+    for (auto &stage : current) byName[stage.name].push_back(&stage);
+    map<string, size_t> seen;
+    vector<StageThroughput> result;
+    for (auto &stage : baseline) {
+        StageThroughput t;
+        t.name = stage.name;
+        t.baseline = stageThroughput(stage);
+        size_t n = seen[stage.name]++;
+        const vector<const StageRecord *> &matches = byName[stage.name];
+        if (n >= matches.size()) t.isMissing = true;
+        else t.current = stageThroughput(*matches[n]);
+        t.isSkipped = !t.isMissing && (stage.wallSeconds < minSeconds || t.baseline <= 0);
+        t.isRegressed = !t.isMissing && !t.isSkipped && t.current < t.baseline * (1 - tolerance);
+        result.push_back(t);
+    }
+    return result;
+}
+
+bool KKRecons::readPerfReport(const string &path, vector<StageRecord> &stages, size_t *inputPoints) {
+    stages.clear();
+    try {
+        YAML::Node report = YAML::LoadFile(path); // the JSON of writeJson is flow style YAML
+        YAML::Node list = report["stages"];
+        if (!list || !list.IsSequence()) return false;
+        if (inputPoints) *inputPoints = report["inputPoints"] ? report["inputPoints"].as<size_t>() : 0;
+        for (const auto &node : list) {
+            StageRecord stage;
+            stage.name = node["name"].as<string>();
+            stage.wallSeconds = node["wallSeconds"].as<double>();
+            stage.cpuSeconds = node["cpuSeconds"].as<double>();
+            stage.peakRssDeltaKB = node["peakRssDeltaKB"].as<long>();
+            stage.itemsIn = node["itemsIn"].as<size_t>();
+            stage.itemsOut = node["itemsOut"].as<size_t>();
+            for (const auto &counter : node["counters"]) {
+                stage.counters.push_back(make_pair(counter.first.as<string>(), counter.second.as<uint64_t>()));
+            }
+            stages.push_back(stage);
+        }
+    }
+    catch (const YAML::Exception &) {
+        stages.clear();
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,166 @@
+#include <cstdio>
+#include <atomic>
+#include <algorithm>
+#include <stdexcept>
+#include <TiledVoxelFilter.h>
+#include <VoxelAccumulator.h>
+#include <VoxelGridEngine.h>
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace {
+    inline int64_t floorDiv(int64_t a, int64_t b) {
+        int64_t q = a / b;
+        return (a % b != 0 && (a < 0) != (b < 0)) ? q - 1 : q;
+    }
+
+    string uniquePrefix() {
+        static atomic<unsigned long> counter(0);
+#ifndef _WIN32
+        long pid = static_cast<long>(getpid());
+#else
+        long pid = 0;
+#endif
+        return "kktile_" + to_string(pid) + "_" + to_string(counter++);
+    }
+}
+
+template<typename PointType>
+KKRecons::TiledVoxelFilter<PointType>::TiledVoxelFilter(float leafSize, size_t memoryBudget, const string &spillDirectory, int64_t tileVoxels, int threads) {
+    if (leafSize <= 0) throw invalid_argument("TiledVoxelFilter: leafSize should be larger than 0");
+    this->leafSize = leafSize;
+    this->inverseLeaf = 1.0f / leafSize;
+    this->memoryBudget = max<size_t>(memoryBudget, 1 << 20);
+    this->spillDirectory = spillDirectory.empty() ? "./" : spillDirectory;
+    if (this->spillDirectory.back() != '/') this->spillDirectory += '/';
+    this->tileVoxels = max<int64_t>(tileVoxels, 1);
+    this->threads = threads;
+    this->filePrefix = uniquePrefix();
+}
+
+template<typename PointType>
+KKRecons::TiledVoxelFilter<PointType>::~TiledVoxelFilter() {
+    for (auto &tile : this->tiles) {
+        if (tile.second.numSpilled > 0) remove(tile.second.path.c_str());
+    }
+}
+
+template<typename PointType>
+void KKRecons::TiledVoxelFilter<PointType>::add(const PointType &p) {
+    int64_t ijk[3];
+    if (!voxelCoordinates(p, this->inverseLeaf, ijk)) return;
+    TileKey key = {floorDiv(ijk[2], this->tileVoxels), floorDiv(ijk[1], this->tileVoxels), floorDiv(ijk[0], this->tileVoxels)};
+    this->tiles[key].buffer.push_back(p);
+    this->numPoints++;
+    // spill buffers may use half of the budget, the other half is for the tile being voxelized
+    if (++this->numBuffered * sizeof(PointType) > this->memoryBudget / 2) spill();
+}
+
+template<typename PointType>
+void KKRecons::TiledVoxelFilter<PointType>::add(const pcl::PointCloud<PointType> &cloud) {
+    for (auto &p : cloud.points) add(p);
+}
+
+template<typename PointType>
+void KKRecons::TiledVoxelFilter<PointType>::filter(pcl::PointCloud<PointType> &output) {
+    bool isSpilled = false;
+    for (auto &tile : this->tiles) isSpilled |= tile.second.numSpilled > 0;
+    // once anything is on disk, flush the rest too, so only one tile is in memory while voxelizing
+    if (isSpilled) spill();
+    for (auto &tile : this->tiles) {
+        filterTile(tile.first, tile.second, output);
+        if (tile.second.numSpilled > 0) remove(tile.second.path.c_str());
+        tile.second.numSpilled = 0;
+    }
+    this->tiles.clear();
+    this->numBuffered = 0;
+    this->numPoints = 0;
+    output.width = static_cast<uint32_t>(output.points.size());
+    output.height = 1;
+}
+
+template<typename PointType>
+void KKRecons::TiledVoxelFilter<PointType>::spill() {
+    for (auto &tile : this->tiles) spillTile(tile.first, tile.second);
+    this->numBuffered = 0;
+}
+
+template<typename PointType>
+void KKRecons::TiledVoxelFilter<PointType>::spillTile(const TileKey &key, Tile &tile) {
+    if (tile.buffer.empty()) return;
+    if (tile.path.empty()) {
+        tile.path = this->spillDirectory + this->filePrefix + "_" + to_string(key.i) + "_" + to_string(key.j) + "_" + to_string(key.k) + ".bin";
+    }
+    FILE* file = fopen(tile.path.c_str(), tile.numSpilled == 0 ? "wb" : "ab");
+    if (!file) throw runtime_error("TiledVoxelFilter: cannot write the tile file " + tile.path);
+    size_t written = fwrite(tile.buffer.data(), sizeof(PointType), tile.buffer.size(), file);
+    fclose(file);
+    if (written != tile.buffer.size()) throw runtime_error("TiledVoxelFilter: cannot write the tile file " + tile.path);
+    tile.numSpilled += tile.buffer.size();
+    PointVector().swap(tile.buffer);
+}
+
+template<typename PointType>
+template<typename Func>
+void KKRecons::TiledVoxelFilter<PointType>::readTile(Tile &tile, size_t chunk, Func func) {
+    if (tile.numSpilled == 0) return;
+    FILE* file = fopen(tile.path.c_str(), "rb");
+    if (!file) throw runtime_error("TiledVoxelFilter: cannot read the tile file " + tile.path);
+    PointVector points;
+    for (uint64_t begin = 0; begin < tile.numSpilled; begin += chunk) {
+        points.resize(static_cast<size_t>(min<uint64_t>(chunk, tile.numSpilled - begin)));
+        if (fread(points.data(), sizeof(PointType), points.size(), file) != points.size()) {
+            fclose(file);
+            throw runtime_error("TiledVoxelFilter: cannot read the tile file " + tile.path);
+        }
+        func(points);
+    }
+    fclose(file);
+}
+
+template<typename PointType>
+void KKRecons::TiledVoxelFilter<PointType>::filterTile(const TileKey &key, Tile &tile, pcl::PointCloud<PointType> &output) {
+    uint64_t total = tile.numSpilled + tile.buffer.size();
+    // the tile, its voxels and the keys, orders and radix buffers of voxelGridFilter
+    size_t bytesPerPoint = 2 * sizeof(PointType) + 40;
+    size_t chunk = max<size_t>(1, this->memoryBudget / 4 / sizeof(PointType));
+    if (total * bytesPerPoint > this->memoryBudget / 2) {
+        if (this->tileVoxels == 1) {
+            // a single voxel holding more points than the budget, accumulate it while streaming
+            VoxelAccumulator acc;
+            readTile(tile, chunk, [&](const PointVector &points) {
+                for (auto &p : points) acc.add(p);
+            });
+            for (auto &p : tile.buffer) acc.add(p);
+            PointType centroid;
+            acc.get(centroid);
+            output.points.push_back(centroid);
+        }
+        else {
+            // split into 8 sub tiles which share the voxel grid with this tile
+            TiledVoxelFilter<PointType> child(this->leafSize, this->memoryBudget, this->spillDirectory, this->tileVoxels / 2, this->threads);
+            readTile(tile, chunk, [&](const PointVector &points) {
+                for (auto &p : points) child.add(p);
+            });
+            for (auto &p : tile.buffer) child.add(p);
+            PointVector().swap(tile.buffer);
+            child.filter(output);
+        }
+        return;
+    }
+    pcl::PointCloud<PointType> points, voxels;
+    points.points.reserve(total);
+    readTile(tile, chunk, [&](const PointVector &chunkPoints) {
+        points.points.insert(points.points.end(), chunkPoints.begin(), chunkPoints.end());
+    });
+    points.points.insert(points.points.end(), tile.buffer.begin(), tile.buffer.end());
+    PointVector().swap(tile.buffer);
+    voxelGridFilter(points, this->leafSize, voxels, this->threads);
+    output.points.insert(output.points.end(), voxels.points.begin(), voxels.points.end());
+}
+
+template class KKRecons::TiledVoxelFilter<pcl::PointXYZRGB>;
+template class KKRecons::TiledVoxelFilter<pcl::PointXYZRGBNormal>;
@@ -0,0 +1,257 @@
+#include <cmath>
+#include <cfloat>
+#include <cstdint>
+#include <stdexcept>
+#include <algorithm>
+#include <VoxelGridEngine.h>
+#include <VoxelAccumulator.h>
+#include <Parallel.h>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define KK_VOXEL_AVX2
+#endif
+
+using namespace std;
+
+namespace {
+    const int batch = 8;
+    const float maxVoxelCoordinate = 4.0e18f; // |floor(p / leaf)| must stay far within int64
+
+    // floor(p * inverseLeaf) of up to 8 points per axis, and whether each point is finite
+    template<typename PointType>
+    void voxelFloorsScalar(const PointType* points, size_t count, float inverseLeaf, float floors[3][batch], bool isFinite[batch]) {
+        for (size_t n = 0; n < count; ++n) {
+            const PointType &p = points[n];
+            isFinite[n] = std::isfinite(p.x) && std::isfinite(p.y) && std::isfinite(p.z);
+            floors[0][n] = std::floor(p.x * inverseLeaf);
+            floors[1][n] = std::floor(p.y * inverseLeaf);
+            floors[2][n] = std::floor(p.z * inverseLeaf);
+        }
+    }
+
+#ifdef KK_VOXEL_AVX2
+    template<typename PointType>
+    __attribute__((target("avx2")))
+    void voxelFloorsAVX2(const PointType* points, float inverseLeaf, float floors[3][batch], bool isFinite[batch]) {
+        const PointType* p = points;
+        __m256 x = _mm256_set_ps(p[7].x, p[6].x, p[5].x, p[4].x, p[3].x, p[2].x, p[1].x, p[0].x);
+        __m256 y = _mm256_set_ps(p[7].y, p[6].y, p[5].y, p[4].y, p[3].y, p[2].y, p[1].y, p[0].y);
+        __m256 z = _mm256_set_ps(p[7].z, p[6].z, p[5].z, p[4].z, p[3].z, p[2].z, p[1].z, p[0].z);
+        __m256 inv = _mm256_set1_ps(inverseLeaf);
+        __m256 zero = _mm256_setzero_ps();
+        // v - v is 0 only for finite v
+        __m256 finite = _mm256_and_ps(_mm256_cmp_ps(_mm256_sub_ps(x, x), zero, _CMP_EQ_OQ),
+                        _mm256_and_ps(_mm256_cmp_ps(_mm256_sub_ps(y, y), zero, _CMP_EQ_OQ),
+                                      _mm256_cmp_ps(_mm256_sub_ps(z, z), zero, _CMP_EQ_OQ)));
+        _mm256_storeu_ps(floors[0], _mm256_floor_ps(_mm256_mul_ps(x, inv)));
+        _mm256_storeu_ps(floors[1], _mm256_floor_ps(_mm256_mul_ps(y, inv)));
+        _mm256_storeu_ps(floors[2], _mm256_floor_ps(_mm256_mul_ps(z, inv)));
+        int mask = _mm256_movemask_ps(finite);
+        for (int n = 0; n < batch; ++n) isFinite[n] = (mask >> n) & 1;
+    }
+
+    bool hasAVX2() {
+        static const bool isSupported = __builtin_cpu_supports("avx2");
+        return isSupported;
+    }
+#endif
+
+    template<typename PointType>
+    inline void voxelFloors(const PointType* points, size_t count, float inverseLeaf, float floors[3][batch], bool isFinite[batch]) {
+#ifdef KK_VOXEL_AVX2
+        if (count == batch && hasAVX2()) {
+            voxelFloorsAVX2(points, inverseLeaf, floors, isFinite);
+            return;
+        }
+#endif
+        voxelFloorsScalar(points, count, inverseLeaf, floors, isFinite);
+    }
+
+    int bitsFor(uint64_t range) {
+        int bits = 0;
+        while (bits < 64 && (range >> bits) != 0) bits++;
+        return bits;
+    }
+
+    // append the lowest `bits` bits of value to a little endian multi word key
+    inline void packBits(uint64_t value, int bits, int &position, uint64_t* words) {
+        if (bits == 0) return;
+        int word = position / 64, offset = position % 64;
+        words[word] |= value << offset;
+        if (offset + bits > 64) words[word + 1] |= value >> (64 - offset);
+        position += bits;
+    }
+}
+
+void KKRecons::radixSortPairs(vector<uint64_t> &keys, vector<uint32_t> &values, int bits, int threads) {
+    size_t n = keys.size();
+    int numThreads = resolveThreads(threads);
+    vector<uint64_t> tmpKeys(n);
+    vector<uint32_t> tmpValues(n);
+    vector<size_t> histogram(256 * numThreads);
+    for (int shift = 0; shift < bits; shift += 8) {
+        fill(histogram.begin(), histogram.end(), 0);
+        // parallelFor cuts [0, n) the same way every time, so block t counts and scatters the same keys
+        parallelFor(n, numThreads, [&](size_t begin, size_t end, size_t t) {
+            size_t* h = &histogram[256 * t];
+            for (size_t i = begin; i < end; ++i) h[(keys[i] >> shift) & 0xFF]++;
+        });
+        bool isTrivial = false;
+        for (int d = 0; d < 256 && !isTrivial; ++d) {
+            size_t total = 0;
+            for (int t = 0; t < numThreads; ++t) total += histogram[256 * t + d];
+            isTrivial = total == n;
+        }
+        if (isTrivial) continue;
+        size_t offset = 0;
+        for (int d = 0; d < 256; ++d) {
+            for (int t = 0; t < numThreads; ++t) {
+                size_t count = histogram[256 * t + d];
+                histogram[256 * t + d] = offset;
+                offset += count;
+            }
+        }
+        parallelFor(n, numThreads, [&](size_t begin, size_t end, size_t t) {
+            size_t* h = &histogram[256 * t];
+            for (size_t i = begin; i < end; ++i) {
+                size_t target = h[(keys[i] >> shift) & 0xFF]++;
+                tmpKeys[target] = keys[i];
+                tmpValues[target] = values[i];
+            }
+        });
+        keys.swap(tmpKeys);
+        values.swap(tmpValues);
+    }
+}
+
+template<typename PointType>
+void KKRecons::voxelGridFilter(const pcl::PointCloud<PointType> &input, float leafSize, pcl::PointCloud<PointType> &output, int threads) {
+    if (leafSize <= 0) throw invalid_argument("voxelGridFilter: leafSize should be larger than 0");
+    size_t n = input.points.size();
+    if (n >= UINT32_MAX) throw invalid_argument("voxelGridFilter: too many points, use TiledVoxelFilter");
+    int numThreads = resolveThreads(threads);
+    const float inverseLeaf = 1.0f / leafSize;
+    const PointType* points = input.points.data();
+
+    // pass 1: bounds of the voxel coordinates and the number of finite points of each block
+    vector<float> mins(3 * numThreads, FLT_MAX), maxs(3 * numThreads, -FLT_MAX);
+    vector<size_t> numFinite(numThreads + 1, 0);
+    // output may be the input itself, so the voxels are written to their own cloud first
+    pcl::PointCloud<PointType> result;
+    result.header = input.header;
+    parallelFor(n, numThreads, [&](size_t begin, size_t end, size_t t) {
+        float floors[3][batch];
+        bool isFinite[batch];
+        for (size_t i = begin; i < end; i += batch) {
+            size_t count = min<size_t>(batch, end - i);
+            voxelFloors(points + i, count, inverseLeaf, floors, isFinite);
+            for (size_t m = 0; m < count; ++m) {
+                if (!isFinite[m]) continue;
+                numFinite[t + 1]++;
+                for (int a = 0; a < 3; ++a) {
+                    mins[3 * t + a] = min(mins[3 * t + a], floors[a][m]);
+                    maxs[3 * t + a] = max(maxs[3 * t + a], floors[a][m]);
+                }
+            }
+        }
+    });
+    for (int t = 0; t < numThreads; ++t) numFinite[t + 1] += numFinite[t];
+    size_t numKeys = numFinite[numThreads];
+    if (numKeys == 0) {
+        result.width = 0;
+        result.height = 1;
+        output.swap(result);
+        return;
+    }
+    int64_t minIndex[3];
+    int bits[3];
+    for (int a = 0; a < 3; ++a) {
+        float lo = FLT_MAX, hi = -FLT_MAX;
+        for (int t = 0; t < numThreads; ++t) {
+            lo = min(lo, mins[3 * t + a]);
+            hi = max(hi, maxs[3 * t + a]);
+        }
+        if (fabs(lo) > maxVoxelCoordinate || fabs(hi) > maxVoxelCoordinate) {
+            throw invalid_argument("voxelGridFilter: leafSize is too small for the extent of the cloud");
+        }
+        minIndex[a] = static_cast<int64_t>(lo);
+        bits[a] = bitsFor(static_cast<uint64_t>(static_cast<int64_t>(hi) - minIndex[a]));
+    }
+    int numWords = max(1, (bits[0] + bits[1] + bits[2] + 63) / 64);
+
+    // pass 2: pack (k, j, i) of every finite point into a key, k most significant like pcl's voxel index
+    vector<vector<uint64_t> > words(numWords, vector<uint64_t>(numKeys, 0));
+    vector<uint32_t> sourceIndex(numKeys);
+    parallelFor(n, numThreads, [&](size_t begin, size_t end, size_t t) {
+        float floors[3][batch];
+        bool isFinite[batch];
+        size_t c = numFinite[t];
+        for (size_t i = begin; i < end; i += batch) {
+            size_t count = min<size_t>(batch, end - i);
+            voxelFloors(points + i, count, inverseLeaf, floors, isFinite);
+            for (size_t m = 0; m < count; ++m) {
+                if (!isFinite[m]) continue;
+                uint64_t key[3] = {0, 0, 0};
+                int position = 0;
+                for (int a = 0; a < 3; ++a) {
+                    packBits(static_cast<uint64_t>(static_cast<int64_t>(floors[a][m]) - minIndex[a]), bits[a], position, key);
+                }
+                for (int w = 0; w < numWords; ++w) words[w][c] = key[w];
+                sourceIndex[c++] = static_cast<uint32_t>(i + m);
+            }
+        }
+    });
+
+    // sort key positions, least significant word first, every pass is stable
+    vector<uint32_t> order(numKeys);
+    for (size_t c = 0; c < numKeys; ++c) order[c] = static_cast<uint32_t>(c);
+    int remainingBits = bits[0] + bits[1] + bits[2];
+    vector<uint64_t> sortKeys;
+    for (int w = 0; w < numWords; ++w, remainingBits -= 64) {
+        if (w == 0) sortKeys = words[0];
+        else {
+            sortKeys.resize(numKeys);
+            parallelFor(numKeys, numThreads, [&](size_t begin, size_t end, size_t) {
+                for (size_t i = begin; i < end; ++i) sortKeys[i] = words[w][order[i]];
+            });
+        }
+        radixSortPairs(sortKeys, order, min(remainingBits, 64), numThreads);
+    }
+
+    // a voxel starts wherever the key changes
+    auto isHead = [&](size_t i) {
+        if (i == 0) return true;
+        for (int w = 0; w < numWords; ++w) {
+            if (words[w][order[i]] != words[w][order[i - 1]]) return true;
+        }
+        return false;
+    };
+    vector<size_t> numHeads(numThreads + 1, 0);
+    parallelFor(numKeys, numThreads, [&](size_t begin, size_t end, size_t t) {
+        for (size_t i = begin; i < end; ++i) numHeads[t + 1] += isHead(i);
+    });
+    for (int t = 0; t < numThreads; ++t) numHeads[t + 1] += numHeads[t];
+    result.points.resize(numHeads[numThreads]);
+
+    // each block reduces the voxels starting in it, the last one may run past the block end
+    parallelFor(numKeys, numThreads, [&](size_t begin, size_t end, size_t t) {
+        size_t voxel = numHeads[t];
+        for (size_t i = begin; i < end; ++i) {
+            if (!isHead(i)) continue;
+            VoxelAccumulator acc;
+            size_t j = i;
+            do {
+                acc.add(points[sourceIndex[order[j]]]);
+                j++;
+            } while (j < numKeys && !isHead(j));
+            acc.get(result.points[voxel++]);
+        }
+    });
+    result.width = static_cast<uint32_t>(result.points.size());
+    result.height = 1;
+    result.is_dense = true;
+    output.swap(result);
+}
+
+template void KKRecons::voxelGridFilter<pcl::PointXYZRGB>(const pcl::PointCloud<pcl::PointXYZRGB>&, float, pcl::PointCloud<pcl::PointXYZRGB>&, int);
+template void KKRecons::voxelGridFilter<pcl::PointXYZRGBNormal>(const pcl::PointCloud<pcl::PointXYZRGBNormal>&, float, pcl::PointCloud<pcl::PointXYZRGBNormal>&, int);